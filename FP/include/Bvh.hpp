@@ -0,0 +1,87 @@
+/**
+ * @file Bvh.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_BVH_HPP
+#define TEAPOTAHEDRON_BVH_HPP
+
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+using glm::vec3;
+using glm::vec4;
+
+class Bvh {
+  public:
+    // one node of the hierarchy (std430 layout, must match
+    // shadow_raytrace.comp). Leaves hold triangleCount > 0 triangles starting
+    // at leftFirst, inner nodes have their children at leftFirst and
+    // leftFirst + 1
+    struct Node {
+        vec3 boundsMin;
+        GLuint leftFirst;
+        vec3 boundsMax;
+        GLuint triangleCount;
+    };
+
+    // kept in the form the ray/triangle test wants it (w unused)
+    struct Triangle {
+        vec4 v0;
+        vec4 edge1; // v1 - v0
+        vec4 edge2; // v2 - v0
+    };
+
+    /**
+     * @brief build a hierarchy over one mesh (binned surface area heuristic)
+     * and append it to the nodes/triangles shared by every mesh, so all of
+     * them fit in one pair of buffers
+     *
+     * @param vertices three per triangle, in the mesh's own object space
+     * @return index of the mesh's root node
+     */
+    GLuint addMesh(const std::vector<vec3>& vertices);
+
+    // *************************************************************************
+    // Getters
+
+    const std::vector<Node>& getNodes();
+
+    const std::vector<Triangle>& getTriangles();
+
+  private:
+    std::vector<Node> _nodes;
+    std::vector<Triangle> _triangles;
+    std::vector<vec3> _centroids; // per triangle, only needed while building
+
+    // candidate split planes per axis
+    static constexpr GLuint NUM_BINS{12u};
+
+    // never split nodes this small, and never go deeper than this (the
+    // traversal stack in shadow_raytrace.comp is sized for it)
+    static constexpr GLuint MAX_LEAF_TRIANGLES{4u};
+    static constexpr GLuint MAX_DEPTH{32u};
+
+    /**
+     * @brief grow a node's bounds around all of its triangles
+     */
+    void _updateBounds(const GLuint& nodeIndex);
+
+    /**
+     * @brief split a node in two along the cheapest bin boundary and recurse,
+     * unless keeping it as a leaf is cheaper
+     */
+    void _subdivide(const GLuint& nodeIndex, const GLuint& depth);
+
+    static GLfloat _surfaceArea(const vec3& boundsMin, const vec3& boundsMax);
+};
+
+#endif // TEAPOTAHEDRON_BVH_HPP
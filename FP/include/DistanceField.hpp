@@ -0,0 +1,117 @@
+/**
+ * @file DistanceField.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_DISTANCE_FIELD_HPP
+#define TEAPOTAHEDRON_DISTANCE_FIELD_HPP
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+#include <glm/vec3.hpp>
+
+using glm::vec3;
+
+#include "Bvh.hpp"
+
+// signed distance to a triangle mesh, sampled on a regular grid around it
+// (negative inside). Baked on every core the first time, then kept in a cache
+// file for the next run
+class DistanceField {
+  public:
+    /**
+     * @brief load the field from the cache file if it was baked from the same
+     * triangles at the same resolution, otherwise bake it and write it out
+     *
+     * @param vertices three per triangle, in the mesh's own object space
+     * @param resolution samples along each side of the grid
+     * @param cachePath where the baked field is kept between runs
+     */
+    DistanceField(const std::vector<vec3>& vertices, const GLuint& resolution,
+                  const std::string& cachePath);
+
+    // *************************************************************************
+    // Getters
+
+    GLuint getResolution();
+
+    // the grid's corner samples sit exactly on these (object space)
+    vec3 getBoundsMin();
+    vec3 getBoundsMax();
+
+    // x fastest, then y, then z, in object space units
+    const std::vector<GLfloat>& getDistances();
+
+    GLboolean wasCached(); // did it come from the cache file?
+
+  private:
+    GLuint _resolution;
+    vec3 _boundsMin{0.f}, _boundsMax{0.f};
+    std::vector<GLfloat> _distances;
+    GLboolean _cached{GL_FALSE};
+
+    // room around the mesh's bounds, as a fraction of its largest extent, so
+    // the penumbrae next to the surface are still inside the grid
+    static constexpr GLfloat PADDING{0.1f};
+
+    // the cache file starts with this, bump it when the layout changes
+    static constexpr GLuint CACHE_MAGIC{0x31464453u}; // "SDF1"
+
+    // what the triangles under a node look like from far away (Barill et al.,
+    // "Fast Winding Numbers for Soups and Clouds" (2018))
+    struct Dipole {
+        vec3 areaNormal; // sum of the normals, each as long as its area
+        vec3 center;     // area-weighted centroid
+        GLfloat area;
+        GLfloat radius; // around center, reaches every corner of the bounds
+    };
+
+    // nodes further away than this many radii only count as their dipole
+    static constexpr GLfloat DIPOLE_DISTANCE{2.f};
+
+    // only needed while baking
+    Bvh _bvh;
+    GLuint _root{0u};
+    std::vector<Dipole> _dipoles; // one per node
+
+    /**
+     * @brief closest distance to the mesh, signed by the generalized winding
+     * number (which still works for meshes that aren't closed, like the
+     * teapot without its bottom), one z slice per work item
+     */
+    void _bake(const std::vector<vec3>& vertices);
+
+    // both walk _bvh from _root
+    GLfloat _closestDistance(const vec3& p);
+    GLfloat _windingNumber(const vec3& p); // ~1 inside, ~0 outside
+
+    /**
+     * @return false if the file is missing, or holds a different field
+     */
+    GLboolean _load(const std::string& cachePath, const GLuint64& hash);
+
+    void _save(const std::string& cachePath, const GLuint64& hash);
+
+    /**
+     * @brief FNV-1a over the triangles and the resolution, so a cache file
+     * from another mesh or tessellation level is never picked up
+     */
+    static GLuint64 _hash(const std::vector<vec3>& vertices,
+                          const GLuint& resolution);
+
+    static GLfloat _triangleDistance(const vec3& p, const vec3& a,
+                                     const vec3& b, const vec3& c);
+
+    // signed solid angle of a triangle seen from p (Van Oosterom & Strackee)
+    static GLfloat _solidAngle(const vec3& p, const vec3& a, const vec3& b,
+                               const vec3& c);
+};
+
+#endif // TEAPOTAHEDRON_DISTANCE_FIELD_HPP
@@ -11,6 +11,8 @@
 #define TEAPOTAHEDRON_ENGINE_HPP
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 // include glad before glfw
@@ -31,7 +33,12 @@ using glm::vec3;
 using glm::vec4;
 
 #include "ArcballCam.hpp"
+#include "Bvh.hpp"
 #include "ShaderProgram.hpp"
+#include "ShadowAtlas.hpp"
+#include "ShadowScheduler.hpp"
+
+class ReferenceTracer; // only in Engine.cpp, it brings <thread> along
 
 class Engine {
   public:
@@ -106,9 +113,42 @@ class Engine {
         PLANAR_BLEND = 4,
         PLANAR_STENCIL_TEST = 8,
         LINEAR_TEXTURE_FILTER = 16,
-        MAPS_CULL_FRONT_FACE = 32
+        MAPS_CULL_FRONT_FACE = 32,
+        MAPS_DUAL_PARABOLOID = 64,
+        MAPS_SHADOW_ATLAS = 128,
+        MAPS_TIME_SLICED = 256,
+        MAPS_CLUSTERED = 512,
+        MAPS_DEFERRED = 1024,
+        DEPTH_PREPASS = 2048,
+        MAPS_PENUMBRA_TILES = 4096,
+        MAPS_TEMPORAL = 8192,
+        MAPS_RAY_TRACED = 16384,
+        MAPS_ANALYTIC_SPHERES = 32768,
+        MAPS_TEAPOT_PROXIES = 65536,
+        MAPS_SDF = 131072,
+        MAPS_AREA_PROGRESSIVE = 262144,
+        MAPS_IRREGULAR = 524288,
+        TEXTURES_PREFILTER = 1048576,
+        REVERSED_Z = 2097152,
+        SPHERE_LOD = 4194304
+    };
+
+    // how the receiver shaders look up the shadow map
+    enum SHADOW_PROJECTION {
+        CUBEMAP,
+        DUAL_PARABOLOID,
+        CASCADES,
+        SPOT_MAP,
+        CUBEMAP_ARRAY,
+        SHADOW_ATLAS
     };
 
+    // what kind of light the shadow maps are rendered for (only the shadow
+    // mapping receivers know how to light with anything but a point light)
+    enum LIGHT_TYPE { POINT, DIRECTIONAL, SPOT, MULTI_POINT };
+
+    LIGHT_TYPE _light_type = POINT;
+
     int _shadow_options = PLANAR_DEPTH_TEST;
     SHADOW_TYPE _which_shadows = NONE;
 
@@ -118,10 +158,373 @@ class Engine {
 
     // handles for cubemap texture and framebuffer object
     GLuint _shadowCubeMap, _shadowCubeMapFBO;
+    GLuint _shadowCubeMapResolution{0u}; // R8, a mask of what's covered
     GLuint _depthCubeMap, _depthCubeMapFBO;
 
+    // handles for dual-paraboloid texture array (2 layers) and framebuffer
+    GLuint _depthParaboloidMap, _depthParaboloidMapFBO;
+
+    // resolution the depth textures were last allocated at (0 = never)
+    GLuint _depthCubeMapResolution{0u}, _depthParaboloidMapResolution{0u};
+
+    // precision the single light's depth maps are stored at
+    enum SHADOW_DEPTH_FORMAT { DEPTH_16, DEPTH_24, DEPTH_32F };
+
+    SHADOW_DEPTH_FORMAT _shadowDepthFormat{DEPTH_24};
+
+    // the cubemap and the spot map keep plain hardware depth, with near/far
+    // planes fitted around the casters each face can see, and the receivers
+    // turn it back into distance with the planes it was rendered with
+    // (xy = near, far per cube face, then the spot map; must match the Shadow
+    // block)
+    static constexpr GLuint NUM_SHADOW_DEPTH_RANGES{7u};
+    vec4 _shadowDepthRanges[NUM_SHADOW_DEPTH_RANGES];
+
+    // fitted near planes never get closer to the light than this
+    static constexpr GLfloat SHADOW_MIN_NEAR{0.05f};
+
+    // number of frames to average over for each shadow benchmark run
+    static constexpr GLuint SHADOW_BENCHMARK_FRAMES{120u};
+
+    // cascaded shadow maps for the directional light, all cascades live in
+    // one texture array (must match the Shadow block in the shaders)
+    static constexpr GLuint NUM_CASCADES{4u};
+
+    GLuint _cascadeMap, _cascadeMapFBO;
+    GLuint _cascadeMapResolution{0u};
+
+    GLfloat _cascadeSplitLambda{0.75f}; // 0 = uniform splits, 1 = logarithmic
+    GLfloat _shadowDistance{150.f};     // cascades stop this far from the eye
+
+    mat4 _cascadeViewProjections[NUM_CASCADES]; // light frustum per cascade
+    GLfloat _cascadeSplits[NUM_CASCADES];       // far view depth per cascade
+    GLfloat _cascadeDepthRanges[NUM_CASCADES];  // world depth per cascade
+
+    // every shadow caster fits inside a sphere this big around the origin
+    static constexpr GLfloat SCENE_RADIUS{25.f};
+
+    // compass direction the sun shines from (radians)
+    static constexpr GLfloat SUN_AZIMUTH{0.6f};
+
+    // spot light shadows only need a single perspective 2D depth map
+    GLuint _spotShadowMap, _spotShadowMapFBO;
+    GLuint _spotShadowMapResolution{0u};
+
+    GLfloat _spotConeAngle{glm::radians(30.f)}; // half-angle of the outer cone
+    GLfloat _spotFalloff{0.25f}; // fraction of the cone that fades out
+
+    // one light in the PointLights shader storage block (std430 layout, must
+    // match the shaders)
+    struct PointLight {
+        vec4 position; // xyz = world position, w = radius of influence
+        vec4 color;    // rgb = light color
+
+        mat4 faceViewProjections[6]; // one per cubemap face
+    };
+
+    // the block starts with the light count, padded out to a vec4
+    static constexpr GLsizeiptr POINT_LIGHTS_HEADER_SIZE{4 * sizeof(GLuint)};
+
+    static constexpr GLuint MAX_POINT_LIGHTS{64u};
+    static constexpr GLfloat POINT_LIGHT_RADIUS{12.f};
+
+    // every light gets its own cubemap, so keep them small
+    static constexpr GLuint POINT_LIGHT_SHADOW_RESOLUTION{256u};
+
+    GLuint _numPointLights{8u};
+    std::vector<PointLight> _pointLights;
+
+    GLuint _pointLightSSBO;
+    GLuint _pointShadowMaps, _pointShadowMapsFBO;
+    GLuint _pointShadowMapsCount{0u}; // lights the array was allocated for
+
+    // alternatively, every point light face gets a tile of one big 2D atlas
+    // sized by how much of the screen the light covers, so shadow memory stays
+    // fixed no matter how many lights there are
+    static constexpr GLuint SHADOW_ATLAS_SIZE{4096u};
+    static constexpr GLuint SHADOW_ATLAS_MIN_TILE{64u},
+        SHADOW_ATLAS_MAX_TILE{512u};
+
+    ShadowAtlas* _shadowAtlas{nullptr};
+
+    GLuint _shadowAtlasMap, _shadowAtlasFBO;
+    GLuint _shadowAtlasResolution{0u};
+
+    // tile rect (offset.xy, scale.xy in [0;1]) per light face, matches the
+    // ShadowTiles shader storage block
+    std::vector<vec4> _faceTiles;
+    GLuint _shadowTileSSBO;
+
+    GLuint _frameCount{0u}; // frames rendered so far, for LRU bookkeeping
+
+    // re-renders only the cubemap faces that changed the most and fit in a
+    // per-frame GPU budget, the rest keep last frame's contents
+    ShadowScheduler* _shadowScheduler{nullptr};
+
+    // what each cubemap face looked like when it was last rendered
+    vec3 _faceLightPositions[6];
+    GLfloat _faceAngleOffsets[6];
+    GLuint _faceLastRendered[6];
+    GLboolean _faceValid[6]{GL_FALSE}; // false until it has been rendered
+
+    // GPU timer for the scheduled faces, read back a frame later
+    GLuint _shadowTimerQuery;
+    GLboolean _shadowTimerPending{GL_FALSE};
+    GLuint _shadowTimerFaces{0u};
+
+    mat4 _cameraViewProjection{1.f}; // this frame's camera, for importance
+
+    // clustered lighting bins the point lights into a froxel grid (screen
+    // tiles x exponential depth slices), receivers only loop over their own
+    // froxel's lights (must match cluster_lights.comp)
+    static constexpr GLuint CLUSTER_GRID_X{16u}, CLUSTER_GRID_Y{9u},
+        CLUSTER_GRID_Z{24u};
+    static constexpr GLfloat CLUSTER_NEAR{0.5f}, CLUSTER_FAR{200.f};
+
+    GLuint _clusterSSBO;
+
+    // deferred shading: the receivers only fill a G-buffer, then one
+    // fullscreen pass lights and shadows each visible pixel exactly once
+    // (attachment layout must match gbuffer.frag)
+    static constexpr GLsizei NUM_GBUFFER_TEXTURES{5};
+
+    enum GBUFFER_ID { G_POSITION, G_NORMAL, G_AMBIENT, G_DIFFUSE, G_SPECULAR };
+
+    GLuint _gBufferFBO;
+    GLuint _gBufferTextures[NUM_GBUFFER_TEXTURES];
+    GLuint _gBufferDepth; // renderbuffer, blitted to the window for the markers
+    GLint _gBufferWidth{0}, _gBufferHeight{0}; // follow the window size
+    GLenum _gBufferDepthFormat{GL_NONE};       // follows the camera's
+
+    // reversed-Z: the camera renders into its own framebuffer with a float
+    // depth buffer (the window's is fixed point), blitted to the window at the
+    // end of the frame
+    GLuint _cameraFBO, _cameraColor, _cameraDepth; // renderbuffers
+    GLint _cameraWidth{0}, _cameraHeight{0};
+
+    GLuint _fullscreenVAO; // empty, fullscreen.vert makes up its own vertices
+
+    // screen-space shadow mask: with a single light, the deferred path can
+    // evaluate the filtered shadow term at 1/2 or 1/4 resolution into an R8
+    // mask and upsample it (depth/normal aware) during lighting
+    GLuint _shadowMask, _shadowMaskFBO;
+    GLint _shadowMaskWidth{0}, _shadowMaskHeight{0};
+    GLuint _shadowMaskDivisor{1u}; // 1 = full resolution, no mask
+
+    // penumbra tiles: a coarse pass sorts screen tiles into lit, umbra, and
+    // penumbra, and the full shadow filter is only drawn over the penumbra
+    // ones (indirectly, straight from the GPU-built tile list)
+    static constexpr GLint PENUMBRA_TILE_SIZE{8}; // pixels square
+
+    // the list starts with a DrawArraysIndirectCommand
+    static constexpr GLsizeiptr PENUMBRA_TILES_HEADER_SIZE{4 * sizeof(GLuint)};
+
+    GLuint _penumbraClass, _penumbraClassFBO;   // one texel per tile
+    GLuint _penumbraShadow, _penumbraShadowFBO; // full-resolution shadow term
+    GLuint _penumbraTileSSBO;
+    GLint _penumbraWidth{0}, _penumbraHeight{0}; // follow the G-buffer
+    GLfloat _penumbraFraction{0.f}; // share of tiles filtered lately
+
+    // the tile count gets copied out of the list into here, and only read
+    // back once the fence says the copy is done (nullptr = none in flight)
+    GLuint _penumbraCountBuffer;
+    GLsync _penumbraCountFence{nullptr};
+    GLint _penumbraCountTiles{1}; // size of the tile grid the copy came from
+
+    // temporal filtering: a few rotated filter taps per pixel per frame,
+    // blended into a history buffer reprojected from the previous frame
+    static constexpr GLint TEMPORAL_SHADOW_TAPS{4};
+
+    GLuint _temporalTaps, _temporalTapsFBO; // this frame's noisy shadow term
+    GLuint _shadowHistory[2], _shadowHistoryFBO[2]; // ping-ponged
+    GLuint _shadowHistoryIndex{0u};                 // the most recent one
+    GLint _temporalWidth{0}, _temporalHeight{0};    // follow the G-buffer
+    GLboolean _shadowHistoryValid{GL_FALSE};
+
+    // what the last accumulated frame looked like
+    mat4 _previousViewProjection{1.f};
+    vec4 _previousLightPosition{0.f};
+    GLfloat _previousAngleOffset{0.f};
+    LIGHT_TYPE _previousLightType{POINT};
+
+    // ray traced shadows: every G-buffer pixel traces one hard shadow ray
+    // toward the light through a BVH over the scene's actual triangles (one
+    // tree per mesh, placed by per-object transforms), no shadow map involved
+    static constexpr GLuint RAY_TRACED_TEAPOT_LEVEL{16u}; // grid per patch
+
+    // one placed mesh in the RayInstances shader storage block (std430
+    // layout, must match shadow_raytrace.comp)
+    struct RayInstance {
+        mat4 worldToObject; // rays are traced in the mesh's own space
+        GLuint root;        // root node of the mesh's tree
+
+        // all of the mesh's triangles, for passes that don't walk the tree
+        GLuint firstTriangle, triangleCount;
+        GLuint padding;
+    };
+
+    // the block starts with the instance count and the ray counters, padded
+    // out to a vec4
+    static constexpr GLsizeiptr RAY_INSTANCES_HEADER_SIZE{4 * sizeof(GLuint)};
+
+    static constexpr GLuint MAX_RAY_INSTANCES{32u};
+
+    Bvh* _bvh{nullptr};
+
+    GLuint _bvhNodeSSBO, _bvhTriangleSSBO, _rayInstanceSSBO;
+    GLuint _rayTracedShadow; // R8, written as an image
+    GLint _rayTracedWidth{0}, _rayTracedHeight{0}; // follow the G-buffer
+
+    // GPU timer for the trace, read back (with its ray count) a frame later
+    GLuint _rayTimerQuery;
+    GLboolean _rayTimerPending{GL_FALSE};
+    GLdouble _raysPerSecond{0.0};
+
+    // irregular z-buffer: every G-buffer sample goes into a list under the
+    // light-space texel it lands in, then every caster triangle (the same
+    // ones the rays are traced against) tests the samples of the texels it
+    // covers exactly, so the shadows are as sharp as the ray traced ones
+    // whatever the grid resolution, and the work follows the screen samples
+    static constexpr GLuint IRREGULAR_RESOLUTION{512u}; // texels per side
+
+    // the grid over the sun's light covers the whole platform
+    static constexpr GLfloat IRREGULAR_SUN_EXTENT{145.f};
+
+    // the IrregularGrid shader storage block starts with a view-projection
+    // per face (6 for the point light, 1 otherwise), the face count, and the
+    // resolution, padded out to a vec4, followed by the list heads
+    static constexpr GLsizeiptr IRREGULAR_GRID_HEADER_SIZE{
+        6 * sizeof(mat4) + 4 * sizeof(GLuint)};
+
+    GLuint _irregularGridSSBO;
+    GLuint _irregularNodeSSBO; // one list node per G-buffer pixel
+    GLuint _irregularShadow;   // R8, written as an image
+    GLint _irregularWidth{0}, _irregularHeight{0}; // follow the G-buffer
+
+    // reference shadows: the same scene ray traced on the CPU (see
+    // ReferenceTracer), compared pixel by pixel against whatever the GPU
+    // shaded with this frame
+    static constexpr GLuint REFERENCE_TEAPOT_LEVEL{64u}; // grid per patch
+
+    // how far apart the G-buffer's and the tracer's surfaces may be to still
+    // be the same one (the tessellation differs along silhouettes)
+    static constexpr GLfloat REFERENCE_POSITION_TOLERANCE{0.05f};
+
+    ReferenceTracer* _referenceTracer{nullptr}; // built on first use
+    GLboolean _compareReference{GL_FALSE};      // compare the next frame?
+
+    GLuint _shadowCapture, _shadowCaptureFBO; // R32F
+    GLint _shadowCaptureWidth{0}, _shadowCaptureHeight{0};
+
+    // analytic sphere shadows: the spheres stay out of the shadow map, and the
+    // receivers work out how much of a spherical light each of them hides in
+    // closed form instead (see analyticOcclusion() in shadow_lighting.frag)
+    static constexpr GLfloat AREA_LIGHT_RADIUS{0.5f};
+    static constexpr GLfloat SUN_ANGULAR_RADIUS{0.03f}; // radians
+
+    // the SphereOccluders shader storage block starts with the sphere count
+    // and the light's radius, padded out to a vec4
+    static constexpr GLsizeiptr SPHERE_OCCLUDERS_HEADER_SIZE{4 *
+                                                             sizeof(GLuint)};
+
+    static constexpr GLuint MAX_SPHERE_OCCLUDERS{12u}; // inner + outer ring
+
+    GLuint _sphereOccluderSSBO;
+
+    // teapot proxies: a few capsules fitted to the teapot's patches, standing
+    // in for the far or less important teapots so that only the ones close
+    // to the camera have to be drawn into the shadow map
+    static constexpr GLuint PROXY_FIT_LEVEL{8u};    // grid per patch to fit to
+    static constexpr GLuint NUM_TEAPOT_PROXIES{4u}; // capsules per teapot
+
+    // teapots further from the camera than this always use their proxies
+    static constexpr GLfloat PROXY_DISTANCE{30.f};
+
+    // at most this many of the rest keep their full mesh, most important
+    // (largest on screen) first
+    static constexpr GLuint PROXY_FULL_MESH_BUDGET{2u};
+
+    // the CapsuleOccluders shader storage block starts with the capsule
+    // count, padded out to a vec4, and stores two vec4s per capsule
+    static constexpr GLsizeiptr CAPSULE_OCCLUDERS_HEADER_SIZE{4 *
+                                                              sizeof(GLuint)};
+
+    // segment end points in teapot space, w = radius
+    vec4 _teapotProxyStarts[NUM_TEAPOT_PROXIES];
+    vec4 _teapotProxyEnds[NUM_TEAPOT_PROXIES];
+
+    GLboolean _teapotProxied[4]{GL_FALSE}; // which teapots use them this frame
+
+    GLuint _capsuleOccluderSSBO;
+
+    // distance field shadows: signed distance fields of the teapot and the
+    // sphere are baked once (and cached on disk), and the receivers sphere
+    // trace through them toward the light instead of using a shadow map
+    static constexpr GLuint SDF_TEAPOT_LEVEL{6u};   // grid per patch to bake
+    static constexpr GLuint SDF_RESOLUTION{48u};    // samples per side
+    static constexpr const char* SDF_CACHE_DIRECTORY{"cache/"};
+
+    // one placed field in the FieldInstances shader storage block (std430
+    // layout, must match shadow_lighting.frag)
+    struct FieldInstance {
+        mat4 worldToObject;
+        vec4 bounds;   // xyz = world center, w = radius around the whole field
+        GLuint field;  // 0 = teapot, 1 = sphere
+        GLfloat scale; // object space to world space units
+        GLuint padding[2];
+    };
+
+    // the block starts with both fields' bounds and the instance count,
+    // padded out to a vec4
+    static constexpr GLsizeiptr FIELD_INSTANCES_HEADER_SIZE{
+        4 * sizeof(vec4) + 4 * sizeof(GLuint)};
+
+    static constexpr GLuint MAX_FIELD_INSTANCES{16u}; // 4 + 4 + outer ring
+
+    GLuint _distanceFields; // R16F, teapot then sphere along z
+    vec4 _fieldBounds[4]; // both minimums, then both maximums, like the block
+    GLuint _fieldInstanceSSBO;
+
+    // area light: the point light becomes an emitter with some extent, every
+    // frame renders a low-resolution cubemap from one point on it and the
+    // temporal history averages that point's hard shadow with the previous
+    // ones (see _renderTemporalShadows())
+    enum AREA_LIGHT_SHAPE { NO_AREA_LIGHT, SPHERE_EMITTER, QUAD_EMITTER };
+
+    AREA_LIGHT_SHAPE _areaLightShape{NO_AREA_LIGHT};
+
+    static constexpr GLuint AREA_LIGHT_SHADOW_RESOLUTION{256u};
+
+    // the history keeps (at most) this much, an average over the last ~30
+    // samples, or the last ~5 while the light or the casters are moving
+    static constexpr GLfloat AREA_LIGHT_HISTORY_WEIGHT{0.97f};
+    static constexpr GLfloat AREA_LIGHT_MOVING_WEIGHT{0.8f};
+
+    // the progressive mode averages every sample since anything last changed,
+    // and stops once the (half float) history can't take any more of them
+    static constexpr GLuint AREA_LIGHT_MAX_SAMPLES{256u};
+
+    vec3 _areaLightSample{0.f};       // where this frame's cubemap is from
+    GLuint _areaLightSampleIndex{0u}; // into the Halton sequence
+    GLuint _areaLightSamples{0u};     // how many the history holds
+
+    // loose bounds around an (unscaled) teapot
+    static constexpr GLfloat TEAPOT_BOUNDING_RADIUS{3.5f};
+
     bool _options(int bits) { return (_shadow_options & bits) == bits; }
 
+    // which way the camera's depth test goes (reversed-Z keeps the larger)
+    GLenum _cameraDepthFunc() {
+        return _options(REVERSED_Z) ? GL_GREATER : GL_LESS;
+    }
+
+    // depth/stencil format of the camera's depth buffer (and the G-buffer's,
+    // so they can be blitted)
+    GLenum _cameraDepthFormat() {
+        return _options(REVERSED_Z) ? GL_DEPTH32F_STENCIL8
+                                    : GL_DEPTH24_STENCIL8;
+    }
+
     void _turn_on(int bits) { _shadow_options |= bits; }
 
     void _turn_off(int bits) { _shadow_options &= ~bits; }
@@ -130,6 +533,399 @@ class Engine {
 
     void _renderShadowMaps();
 
+    /**
+     * @brief render the scene twice (once per hemisphere) into the 2-layer
+     * dual-paraboloid depth texture array
+     */
+    void _renderDualParaboloidMaps();
+
+    /**
+     * @brief draw every shadow caster (spheres + teapots) with the given depth
+     * programs for a single shadow view
+     *
+     * @param sphereShader program used for the (untessellated) spheres
+     * @param teapotShader program used for the tessellated teapots
+     * @param shadowViewProjection light view (and projection) for this pass
+     * @param eyePos light position, sent as the eye for this pass
+     * @param instanceCount number of instances of every caster to draw
+     * @param lodView which shadow view the sphere LODs are kept for (see
+     * _sphereLod()), -1 when shadowViewProjection isn't a single face's
+     * projection and the spheres keep their default level
+     */
+    void _renderShadowCasters(ShaderProgram* sphereShader,
+                              ShaderProgram* teapotShader,
+                              const mat4& shadowViewProjection,
+                              const vec3& eyePos,
+                              const GLsizei& instanceCount = 1,
+                              const GLint& lodView = -1);
+
+    /**
+     * @brief view matrix of the front paraboloid (looks straight down from the
+     * light, the back paraboloid is this rotated 180 degrees about its up axis)
+     */
+    mat4 _paraboloidLightView();
+
+    /**
+     * @brief time the omnidirectional shadow pass with the cubemap and with
+     * dual-paraboloid maps at equal memory, print the results to stdout
+     */
+    void _benchmarkShadowMaps();
+
+    /**
+     * @brief fit every cascade to its slice of the camera frustum, then render
+     * all of them into the cascade texture array in a single layered pass
+     *
+     * @param viewMatrix camera view matrix
+     * @param projectionMatrix camera projection matrix
+     * @param nearZ camera near plane
+     * @param farZ camera far plane
+     */
+    void _renderCascadedShadowMaps(const mat4& viewMatrix,
+                                   const mat4& projectionMatrix,
+                                   const GLfloat& nearZ, const GLfloat& farZ);
+
+    /**
+     * @brief split the camera frustum (blend of uniform and logarithmic
+     * splits) and compute a tight, texel-snapped orthographic light frustum
+     * around each slice
+     */
+    void _fitCascades(const mat4& viewMatrix, const mat4& projectionMatrix,
+                      const GLfloat& nearZ, const GLfloat& farZ);
+
+    /**
+     * @brief direction the sun's light travels in, its elevation follows the
+     * height of the point light so the same controls move both
+     */
+    vec3 _sunDirection();
+
+    /**
+     * @brief render the shadow casters once into the spot light's 2D depth
+     * map, with near/far planes fitted around them like the cubemap's
+     */
+    void _renderSpotShadowMap();
+
+    /**
+     * @brief perspective view-projection covering the spot light's cone
+     *
+     * @param nearZ near plane distance
+     * @param farZ far plane distance
+     */
+    mat4 _spotViewProjection(const GLfloat& nearZ = 0.1f,
+                             const GLfloat& farZ = 1'000.f);
+
+    /**
+     * @brief direction the spot light points in (it follows the first teapot)
+     */
+    vec3 _spotDirection();
+
+    /**
+     * @brief move the point lights around and recompute their face matrices
+     */
+    void _updatePointLights();
+
+    /**
+     * @brief upload the point lights, then render every light/face pair into
+     * the cubemap array (or the shadow atlas) in one instanced pass
+     *
+     * @param viewMatrix camera view matrix
+     * @param projectionMatrix camera projection matrix
+     * @param viewportHeight height of the window in pixels
+     */
+    void _renderPointLightShadowMaps(const mat4& viewMatrix,
+                                     const mat4& projectionMatrix,
+                                     const GLfloat& viewportHeight);
+
+    /**
+     * @brief bin every point light into the froxels its radius touches with a
+     * compute pass (if clustered lighting is on), and tell the receivers
+     * whether to use the cluster lists
+     *
+     * @param viewMatrix camera view matrix
+     * @param projectionMatrix camera projection matrix
+     * @param framebufferWidth window width in pixels
+     * @param framebufferHeight window height in pixels
+     */
+    void _buildLightClusters(const mat4& viewMatrix,
+                             const mat4& projectionMatrix,
+                             const GLint& framebufferWidth,
+                             const GLint& framebufferHeight);
+
+    /**
+     * @brief hand out atlas tiles to the faces of every light on screen (by
+     * projected size), then render all of them into the atlas in one pass
+     */
+    void _renderShadowAtlas(const mat4& viewMatrix,
+                            const mat4& projectionMatrix,
+                            const GLfloat& viewportHeight);
+
+    /**
+     * @brief does a sphere touch the frustum of a view-projection matrix?
+     *
+     * @param viewProjection frustum to test against
+     * @param sphere xyz = center, w = radius
+     */
+    GLboolean _sphereInFrustum(const mat4& viewProjection, const vec4& sphere);
+
+    /**
+     * @brief bounding spheres (xyz = center, w = radius) of every caster that
+     * moves, for a given spin angle of the scene
+     */
+    std::vector<vec4> _movingCasterBounds(const GLfloat& angleOffset);
+
+    /**
+     * @brief bounding spheres of every shadow caster at the current spin
+     * angle, the outer ring included
+     */
+    std::vector<vec4> _shadowCasterBounds();
+
+    /**
+     * @brief tightest near/far planes along a light frustum's axis that still
+     * hold every caster inside it
+     *
+     * @param eye where the frustum starts
+     * @param axis (unit) direction it looks in
+     * @param viewProjection the frustum itself, with loose near/far planes
+     * @return near, far
+     */
+    vec2 _fitShadowDepthRange(const vec3& eye, const vec3& axis,
+                              const mat4& viewProjection);
+
+    /**
+     * @brief sized internal format for the single light's depth maps
+     */
+    GLenum _shadowDepthInternalFormat();
+
+    /**
+     * @brief how badly a cubemap face needs re-rendering: light motion plus
+     * motion of casters inside its frustum since it was last rendered, scaled
+     * by how much of the face the camera can see and by how stale it is
+     *
+     * @param face cubemap face index
+     * @param faceViewProjection light view-projection of that face
+     * @return 0 if nothing changed
+     */
+    GLfloat _shadowFacePriority(const GLuint& face,
+                                const mat4& faceViewProjection);
+
+    /**
+     * @brief (re)allocate the G-buffer if the window changed size, then bind
+     * and clear it for the geometry pass
+     *
+     * @param width framebuffer width in pixels
+     * @param height framebuffer height in pixels
+     */
+    void _bindGBuffer(const GLint& width, const GLint& height);
+
+    /**
+     * @brief bind whatever the camera renders into: the window, or with
+     * reversed-Z its own float depth framebuffer ((re)allocated if the window
+     * changed size)
+     *
+     * @param width framebuffer width in pixels
+     * @param height framebuffer height in pixels
+     */
+    void _bindCameraFramebuffer(const GLint& width, const GLint& height);
+
+    /**
+     * @brief light and shadow the G-buffer into the window with one fullscreen
+     * triangle, then copy its depth over so forward passes still depth test
+     */
+    void _renderDeferredLighting();
+
+    /**
+     * @brief evaluate the shadow term of every divisor x divisor block of the
+     * G-buffer into the (reallocated if needed) low-resolution shadow mask
+     */
+    void _renderShadowMask();
+
+    /**
+     * @brief classify every screen tile as lit, umbra, or penumbra with a few
+     * hard shadow tests, then run the full filter over the penumbra tiles only
+     * (drawn indirectly from the tile list the classification built)
+     */
+    void _renderPenumbraShadows();
+
+    /**
+     * @brief take a few rotated filter taps per pixel, then reproject, clamp,
+     * and blend them into the shadow history
+     */
+    void _renderTemporalShadows();
+
+    /**
+     * @brief how much of the reprojected history to keep this frame: none if
+     * there is no history, less if the light or the casters moved
+     */
+    GLfloat _temporalHistoryWeight();
+
+    /**
+     * @brief pick the point on the area light this frame's cubemap gets
+     * rendered from, and start the progressive average over whenever the
+     * view, the light, or the casters changed
+     */
+    void _nextAreaLightSample();
+
+    /**
+     * @brief tessellate the teapot on the CPU the same way teapot.tese does,
+     * at a fixed level
+     *
+     * @param level number of segments along each side of a patch
+     * @return three vertices per triangle, in teapot space
+     */
+    std::vector<vec3> _tessellateTeapot(const GLuint& level);
+
+    /**
+     * @brief build a tree over the triangles of the platform, the icosphere,
+     * and the teapot, and upload all of them for the shadow rays
+     */
+    void _buildRayTracingBvh();
+
+    /**
+     * @brief place every mesh in the BVH like _renderScene() does
+     */
+    std::vector<RayInstance> _placeRayInstances();
+
+    /**
+     * @brief place every mesh like _renderScene() does, then trace one shadow
+     * ray per G-buffer pixel into the ray traced shadow image
+     */
+    void _renderRayTracedShadows();
+
+    /**
+     * @brief put every G-buffer sample into the list of the light-space texel
+     * it projects to, then test the samples under every caster triangle
+     * against it into the irregular shadow image
+     */
+    void _renderIrregularShadows();
+
+    /**
+     * @brief capture the shadow term the lighting pass is about to shade
+     * with, ray trace the same frame on the CPU, and print how far apart the
+     * two are to stdout
+     */
+    void _compareAgainstReference();
+
+    /**
+     * @brief upload where the spheres are for the receivers to shadow them
+     * analytically, or an empty list when they're in the shadow map
+     */
+    void _updateSphereOccluders();
+
+    /**
+     * @brief fit one capsule to each part of the teapot (body, handle, spout,
+     * lid), only needs to happen once
+     */
+    void _fitTeapotProxies();
+
+    /**
+     * @brief pick which teapots get drawn into the shadow map and which ones
+     * get shadowed through their proxies this frame, and upload the proxies
+     * for the receivers
+     */
+    void _updateTeapotProxies();
+
+    /**
+     * @brief the icosphere the spheres are drawn with, as a triangle list
+     *
+     * @return three vertices per triangle, radius 1
+     */
+    std::vector<vec3> _icosphereTriangles();
+
+    /**
+     * @brief load (or bake) the teapot's and the sphere's distance fields
+     * and upload them into one 3D texture
+     */
+    void _bakeDistanceFields();
+
+    /**
+     * @brief upload where every teapot and sphere is for the receivers to
+     * march through their fields
+     */
+    void _updateFieldInstances();
+
+    // the light type only matters while shadow mapping
+    bool _lightIs(LIGHT_TYPE type) {
+        return _which_shadows == MAPS && _light_type == type;
+    }
+
+    // analytic sphere shadows work with any single light, but the rays
+    // already hit the actual spheres
+    bool _analyticSpheresActive() {
+        return _which_shadows == MAPS && _light_type != MULTI_POINT &&
+               _options(MAPS_ANALYTIC_SPHERES) && !_exactShadowsActive() &&
+               !_sdfShadowsActive();
+    }
+
+    // same for the teapot proxies
+    bool _teapotProxiesActive() {
+        return _which_shadows == MAPS && _light_type != MULTI_POINT &&
+               _options(MAPS_TEAPOT_PROXIES) && !_exactShadowsActive() &&
+               !_sdfShadowsActive();
+    }
+
+    // distance field shadows work with any single light, and replace its
+    // shadow map (the rays still take priority)
+    bool _sdfShadowsActive() {
+        return _which_shadows == MAPS && _light_type != MULTI_POINT &&
+               _options(MAPS_SDF) && !_exactShadowsActive();
+    }
+
+    // ray traced shadows need the G-buffer, and a single light to trace to
+    bool _rayTracedShadowsActive() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+               _light_type != MULTI_POINT && _options(MAPS_RAY_TRACED);
+    }
+
+    // so does the irregular z-buffer, which gives the same exact shadows
+    bool _irregularShadowsActive() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+               _light_type != MULTI_POINT && _options(MAPS_IRREGULAR) &&
+               !_options(MAPS_RAY_TRACED);
+    }
+
+    // either of them replaces the shadow map with the actual triangles
+    bool _exactShadowsActive() {
+        return _rayTracedShadowsActive() || _irregularShadowsActive();
+    }
+
+    // the area light accumulates in the temporal history, so it needs the
+    // G-buffer too, and the (single) point light's cubemap
+    bool _areaLightActive() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+               _light_type == POINT && _areaLightShape != NO_AREA_LIGHT &&
+               !_options(MAPS_DUAL_PARABOLOID) && !_exactShadowsActive() &&
+               !_options(MAPS_SDF);
+    }
+
+    // so do penumbra tiles, ray tracing replaces the shadow map altogether
+    bool _penumbraTilesActive() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+               _light_type != MULTI_POINT && _options(MAPS_PENUMBRA_TILES) &&
+               !_exactShadowsActive() && !_options(MAPS_SDF) &&
+               !_areaLightActive();
+    }
+
+    // so do temporal shadows, both of the above take precedence over them
+    // (the area light always goes through them)
+    bool _temporalShadowsActive() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+               _light_type != MULTI_POINT &&
+               ((_options(MAPS_TEMPORAL) && !_exactShadowsActive() &&
+                 !_options(MAPS_PENUMBRA_TILES) && !_options(MAPS_SDF)) ||
+                _areaLightActive());
+    }
+
+    // so does the shadow mask, and all of the above take precedence over it
+    // (0 = not in use this frame)
+    GLint _activeShadowMaskDivisor() {
+        return _which_shadows == MAPS && _options(MAPS_DEFERRED) &&
+                       _light_type != MULTI_POINT && !_exactShadowsActive() &&
+                       !_options(MAPS_PENUMBRA_TILES) &&
+                       !_options(MAPS_TEMPORAL) && !_areaLightActive() &&
+                       _shadowMaskDivisor > 1u
+                   ? (GLint)_shadowMaskDivisor
+                   : 0;
+    }
+
     GLboolean _isInitialized, _isShutDown; // engine tracks it's own status
 
     GLboolean _spinObjects{GL_TRUE}; // are the objects in the scene spinning?
@@ -186,16 +982,38 @@ class Engine {
     GLdouble _lastTime; // timer for FPS
     GLdouble _fps;      // current fps
 
+    // where every object sits for one spin angle of the scene (the platform
+    // is always the same), every pass takes its transforms from here
+    struct SceneInstances {
+        std::vector<mat4> teapots;   // model matrices, they don't scale
+        std::vector<vec4> spheres;   // xyz = center, w = radius
+        std::vector<vec4> outerRing; // same, drawn only with _outerRing
+    };
+
+    SceneInstances _sceneInstances(const GLfloat& angleOffset);
+
     void _renderScene(const mat4& viewMatrix, const mat4& projectionMatrix,
                       const mat4& viewportMatrix);
 
+    /**
+     * @brief lay down the depth of every opaque object in the main view before
+     * shading, so the (PCF-heavy) shading pass can run with GL_EQUAL
+     *
+     * @param scene where everything is this frame
+     */
+    void _renderDepthPrepass(const mat4& viewMatrix,
+                             const mat4& projectionMatrix,
+                             const mat4& viewportMatrix,
+                             const SceneInstances& scene);
+
     void _updateScene();
 
     void _drawPlatform();
 
-    void _drawTeapot();
+    void _drawTeapot(const GLsizei& instanceCount = 1);
 
-    void _drawSphere();
+    void _drawSphere(const GLsizei& instanceCount = 1,
+                     const GLuint& lod = SPHERE_SUBDIVISIONS);
 
     // *************************************************************************
     // Input Tracking (Keyboard & Mouse)
@@ -241,6 +1059,49 @@ class Engine {
     GLuint _vbos[NUM_VAOS];          // VBO handles
     GLuint _ibos[NUM_VAOS];          // IBO handles
     GLsizei _numVAOPoints[NUM_VAOS]; // number of points that make up our VAO
+    GLuint _bvhRoots[NUM_VAOS];      // root node of each object's tree in _bvh
+
+    // where each object's triangles start in _bvh, and how many it has
+    GLuint _bvhFirstTriangles[NUM_VAOS], _bvhTriangleCounts[NUM_VAOS];
+
+    // every vertex shader reads these (layout qualifiers), whatever the mesh
+    static constexpr GLuint VPOS_LOCATION{0u}, VNORM_LOCATION{1u};
+
+    // how one attribute is stored in a VBO
+    struct AttributeFormat {
+        GLint size; // components, 0 = the mesh doesn't have it
+        GLenum type;
+        GLboolean normalized; // fixed point read back as [-1;1]
+        GLuint offset;        // bytes into the vertex
+    };
+
+    struct VertexFormat {
+        GLsizei stride;
+        AttributeFormat position, normal;
+    };
+
+    // the only place the meshes' vertex layouts are spelled out, one per
+    // VAO_ID. The fetch decodes all of them, so every program keeps reading
+    // plain vec3 attributes
+    static constexpr VertexFormat VERTEX_FORMATS[NUM_VAOS]{
+        // platform: corners and normal are all 0 or +-1, exact in 10 bits
+        {8,
+         {4, GL_INT_2_10_10_10_REV, GL_TRUE, 0u},
+         {4, GL_INT_2_10_10_10_REV, GL_TRUE, 4u}},
+        // sphere: a point on the unit sphere is its own normal, so both read
+        // the same word
+        {4,
+         {4, GL_INT_2_10_10_10_REV, GL_TRUE, 0u},
+         {4, GL_INT_2_10_10_10_REV, GL_TRUE, 0u}},
+        // teapot: control points as half floats (padded to 8 bytes), the
+        // evaluation shaders work the normals out from the patches
+        {8, {3, GL_HALF_FLOAT, GL_FALSE, 0u}, {0, GL_NONE, GL_FALSE, 0u}}};
+
+    /**
+     * @brief point the bound VAO's attributes at the bound VBO, laid out like
+     * VERTEX_FORMATS says for the mesh
+     */
+    void _setVertexFormat(const VAO_ID& mesh);
 
     /**
      * @brief creates the platform object
@@ -259,6 +1120,49 @@ class Engine {
     // number of subdivisions to use when generating the icosphere (how smooth)
     static constexpr GLuint SPHERE_SUBDIVISIONS{5u};
 
+    // subdivision levels kept in the sphere's buffers, every level's vertices
+    // are the first ones of the next level's, so they all share the VBO
+    static constexpr GLuint SPHERE_LOD_MIN{1u}, SPHERE_LOD_MAX{6u};
+
+    // where each level's indices sit in the sphere's IBO
+    struct SphereLevel {
+        GLsizei count;   // indices
+        GLintptr offset; // bytes
+    };
+
+    SphereLevel _sphereLevels[SPHERE_LOD_MAX - SPHERE_LOD_MIN + 1u];
+
+    // how long a triangle edge of the sphere may get on screen (or in a shadow
+    // map), in pixels, before the next level is picked
+    static constexpr GLfloat SPHERE_LOD_EDGE_PIXELS{8.f};
+
+    // how far (in levels) past the halfway point between two levels the wanted
+    // level has to get before a sphere switches, so it doesn't pop back and
+    // forth
+    static constexpr GLfloat SPHERE_LOD_HYSTERESIS{0.25f};
+
+    // level every sphere is currently drawn at, per view and per sphere (see
+    // _sphereLod())
+    std::unordered_map<GLuint, GLuint> _sphereLods;
+
+    /**
+     * @brief subdivision level to draw a sphere at, from how big it comes out
+     * under a view-projection matrix in the current viewport. Asking again
+     * with the same inputs gives the same level, so passes that have to match
+     * (depth pre-pass) can each ask
+     *
+     * @param view 0 for the camera, 1 + face for a shadow map view
+     * @param sphere which sphere of the scene (inner ring, outer ring, light
+     * markers), together with view it keys the level kept for hysteresis
+     * @param center sphere center in world space
+     * @param radius sphere radius in world space
+     * @param viewProjection where it is being drawn
+     * @return SPHERE_SUBDIVISIONS unless SPHERE_LOD is on
+     */
+    GLuint _sphereLod(const GLuint& view, const GLuint& sphere,
+                      const vec3& center, const GLfloat& radius,
+                      const mat4& viewProjection);
+
     /**
      * @brief creates the icoshpere object
      *
@@ -270,29 +1174,53 @@ class Engine {
     void _createSphere(const GLuint& vao, const GLuint& vbo, const GLuint& ibo,
                        GLsizei& numVAOPoints);
 
+    /**
+     * @brief build the icosphere with every vertex shared between the
+     * triangles around it
+     *
+     * @param [out] vertices x, y, z of every vertex, radius 1
+     * @param [out] indices three per triangle (counter-clockwise from outside)
+     * @param subdivisions times every icosahedron face gets split into 4
+     */
     void _buildIcosphere(std::vector<GLfloat>& vertices,
-                         std::vector<GLushort>& indices);
+                         std::vector<GLuint>& indices,
+                         const GLuint& subdivisions = SPHERE_SUBDIVISIONS);
 
     /**
      * @brief generate the 12 vertices for an icosahedron; each face can then be
      * subdivided many times to approximate a sphere
      *
-     * @param [out] vertices 12 vertices of an icosahedron of radius 1
-     * @param [out] indices naive index list, no optimization
+     * @return 12 vertices of an icosahedron of radius 1
      */
     std::vector<GLfloat> _generateIcosahedron();
 
+    /**
+     * @brief split every triangle into 4 once, appending the new vertices
+     * after the existing ones
+     */
     void _subdivideIcosahedron(std::vector<GLfloat>& vertices,
-                               std::vector<GLushort>& indices);
+                               std::vector<GLuint>& indices);
+
+    /**
+     * @brief index of the vertex halfway along an edge (pushed out onto the
+     * sphere), only adding it the first time either triangle next to the edge
+     * asks
+     *
+     * @param midpoints edge (smaller index in the high bits) -> new vertex
+     */
+    GLuint _midpointVertex(const GLuint& i1, const GLuint& i2,
+                           std::vector<GLfloat>& vertices,
+                           std::unordered_map<GLuint64, GLuint>& midpoints);
 
     void _computeHalfVertex(const GLfloat v1[3ul], const GLfloat v2[3ul],
                             GLfloat newV[3ul]);
 
-    void _addVertices(const GLfloat v1[3], const GLfloat v2[3],
-                      const GLfloat v3[3], std::vector<GLfloat>& vertices);
+    void _addIndices(const GLuint& i1, const GLuint& i2, const GLuint& i3,
+                     std::vector<GLuint>& indices);
 
-    void _addIndices(const GLushort& i1, const GLushort& i2, const GLushort& i3,
-                     std::vector<GLushort>& indices);
+    // GL_UNSIGNED_SHORT while the sphere has few enough vertices, otherwise
+    // GL_UNSIGNED_INT
+    GLenum _sphereIndexType{GL_UNSIGNED_INT};
 
     //**************************************************************************
     // Shader Program Information
@@ -305,16 +1233,30 @@ class Engine {
         *_shadowTextureCubemapTesShader{nullptr},
         *_shadowTextureShader{nullptr}, *_shadowMapShader{nullptr},
         *_shadowMapTesShader{nullptr}, *_depthCubemapShader{nullptr},
-        *_depthCubemapTesShader{nullptr};
+        *_depthCubemapTesShader{nullptr}, *_depthParaboloidShader{nullptr},
+        *_depthParaboloidTesShader{nullptr}, *_depthCascadeShader{nullptr},
+        *_depthCascadeTesShader{nullptr}, *_depthMultiShader{nullptr},
+        *_depthMultiTesShader{nullptr}, *_depthAtlasShader{nullptr},
+        *_depthAtlasTesShader{nullptr}, *_clusterShader{nullptr},
+        *_gBufferShader{nullptr}, *_gBufferTesShader{nullptr},
+        *_deferredLightingShader{nullptr}, *_depthPrepassShader{nullptr},
+        *_depthPrepassTesShader{nullptr}, *_shadowMaskShader{nullptr},
+        *_penumbraClassifyShader{nullptr}, *_penumbraFilterShader{nullptr},
+        *_temporalTapsShader{nullptr}, *_temporalResolveShader{nullptr},
+        *_rayTraceShader{nullptr}, *_irregularInsertShader{nullptr},
+        *_irregularTestShader{nullptr}, *_shadowCaptureShader{nullptr};
 
     // total number of UBOs in our scene
-    static constexpr GLsizei NUM_UBOS{3};
+    static constexpr GLsizei NUM_UBOS{6};
 
     // used to index through our UBO array to give named access
     enum UBO_ID {
-        SCENE,   // uniform matrix info
-        LIGHT,   // uniform light info
-        MATERIAL // uniform material properties
+        SCENE,     // uniform matrix info
+        LIGHT,     // uniform light info
+        MATERIAL,  // uniform material properties
+        SHADOW,    // uniform shadow lookup info
+        SPOT_CONE, // uniform spot light cone info
+        CLUSTER    // uniform froxel grid info
     };
 
     GLuint _ubos[NUM_UBOS];                       // UBO handles
@@ -333,6 +1275,19 @@ class Engine {
 
     void _sendMaterialBlock(const vec3& materialAmb, const vec3& materialDiff,
                             const vec3& materialSpec, const GLfloat& shininess);
+
+    // cascade matrices/splits are taken from the last _fitCascades()
+    void _sendShadowBlock(const mat4& lightView, const mat4& cameraView,
+                          const GLint& shadowProjection);
+
+    void _sendSpotBlock(const mat4& spotViewProjection,
+                        const vec3& spotDirection, const GLfloat& coneAngle,
+                        const GLfloat& falloff);
+
+    void _sendClusterBlock(const mat4& clusterView,
+                           const mat4& inverseProjection,
+                           const vec2& screenSize,
+                           const GLint& clusteredLighting);
 };
 
 static vec3 circlePos(GLfloat radius, GLfloat angle, GLfloat height) {
@@ -0,0 +1,111 @@
+/**
+ * @file ReferenceTracer.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_REFERENCE_TRACER_HPP
+#define TEAPOTAHEDRON_REFERENCE_TRACER_HPP
+
+#include <atomic>
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+using glm::mat4;
+using glm::vec3;
+using glm::vec4;
+
+#include "Bvh.hpp"
+#include "WorkStealingPool.hpp"
+
+// ground truth for the shadow techniques: ray traces the scene on the CPU
+// (analytic spheres and platform, a finely tessellated teapot) with packets of
+// 4 rays per SSE instruction, spread over every core in screen tiles
+class ReferenceTracer {
+  public:
+    ReferenceTracer(const GLuint& numThreads = 0u) : _pool{numThreads} {}
+
+    /**
+     * @brief build the teapot's hierarchy, only needs to happen once
+     *
+     * @param vertices three per triangle, in teapot space
+     */
+    void setTeapot(const std::vector<vec3>& vertices);
+
+    /**
+     * @brief place the objects for the next render()
+     *
+     * @param spheres xyz = center, w = radius
+     * @param teapotModels model matrix of every teapot
+     * @param platformSize half the side of the square platform at y = 0
+     */
+    void setScene(const std::vector<vec4>& spheres,
+                  const std::vector<mat4>& teapotModels,
+                  const GLfloat& platformSize);
+
+    /**
+     * @brief find the closest surface of every pixel, then trace a shadow
+     * ray from it toward the light. Rows are stored bottom first, the same as
+     * glReadPixels
+     *
+     * @param inverseViewProjection inverse of the camera's view-projection
+     * @param eyePos camera position
+     * @param lightPos light position (w = 0 for a direction toward the light)
+     * @param [out] positions xyz = surface hit, w = 1 if anything was hit
+     * @param [out] visibility 1 = lit, 0 = in shadow, -1 = no surface, or a
+     * surface facing away from the light (so shadows don't matter there)
+     */
+    void render(const mat4& inverseViewProjection, const vec3& eyePos,
+                const vec4& lightPos, const GLint& width, const GLint& height,
+                std::vector<vec4>& positions, std::vector<GLfloat>& visibility);
+
+    // *************************************************************************
+    // Getters
+
+    GLuint getNumThreads();
+
+    GLuint getSteals(); // tiles that ended up on another thread, ever
+
+    GLuint64 getRaysTraced(); // primary + shadow rays in the last render()
+
+    // how far shadow rays start off the surface (same as shadow_raytrace.comp)
+    static constexpr GLfloat RAY_OFFSET{0.02f};
+
+  private:
+    WorkStealingPool _pool;
+
+    Bvh _teapot;
+    GLuint _teapotRoot{0u};
+    GLboolean _hasTeapot{GL_FALSE};
+
+    std::vector<vec4> _spheres;
+    std::vector<mat4> _teapotModels, _teapotInverses;
+    GLfloat _platformSize{0.f};
+
+    // what the current render() is working on
+    mat4 _inverseViewProjection{1.f};
+    vec3 _eyePos{0.f};
+    vec4 _lightPos{0.f};
+    GLint _width{0}, _height{0};
+    vec4* _positions{nullptr};
+    GLfloat* _visibility{nullptr};
+
+    std::atomic<GLuint64> _raysTraced{0u};
+
+    static constexpr GLint TILE_SIZE{16}; // pixels square per work item
+
+    /**
+     * @brief trace every 2 x 2 packet of one screen tile
+     */
+    void _renderTile(const GLuint& tile);
+};
+
+#endif // TEAPOTAHEDRON_REFERENCE_TRACER_HPP
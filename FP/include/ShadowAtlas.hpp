@@ -0,0 +1,93 @@
+/**
+ * @file ShadowAtlas.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_SHADOW_ATLAS_HPP
+#define TEAPOTAHEDRON_SHADOW_ATLAS_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+class ShadowAtlas {
+  public:
+    // a square region of the atlas, in texels
+    struct Tile {
+        GLuint x, y, size;
+    };
+
+    ShadowAtlas(const GLuint& size = 4096u, const GLuint& minTileSize = 64u);
+
+    /**
+     * @brief get a tile for a key (e.g. a light's cube face), keeping the one
+     * it already has if the size still matches. When the atlas is full, the
+     * least recently used tiles are evicted until the request fits
+     *
+     * @param key whatever the tile belongs to
+     * @param tileSize requested size in texels (rounded up to a power of two)
+     * @param frame current frame, tiles used during it are never evicted
+     * @param [out] tile where in the atlas the key landed
+     * @return GL_FALSE if it doesn't fit even after evicting everything else
+     */
+    GLboolean acquire(const GLuint& key, GLuint tileSize, const GLuint& frame,
+                      Tile& tile);
+
+    /**
+     * @brief give a key's tile back to the atlas (no-op if it has none)
+     */
+    void release(const GLuint& key);
+
+    // *************************************************************************
+    // Getters
+
+    GLuint getSize();
+
+    GLuint getNumTiles();
+
+    GLuint getEvictions();
+
+  private:
+    struct Entry {
+        Tile tile;
+        GLuint lastUsed; // frame the tile was last acquired
+    };
+
+    GLuint _size, _minTileSize;
+
+    // free tiles of each quadtree level (level 0 is the whole atlas, every
+    // level down halves the tile size)
+    std::vector<std::vector<Tile>> _freeTiles;
+
+    std::unordered_map<GLuint, Entry> _entries; // tiles currently handed out
+
+    GLuint _evictions{0u}; // total tiles evicted to make room
+
+    GLuint _levelOf(const GLuint& tileSize);
+
+    /**
+     * @brief take a free tile from a level, splitting a bigger one into its 4
+     * quadrants if that level is empty
+     */
+    GLboolean _allocate(const GLuint& level, Tile& tile);
+
+    /**
+     * @brief put a tile back on its free list, merging it with its 3 siblings
+     * into their parent if they're all free
+     */
+    void _free(const Tile& tile);
+
+    /**
+     * @brief release the tile that has gone unused for the longest
+     *
+     * @return GL_FALSE if every tile was used this frame
+     */
+    GLboolean _evictLeastRecentlyUsed(const GLuint& frame);
+};
+
+#endif // TEAPOTAHEDRON_SHADOW_ATLAS_HPP
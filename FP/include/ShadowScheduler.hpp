@@ -0,0 +1,73 @@
+/**
+ * @file ShadowScheduler.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_SHADOW_SCHEDULER_HPP
+#define TEAPOTAHEDRON_SHADOW_SCHEDULER_HPP
+
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+class ShadowScheduler {
+  public:
+    ShadowScheduler(const GLfloat& budgetMs = 1.f) : _budgetMs{budgetMs} {}
+
+    /**
+     * @brief queue up a shadow map face that wants to be re-rendered this
+     * frame (faces that didn't change shouldn't be submitted at all)
+     *
+     * @param key whatever identifies the face
+     * @param priority how badly it needs updating, higher goes first
+     */
+    void submit(const GLuint& key, const GLfloat& priority);
+
+    /**
+     * @brief pick the highest priority faces whose estimated GPU cost fits in
+     * the budget (always at least one, so everything catches up eventually),
+     * then empty the queue. Counts the frame as a hit if every submitted face
+     * made it in, as a miss otherwise
+     *
+     * @return keys of the faces to render this frame
+     */
+    std::vector<GLuint> schedule();
+
+    /**
+     * @brief feed back how long the scheduled faces actually took on the GPU,
+     * the per-face cost estimate follows it
+     *
+     * @param milliseconds GPU time spent rendering the faces
+     * @param facesRendered how many faces that was
+     */
+    void reportCost(const GLfloat& milliseconds, const GLuint& facesRendered);
+
+    // *************************************************************************
+    // Getters + Setters
+
+    GLfloat getBudget();
+
+    void setBudget(const GLfloat& budgetMs);
+
+    GLfloat getCostPerFace();
+
+    GLfloat getHitRate(); // fraction of frames since the budget changed
+
+  private:
+    std::vector<std::pair<GLfloat, GLuint>> _queue; // (priority, key)
+
+    GLfloat _budgetMs;            // GPU time allowed per frame
+    GLfloat _costPerFaceMs{0.1f}; // running estimate of one face's cost
+
+    // how quickly the estimate follows new measurements
+    static constexpr GLfloat COST_SMOOTHING{0.1f};
+
+    GLuint _hits{0u}, _frames{0u};
+};
+
+#endif // TEAPOTAHEDRON_SHADOW_SCHEDULER_HPP
@@ -0,0 +1,63 @@
+/**
+ * @file VertexCache.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_VERTEX_CACHE_HPP
+#define TEAPOTAHEDRON_VERTEX_CACHE_HPP
+
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+// reorders an indexed triangle list so the GPU's post-transform cache gets
+// reused as much as possible (Forsyth, "Linear-Speed Vertex Cache
+// Optimisation" (2006))
+class VertexCache {
+  public:
+    /**
+     * @brief greedily emit the triangle whose corners score highest: ones
+     * still in the (simulated) cache, and ones with few triangles left to use
+     * them, so a vertex gets finished off before it falls out
+     *
+     * @param indices three per triangle
+     * @param numVertices every index is below this
+     * @return the same triangles (same winding), in cache-friendly order
+     */
+    static std::vector<GLuint> optimize(const std::vector<GLuint>& indices,
+                                        const GLuint& numVertices);
+
+    /**
+     * @brief average cache miss ratio: vertex shader invocations per triangle
+     * through a FIFO cache of the given size (0.5 is the best a closed mesh
+     * can do, 3 means nothing is ever reused)
+     */
+    static GLfloat missRatio(const std::vector<GLuint>& indices,
+                             const GLuint& cacheSize = 32u);
+
+  private:
+    // size of the simulated LRU cache the scores are tuned for
+    static constexpr GLuint CACHE_SIZE{32u};
+
+    // the last triangle's corners get a fixed score so a strip doesn't
+    // immediately turn back on itself
+    static constexpr GLfloat LAST_TRIANGLE_SCORE{0.75f};
+    static constexpr GLfloat CACHE_DECAY_POWER{1.5f};
+
+    // vertices with few triangles left get a boost to finish them off
+    static constexpr GLfloat VALENCE_BOOST_SCALE{2.f};
+    static constexpr GLfloat VALENCE_BOOST_POWER{0.5f};
+
+    /**
+     * @param cachePosition -1 when the vertex isn't in the cache
+     * @param remaining triangles still to be emitted that use the vertex
+     */
+    static GLfloat _vertexScore(const GLint& cachePosition,
+                                const GLuint& remaining);
+};
+
+#endif // TEAPOTAHEDRON_VERTEX_CACHE_HPP
@@ -0,0 +1,82 @@
+/**
+ * @file WorkStealingPool.hpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#ifndef TEAPOTAHEDRON_WORK_STEALING_POOL_HPP
+#define TEAPOTAHEDRON_WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h> // for GL types
+
+class WorkStealingPool {
+  public:
+    /**
+     * @brief start the worker threads, they sleep until there is work
+     *
+     * @param numThreads how many workers (0 = one per hardware thread)
+     */
+    WorkStealingPool(const GLuint& numThreads = 0u);
+
+    ~WorkStealingPool();
+
+    /**
+     * @brief run task(i) for every i in [0;count) on the workers and wait for
+     * all of them. Items are dealt out round robin, each worker takes from the
+     * back of its own queue and steals from the front of the others' once it
+     * runs dry, so uneven items even out on their own
+     *
+     * @param count number of work items
+     * @param task called once per item, from any of the workers
+     */
+    void parallelFor(const GLuint& count,
+                     const std::function<void(GLuint)>& task);
+
+    // *************************************************************************
+    // Getters
+
+    GLuint getNumThreads();
+
+    GLuint getSteals(); // items taken from another worker's queue, ever
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<GLuint> items;
+    };
+
+    std::vector<std::thread> _threads;
+    std::vector<std::unique_ptr<Queue>> _queues; // one per worker
+
+    const std::function<void(GLuint)>* _task{nullptr};
+
+    std::mutex _mutex; // guards everything below
+    std::condition_variable _wake, _done;
+    GLuint _generation{0u}; // bumped for every parallelFor()
+    GLboolean _stop{GL_FALSE};
+
+    std::atomic<GLuint> _remaining{0u}, _steals{0u};
+
+    void _workerLoop(const GLuint& index);
+
+    /**
+     * @brief next item for a worker, its own first, then anyone else's
+     *
+     * @return false once every queue is empty
+     */
+    GLboolean _pop(const GLuint& index, GLuint& item);
+};
+
+#endif // TEAPOTAHEDRON_WORK_STEALING_POOL_HPP
@@ -0,0 +1,60 @@
+#version 460 core
+
+// lighting pass of the deferred path: runs once per pixel over the G-buffer,
+// so Blinn-Phong and the shadow lookups only happen for visible surfaces
+
+layout(location = 0) out vec4 fragColor; // color to apply to this fragment
+
+// written by gbuffer.frag (see Engine::_gBufferTextures)
+layout(binding = 5) uniform sampler2D gPosition;
+layout(binding = 6) uniform sampler2D gNormal;
+layout(binding = 7) uniform sampler2D gAmbient;
+layout(binding = 8) uniform sampler2D gDiffuse;
+layout(binding = 9) uniform sampler2D gSpecular;
+
+struct SurfaceMaterial {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    float shininess;
+};
+
+// lighting and shadows live in shadow_lighting.frag
+vec3 shade(vec3 fragPosWorld, vec3 fragNormWorld, SurfaceMaterial material);
+vec3 phongModel(vec3 fragPosWorld, vec3 fragNormWorld,
+                SurfaceMaterial material, float shadow);
+
+// the shadow term of the screen-space passes lives in deferred_shadow.frag
+float deferredShadow(ivec2 texel, vec3 position, vec3 normal);
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    // nothing was drawn here, leave the clear color alone
+    vec4 position = texelFetch(gPosition, texel, 0);
+    if (position.w == 0.f)
+        discard;
+
+    vec4 normal = texelFetch(gNormal, texel, 0);
+    vec4 ambient = texelFetch(gAmbient, texel, 0);
+
+    SurfaceMaterial material = SurfaceMaterial(
+        ambient.rgb, texelFetch(gDiffuse, texel, 0).rgb,
+        texelFetch(gSpecular, texel, 0).rgb, normal.w);
+
+    vec3 fragNormWorld = normalize(normal.xyz);
+
+    float shadow = deferredShadow(texel, position.xyz, fragNormWorld);
+
+    // no screen-space pass ran, look the shadow maps up right here
+    if (shadow < 0.f)
+        fragColor = vec4(shade(position.xyz, fragNormWorld, material), 1.f);
+    else
+        fragColor = vec4(
+            phongModel(position.xyz, fragNormWorld, material, shadow), 1.f);
+
+    // wireframe edges were resolved in the geometry pass
+    vec4 edgeColor = vec4(1.f, 1.f, 0.f, 1.f);
+    fragColor = mix(edgeColor, fragColor, ambient.a);
+}
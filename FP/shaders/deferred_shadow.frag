@@ -0,0 +1,103 @@
+#version 460 core
+
+// single-light shadow term of a G-buffer texel, out of whichever screen-space
+// shadow pass ran this frame (shared by deferred_lighting.frag and
+// shadow_capture.frag)
+
+// written by gbuffer.frag (see Engine::_gBufferTextures)
+layout(binding = 5) uniform sampler2D gPosition;
+layout(binding = 6) uniform sampler2D gNormal;
+
+// single-light shadow term at a lower resolution (see shadow_mask.frag)
+layout(binding = 10) uniform sampler2D shadowMask;
+
+// per-tile class (see penumbra_classify.frag), and the filtered shadow term of
+// the penumbra tiles (see penumbra_filter.frag)
+layout(binding = 11) uniform sampler2D penumbraClass;
+layout(binding = 12) uniform sampler2D penumbraShadow;
+
+// ray traced shadow term (see shadow_raytrace.comp), or the irregular
+// z-buffer's (see shadow_irregular_test.comp)
+layout(binding = 13) uniform sampler2D rayTracedShadow;
+
+// temporally accumulated shadow term (see shadow_temporal_resolve.frag)
+layout(binding = 14) uniform sampler2D shadowHistory;
+
+// lighting and shadows live in shadow_lighting.frag
+float ShadowCalculation(vec3 fragPosWorld);
+int getShadowMaskDivisor();
+int getPenumbraTileSize();
+int getTemporalShadowTaps();
+int getRayTracedShadows();
+
+// bilateral upsampling: blend the 4 closest mask texels bilinearly, but only
+// trust the ones that were taken from the same surface as us
+float upsampleShadowMask(ivec2 texel, vec3 position, vec3 normal) {
+    int divisor = getShadowMaskDivisor();
+    ivec2 maskSize = textureSize(shadowMask, 0);
+    ivec2 gBufferSize = textureSize(gPosition, 0);
+
+    // mask texel m was taken from G-buffer texel m * divisor + divisor / 2
+    vec2 maskCoord = (vec2(texel) - float(divisor / 2)) / float(divisor);
+    ivec2 base = ivec2(floor(maskCoord));
+    vec2 f = fract(maskCoord);
+
+    float shadow = 0.f, weightSum = 0.f;
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            ivec2 maskTexel = clamp(base + ivec2(x, y), ivec2(0), maskSize - 1);
+            ivec2 source = min(maskTexel * divisor + divisor / 2,
+                               gBufferSize - 1);
+
+            vec4 sourcePos = texelFetch(gPosition, source, 0);
+            if (sourcePos.w == 0.f)
+                continue;
+            vec3 sourceNorm = texelFetch(gNormal, source, 0).xyz;
+
+            float bilinear = (x == 0 ? 1.f - f.x : f.x) *
+                             (y == 0 ? 1.f - f.y : f.y);
+
+            // how far the sample is off our tangent plane, and how differently
+            // it faces
+            float planeDist = abs(dot(sourcePos.xyz - position, normal));
+            float weight = (bilinear + 0.001f) * exp(-20.f * planeDist) *
+                           pow(max(dot(sourceNorm, normal), 0.f), 32.f);
+
+            shadow += weight * texelFetch(shadowMask, maskTexel, 0).r;
+            weightSum += weight;
+        }
+    }
+
+    // none of them were on our surface (thin or distant geometry), fall back
+    // to the full-resolution lookup
+    if (weightSum < 0.0001f)
+        return ShadowCalculation(position);
+
+    return shadow / weightSum;
+}
+
+// 1 = fully in shadow, or -1 when no screen-space pass ran and the shadow maps
+// should be looked up directly
+float deferredShadow(ivec2 texel, vec3 position, vec3 normal) {
+    int tileSize = getPenumbraTileSize();
+
+    if (getRayTracedShadows() == 1)
+        return texelFetch(rayTracedShadow, texel, 0).r;
+
+    if (tileSize > 0) {
+        // lit/umbra tiles were settled by the classification pass, only
+        // penumbra tiles were filtered
+        float tileClass = texelFetch(penumbraClass, texel / tileSize, 0).r;
+        return tileClass > 0.25f && tileClass < 0.75f
+                   ? texelFetch(penumbraShadow, texel, 0).r
+                   : tileClass;
+    }
+
+    if (getTemporalShadowTaps() > 0)
+        return texelFetch(shadowHistory, texel, 0).r;
+
+    if (getShadowMaskDivisor() > 0)
+        return upsampleShadowMask(texel, position, normal);
+
+    return -1.f;
+}
@@ -0,0 +1,10 @@
+#version 460 core
+
+// depth pre-pass: only the depth buffer gets written, the shading pass then
+// runs with GL_EQUAL so each visible pixel is shaded exactly once
+
+// positions come from the same vertex/tessellation shaders as the shading
+// pass (gouraud.vert, teapot.tese), their invariant gl_Position keeps the
+// depths bit-for-bit identical
+
+void main() {}
@@ -0,0 +1,9 @@
+#version 460 core
+
+// one triangle that covers the whole screen, no vertex buffer needed (draw 3
+// vertices with an empty VAO bound)
+
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.f - 1.f, 0.f, 1.f);
+}
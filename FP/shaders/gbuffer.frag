@@ -0,0 +1,61 @@
+#version 460 core
+
+// geometry pass of the deferred path: store what shadow_lighting.frag needs to
+// shade this pixel later, so it only ever gets shaded (and shadowed) once
+
+layout(location = 0) in vec3 fragPosWorld;  // interpolated world-space position
+layout(location = 1) in vec3 fragNormWorld; // interpolated world-space normal
+layout(location = 2) in vec3 edgeDistances; // interpolated triangle edge dists
+
+layout(location = 0) out vec4 gPosition; // xyz = world position, w = 1
+layout(location = 1) out vec4 gNormal;   // xyz = world normal, w = shininess
+layout(location = 2) out vec4 gAmbient;  // rgb = ambient, a = wireframe mix
+layout(location = 3) out vec4 gDiffuse;  // rgb = diffuse reflectivity
+layout(location = 4) out vec4 gSpecular; // rgb = specular reflectivity
+
+layout(shared, binding = 0) uniform Scene {
+    mat4 model; // model matrix
+    mat4 viewProjection;
+    mat4 modelViewProjection; // model-view-projection matrix
+    mat4 viewportMatrix;      // viewport matrix
+
+    mat4 shadowViewProjection; // shadow transforms
+
+    float tessLevel; // inner/outer tessellation level
+
+    vec3 eyePos; // eye position in world space
+
+    int wireframe;     // use wireframe rendering
+    int controlPoints; // show control points
+};
+
+layout(shared, binding = 2) uniform Material {
+    vec3 materialAmb;  // ambient reflectivity
+    vec3 materialDiff; // diffuse reflectivity
+    vec3 materialSpec; // specular reflectivity
+
+    float shininess; // specular shininess factor
+};
+
+void main() {
+    // w = 1 tells the lighting pass something was drawn here
+    gPosition = vec4(fragPosWorld, 1.f);
+
+    // flip the normal of back faces now, the lighting pass can't tell anymore
+    vec3 normal = normalize(gl_FrontFacing ? fragNormWorld : -fragNormWorld);
+    gNormal = vec4(normal, shininess);
+
+    // same edge blend as shadow_map.frag, 1 = no edge
+    float mixVal = 1.f;
+    if (wireframe == 1) {
+        float minEdgeDist =
+            min(edgeDistances.x, min(edgeDistances.y, edgeDistances.z));
+
+        float edgeWidth = 1.f;
+        mixVal = smoothstep(edgeWidth - 1.f, edgeWidth + 1.f, minEdgeDist);
+    }
+
+    gAmbient = vec4(materialAmb, mixVal);
+    gDiffuse = vec4(materialDiff, 1.f);
+    gSpecular = vec4(materialSpec, 1.f);
+}
@@ -15,6 +15,9 @@ layout(location = 1) in vec3 vNorm;
 layout(location = 0) out vec3 fragPosWorld;
 layout(location = 1) out vec3 fragNormWorld;
 
+// must match the depth pre-pass exactly, or GL_EQUAL would reject fragments
+invariant gl_Position;
+
 layout(shared, binding = 0) uniform Scene {
     mat4 model; // model matrix
     mat4 viewProjection;
@@ -0,0 +1,66 @@
+#version 460 core
+
+// penumbra classification: one fragment per screen tile, a handful of hard
+// (single tap) shadow tests spread over the tile decide whether it is fully
+// lit, fully in umbra, or needs the full filter; penumbra tiles are appended
+// to a list that gets drawn with glDrawArraysIndirect (penumbra_tile.vert)
+
+layout(location = 0) out float tileClass; // 0 = lit, 1 = umbra, 0.5 = penumbra
+
+layout(binding = 5) uniform sampler2D gPosition;
+
+// the header doubles as the indirect draw command
+layout(std430, binding = 3) buffer PenumbraTiles {
+    uint vertexCount;   // always 6 (two triangles per tile)
+    uint instanceCount; // number of penumbra tiles
+    uint first;
+    uint baseInstance;
+
+    vec4 tileRects[]; // NDC xy min, xy max of each penumbra tile
+};
+
+// lighting and shadows live in shadow_lighting.frag
+float shadowLookup(vec3 fragPosWorld, bool filtered);
+int getPenumbraTileSize();
+
+void main() {
+    int tileSize = getPenumbraTileSize();
+    ivec2 gBufferSize = textureSize(gPosition, 0);
+    ivec2 tileMin = ivec2(gl_FragCoord.xy) * tileSize;
+
+    // corners (pushed out a couple of pixels to catch the filter's reach
+    // from the neighbouring tiles) and center of the tile
+    const vec2 taps[5] = vec2[](vec2(-0.25f, -0.25f), vec2(1.25f, -0.25f),
+                                vec2(-0.25f, 1.25f), vec2(1.25f, 1.25f),
+                                vec2(0.5f, 0.5f));
+
+    float lit = 0.f, shadowed = 0.f;
+    for (int i = 0; i < 5; ++i) {
+        ivec2 texel = clamp(tileMin + ivec2(taps[i] * float(tileSize)),
+                            ivec2(0), gBufferSize - 1);
+
+        // background pixels don't get lit at all
+        vec4 position = texelFetch(gPosition, texel, 0);
+        if (position.w == 0.f)
+            continue;
+
+        if (shadowLookup(position.xyz, false) > 0.5f)
+            shadowed += 1.f;
+        else
+            lit += 1.f;
+    }
+
+    // all taps agree, no filtering needed anywhere in the tile
+    if (lit == 0.f || shadowed == 0.f) {
+        tileClass = shadowed > 0.f ? 1.f : 0.f;
+        return;
+    }
+
+    tileClass = 0.5f;
+
+    vec2 ndcMin = vec2(tileMin) / vec2(gBufferSize) * 2.f - 1.f;
+    vec2 ndcMax =
+        min(vec2(tileMin + tileSize) / vec2(gBufferSize) * 2.f - 1.f, 1.f);
+
+    tileRects[atomicAdd(instanceCount, 1u)] = vec4(ndcMin, ndcMax);
+}
@@ -0,0 +1,16 @@
+#version 460 core
+
+// full shadow filter, only drawn over the tiles penumbra_classify.frag flagged
+
+layout(location = 0) out float penumbraShadow; // filtered shadow term
+
+layout(binding = 5) uniform sampler2D gPosition;
+
+// lighting and shadows live in shadow_lighting.frag
+float ShadowCalculation(vec3 fragPosWorld);
+
+void main() {
+    vec4 position = texelFetch(gPosition, ivec2(gl_FragCoord.xy), 0);
+    penumbraShadow =
+        position.w == 0.f ? 0.f : ShadowCalculation(position.xyz);
+}
@@ -0,0 +1,22 @@
+#version 460 core
+
+// one quad per penumbra tile, instanced straight off the classification list
+
+layout(std430, binding = 3) readonly buffer PenumbraTiles {
+    uint vertexCount;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+
+    vec4 tileRects[]; // NDC xy min, xy max of each penumbra tile
+};
+
+void main() {
+    // two triangles: (0, 1, 2) and (2, 1, 3) of the tile's corners
+    const int corners[6] = int[](0, 1, 2, 2, 1, 3);
+    int corner = corners[gl_VertexID];
+
+    vec4 rect = tileRects[gl_InstanceID];
+    gl_Position = vec4((corner & 1) == 0 ? rect.x : rect.z,
+                       (corner & 2) == 0 ? rect.y : rect.w, 0.f, 1.f);
+}
@@ -0,0 +1,33 @@
+#version 460 core
+
+// the single-light shadow term exactly as deferred_lighting.frag shades with
+// it, read back by Engine::_compareAgainstReference()
+
+layout(location = 0) out float shadowTerm; // 1 = fully in shadow
+
+layout(binding = 5) uniform sampler2D gPosition;
+layout(binding = 6) uniform sampler2D gNormal;
+
+// lighting and shadows live in shadow_lighting.frag
+float ShadowCalculation(vec3 fragPosWorld);
+float withAnalyticShadows(vec3 fragPosWorld, float shadow);
+
+// the shadow term of the screen-space passes lives in deferred_shadow.frag
+float deferredShadow(ivec2 texel, vec3 position, vec3 normal);
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    // nothing was drawn here, the comparison skips it anyway
+    vec4 position = texelFetch(gPosition, texel, 0);
+    if (position.w == 0.f) {
+        shadowTerm = 0.f;
+        return;
+    }
+
+    float shadow = deferredShadow(
+        texel, position.xyz, normalize(texelFetch(gNormal, texel, 0).xyz));
+    shadowTerm = withAnalyticShadows(
+        position.xyz,
+        shadow < 0.f ? ShadowCalculation(position.xyz) : shadow);
+}
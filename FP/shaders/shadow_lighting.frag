@@ -0,0 +1,842 @@
+// Blinn-Phong lighting and every shadow map lookup, shared by the forward
+// receivers (shadow_map.frag) and the deferred lighting pass
+// (deferred_lighting.frag); linked in as a second fragment shader object
+
+#version 460 core
+
+// what the surface reflects, from the Material block or the G-buffer
+struct SurfaceMaterial {
+    vec3 amb;  // ambient reflectivity
+    vec3 diff; // diffuse reflectivity
+    vec3 spec; // specular reflectivity
+
+    float shininess; // specular shininess factor
+};
+
+uniform samplerCube shadowMap;
+// front/back paraboloid layers, or one layer per cascade
+layout(binding = 1) uniform sampler2DArray shadowMapArray;
+// single perspective map of a spot light
+layout(binding = 2) uniform sampler2D spotShadowMap;
+// one cubemap per light in the PointLights buffer
+layout(binding = 3) uniform samplerCubeArray pointShadowMaps;
+// or one tile per light face in a shared atlas
+layout(binding = 4) uniform sampler2D shadowAtlas;
+
+layout(shared, binding = 0) uniform Scene {
+    mat4 model; // model matrix
+    mat4 viewProjection;
+    mat4 modelViewProjection; // model-view-projection matrix
+    mat4 viewportMatrix;      // viewport matrix
+
+    mat4 shadowViewProjection; // shadow transforms
+
+    float tessLevel; // inner/outer tessellation level
+
+    vec3 eyePos; // eye position in world space
+
+    int wireframe;     // use wireframe rendering
+    int controlPoints; // show control points
+};
+
+layout(shared, binding = 1) uniform Light {
+    vec4 lightPos; // light position in world space
+
+    vec3 lightAmb;  // ambient light intensity
+    vec3 lightDiff; // diffuse light intensity
+    vec3 lightSpec; // specular light intensity
+
+    float attenConst; // constant attenuation term
+    float attenLin;   // linear attenuation term
+    float attenQuad;  // quadratic attenuation term
+
+    float shadowBias;
+    int doMultisampling;
+    float shadowMapSamples;
+};
+
+layout(std140, binding = 3) uniform Shadow {
+    mat4 lightView; // view matrix of the front paraboloid
+
+    // 0 = cubemap, 1 = dual-paraboloid, 2 = cascades, 3 = spot,
+    // 4 = cubemap array (many point lights), 5 = shadow atlas (many point
+    // lights)
+    int shadowProjection;
+
+    mat4 cameraView; // camera view matrix (cascades are picked by view depth)
+
+    mat4 cascadeViewProjections[4]; // orthographic light frustum per cascade
+    vec4 cascadeSplits;             // far view depth of each cascade
+    vec4 cascadeDepthRanges;        // world-space depth covered by each cascade
+
+    // deferred only: the single-light shadow term comes from a screen-space
+    // mask at 1/divisor resolution (0 = no mask)
+    int shadowMaskDivisor;
+
+    // deferred only: the full filter only runs in penumbra tiles of this many
+    // pixels square, found by a coarse classification pass (0 = off)
+    int penumbraTileSize;
+
+    // deferred only: temporal filtering takes this many taps per pixel per
+    // frame (0 = off) and blends them into a history reprojected with the
+    // previous frame's camera
+    mat4 previousViewProjection;
+    int temporalTaps;
+    int frameIndex;      // rotates the taps every frame
+    float historyWeight; // how much of the (clamped) history to keep
+
+    // deferred only: the single-light shadow term was ray traced per pixel
+    // (see shadow_raytrace.comp), or tested against every triangle over it
+    // by the irregular z-buffer, instead of looked up in a shadow map
+    int rayTracedShadows;
+
+    // the single-light shadow term is ray marched through the baked distance
+    // fields instead of looked up in a shadow map
+    int sdfShadows;
+
+    // deferred only: the point light is an area light, this frame's cubemap
+    // was rendered from xyz (w = 1, 0 = off), and the temporal history
+    // averages its hard shadow with the previous frames' points
+    vec4 areaLightSample;
+
+    // near/far planes (xy) each cubemap face was last rendered with, then the
+    // spot map's; both keep plain hardware depth
+    vec4 shadowDepthRanges[7];
+};
+
+layout(std140, binding = 4) uniform Spot {
+    mat4 spotViewProjection; // perspective frustum around the cone
+
+    vec4 spotDirection; // direction the spot light points in (w unused)
+
+    float spotCosOuter; // cosine of the cone's half-angle
+    float spotCosInner; // cosine of the angle where falloff begins
+};
+
+struct PointLight {
+    vec4 position; // xyz = world position, w = radius of influence
+    vec4 color;    // rgb = light color
+
+    mat4 faceViewProjections[6]; // one per cubemap face
+};
+
+layout(std430, binding = 0) readonly buffer PointLights {
+    uint numPointLights;
+    PointLight pointLights[];
+};
+
+layout(std430, binding = 1) readonly buffer ShadowTiles {
+    vec4 faceTiles[]; // offset.xy, scale.xy of each light face in the atlas
+};
+
+// every cluster gets a light count followed by room for every light
+const uint CLUSTER_STRIDE = 65u; // Engine::MAX_POINT_LIGHTS + 1
+
+layout(std430, binding = 2) readonly buffer ClusterLights {
+    uint clusterLights[];
+};
+
+layout(std140, binding = 5) uniform Cluster {
+    mat4 clusterView;       // camera view matrix
+    mat4 inverseProjection; // inverse of the camera projection matrix
+
+    uvec4 clusterGrid; // number of froxels along x, y, z (w unused)
+
+    vec2 screenSize;   // framebuffer size in pixels
+    float clusterNear; // slicing starts here (first slice also covers closer)
+    float clusterFar;  // slicing ends here
+
+    int clusteredLighting; // should the receivers use the cluster lists?
+};
+
+// sphere casters shadowed analytically instead of through the shadow map
+// (numSphereOccluders = 0 when they're in the map as usual)
+layout(std430, binding = 7) readonly buffer SphereOccluders {
+    uint numSphereOccluders;
+    float lightRadius; // radius of the spherical light, or the angular radius
+                       // of the sun's disc for a directional light
+    vec4 sphereOccluders[]; // xyz = center, w = radius
+};
+
+// capsules fitted to the teapots that stay out of the shadow map (see
+// Engine::_updateTeapotProxies), shadowed the same way as the spheres
+layout(std430, binding = 8) readonly buffer CapsuleOccluders {
+    uint numCapsuleOccluders;
+    // two per capsule: xyz = start of the segment, w = radius, then xyz = end
+    vec4 capsuleOccluders[];
+};
+
+// signed distance fields of the teapot and the sphere in object space,
+// stacked along z (see Engine::_bakeDistanceFields)
+layout(binding = 15) uniform sampler3D distanceFields;
+
+struct FieldInstance {
+    mat4 worldToObject;
+    vec4 bounds; // xyz = world center, w = radius around the whole field
+    uint field;  // 0 = teapot, 1 = sphere
+    float scale; // object space to world space units
+};
+
+layout(std430, binding = 9) readonly buffer FieldInstances {
+    vec4 fieldBoundsMin[2]; // object space box each field covers (w unused)
+    vec4 fieldBoundsMax[2];
+    uint numFieldInstances;
+    FieldInstance fieldInstances[];
+};
+
+// which froxel this fragment falls in (same spacing as cluster_lights.comp)
+uint clusterIndex(vec3 fragPosWorld) {
+    uvec2 tile = uvec2(clamp(gl_FragCoord.xy / screenSize * vec2(clusterGrid.xy),
+                             vec2(0.f), vec2(clusterGrid.xy - 1u)));
+
+    float viewDepth = -(clusterView * vec4(fragPosWorld, 1.f)).z;
+    float slice = floor(log(viewDepth / clusterNear) /
+                        log(clusterFar / clusterNear) * float(clusterGrid.z));
+    uint sliceIndex = uint(clamp(slice, 0.f, float(clusterGrid.z - 1u)));
+
+    return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * sliceIndex);
+}
+
+// where the single point light's map was rendered from
+vec3 shadowMapOrigin() {
+    return areaLightSample.w == 1.f ? areaLightSample.xyz : lightPos.xyz;
+}
+
+// hardware depth of a perspective map back to view depth along its axis,
+// nothing rendered there (the cleared 1) is infinitely far away
+float linearDepth(float depth, vec2 range) {
+    if (depth >= 1.f)
+        return 1e30f;
+
+    float ndc = 2.f * depth - 1.f;
+    return 2.f * range.x * range.y /
+           (range.y + range.x - ndc * (range.y - range.x));
+}
+
+// fetch the (normalized) closest depth stored along a light-to-fragment vector
+// (the paraboloid's, the cubemap's is hardware depth)
+float sampleShadowMap(vec3 fragToLight) {
+    if (shadowProjection == 0)
+        return texture(shadowMap, fragToLight).r;
+
+    // rotate into the paraboloid's space, front hemisphere looks down -Z
+    vec3 dir = normalize(mat3(lightView) * fragToLight);
+
+    if (dir.z <= 0.f)
+        return texture(shadowMapArray,
+                       vec3(dir.xy / (1.f - dir.z) * 0.5f + 0.5f, 0.f))
+            .r;
+
+    // back hemisphere is the front one rotated 180 degrees about Y
+    return texture(shadowMapArray,
+                   vec3(vec2(-dir.x, dir.y) / (1.f + dir.z) * 0.5f + 0.5f, 1.f))
+        .r;
+}
+
+// distance from the light to the closest caster along a light-to-fragment
+// vector
+float closestDistance(vec3 fragToLight) {
+    if (shadowProjection != 0)
+        return sampleShadowMap(fragToLight) * 1000.f; // undo mapping [0;1]
+
+    // the face the lookup lands on stores depth along its own axis
+    vec3 a = abs(fragToLight);
+    int face = a.x >= a.y && a.x >= a.z ? (fragToLight.x > 0.f ? 0 : 1)
+               : a.y >= a.z             ? (fragToLight.y > 0.f ? 2 : 3)
+                                        : (fragToLight.z > 0.f ? 4 : 5);
+    float major = max(a.x, max(a.y, a.z));
+
+    return linearDepth(sampleShadowMap(fragToLight),
+                       shadowDepthRanges[face].xy) *
+           length(fragToLight) / major;
+}
+
+float cascadeShadowCalculation(vec3 fragPosWorld, bool filtered) {
+    // pick the first cascade whose slice of the view frustum holds us
+    float viewDepth = -(cameraView * vec4(fragPosWorld, 1.f)).z;
+    if (viewDepth > cascadeSplits[3])
+        return 0.f; // past the shadow distance, just call it lit
+
+    int cascade = 0;
+    while (cascade < 3 && viewDepth > cascadeSplits[cascade])
+        ++cascade;
+
+    // orthographic projection, so no perspective divide needed
+    vec3 coords =
+        (cascadeViewProjections[cascade] * vec4(fragPosWorld, 1.f)).xyz * 0.5f +
+        0.5f;
+
+    // bias is given in world units, cascades store [0;1] depth
+    float currentDepth = coords.z - shadowBias / cascadeDepthRanges[cascade];
+
+    if (!filtered)
+        return currentDepth >
+                       texture(shadowMapArray, vec3(coords.xy, cascade)).r
+                   ? 1.f
+                   : 0.f;
+
+    // sample a grid across a few texels around us, average results
+    vec2 texelSize = 1.f / vec2(textureSize(shadowMapArray, 0).xy);
+    float shadow = 0.f;
+    for (float x = -1.f; x < 1.f; x += 2.f / shadowMapSamples) {
+        for (float y = -1.f; y < 1.f; y += 2.f / shadowMapSamples) {
+            vec2 offset = vec2(x, y) * 1.5f * texelSize;
+            if (currentDepth >
+                texture(shadowMapArray, vec3(coords.xy + offset, cascade)).r)
+                shadow += 1.f;
+        }
+    }
+
+    return shadow / (shadowMapSamples * shadowMapSamples);
+}
+
+float spotShadowCalculation(vec3 fragPosWorld, bool filtered) {
+    vec4 coords = spotViewProjection * vec4(fragPosWorld, 1.f);
+    if (coords.w <= 0.f)
+        return 0.f; // behind the light, the cone takes care of it
+
+    vec2 uv = coords.xy / coords.w * 0.5f + 0.5f;
+
+    // w is our depth along the spot's axis, what the map stores (once it's
+    // linear again)
+    float currentDepth = coords.w - shadowBias;
+    vec2 range = shadowDepthRanges[6].xy;
+
+    if (!filtered)
+        return currentDepth > linearDepth(texture(spotShadowMap, uv).r, range)
+                   ? 1.f
+                   : 0.f;
+
+    // sample a grid across a few texels around us, average results
+    vec2 texelSize = 1.f / vec2(textureSize(spotShadowMap, 0));
+    float shadow = 0.f;
+    for (float x = -1.f; x < 1.f; x += 2.f / shadowMapSamples) {
+        for (float y = -1.f; y < 1.f; y += 2.f / shadowMapSamples) {
+            vec2 offset = vec2(x, y) * 1.5f * texelSize;
+            if (currentDepth >
+                linearDepth(texture(spotShadowMap, uv + offset).r, range))
+                shadow += 1.f;
+        }
+    }
+
+    return shadow / (shadowMapSamples * shadowMapSamples);
+}
+
+float atlasShadow(uint light, vec3 fragPosWorld, vec3 fragToLight,
+                  float currentDepth) {
+    // pick the face the same way a cubemap lookup would
+    vec3 a = abs(fragToLight);
+    uint face = a.x >= a.y && a.x >= a.z ? (fragToLight.x > 0.f ? 0u : 1u)
+                : a.y >= a.z             ? (fragToLight.y > 0.f ? 2u : 3u)
+                                         : (fragToLight.z > 0.f ? 4u : 5u);
+
+    vec4 tile = faceTiles[light * 6u + face];
+    if (tile.z == 0.f)
+        return 0.f; // the atlas had no room for this face, call it lit
+
+    vec4 coords = pointLights[light].faceViewProjections[face] *
+                  vec4(fragPosWorld, 1.f);
+    vec2 uv = coords.xy / coords.w * 0.5f + 0.5f;
+
+    // keep filtering from bleeding over into the neighbouring tiles
+    vec2 texelSize = 1.f / vec2(textureSize(shadowAtlas, 0));
+    vec2 tileMin = tile.xy + 0.5f * texelSize;
+    vec2 tileMax = tile.xy + tile.zw - 0.5f * texelSize;
+
+    float radius = pointLights[light].position.w;
+
+    if (doMultisampling == 0)
+        return currentDepth > texture(shadowAtlas,
+                                      clamp(tile.xy + uv * tile.zw, tileMin,
+                                            tileMax))
+                                      .r *
+                                  radius
+                   ? 1.f
+                   : 0.f;
+
+    // sample a grid across a few texels around us, average results
+    float shadow = 0.f;
+    for (float x = -1.f; x < 1.f; x += 2.f / shadowMapSamples) {
+        for (float y = -1.f; y < 1.f; y += 2.f / shadowMapSamples) {
+            vec2 offset = vec2(x, y) * 1.5f * texelSize;
+            vec2 atlasUV =
+                clamp(tile.xy + uv * tile.zw + offset, tileMin, tileMax);
+            if (currentDepth > texture(shadowAtlas, atlasUV).r * radius)
+                shadow += 1.f;
+        }
+    }
+
+    return shadow / (shadowMapSamples * shadowMapSamples);
+}
+
+float pointLightShadow(uint light, vec3 fragPosWorld, vec3 fragToLight,
+                       float currentDepth) {
+    // each light's map stores distance over its radius
+    float radius = pointLights[light].position.w;
+    currentDepth -= shadowBias;
+
+    if (shadowProjection == 5)
+        return atlasShadow(light, fragPosWorld, fragToLight, currentDepth);
+
+    if (doMultisampling == 0)
+        return currentDepth > texture(pointShadowMaps,
+                                      vec4(fragToLight, float(light)))
+                                      .r *
+                                  radius
+                   ? 1.f
+                   : 0.f;
+
+    // sample multiple times along each axis, average results
+    float shadow = 0.f;
+    float offset = 0.1f;
+    for (float x = -offset; x < offset;
+         x += offset / (shadowMapSamples * 0.5f)) {
+        for (float y = -offset; y < offset;
+             y += offset / (shadowMapSamples * 0.5f)) {
+            for (float z = -offset; z < offset;
+                 z += offset / (shadowMapSamples * 0.5f)) {
+                float closestDepth =
+                    texture(pointShadowMaps,
+                            vec4(fragToLight + vec3(x, y, z), float(light)))
+                        .r *
+                    radius;
+                if (currentDepth > closestDepth)
+                    shadow += 1.f;
+            }
+        }
+    }
+
+    return shadow / (shadowMapSamples * shadowMapSamples * shadowMapSamples);
+}
+
+vec3 blinnPhongSpecular(vec3 fragPosWorld, vec3 fragNormWorld, vec3 lightVec,
+                        float lightDotNorm, SurfaceMaterial material) {
+    vec3 viewVec = normalize(eyePos - fragPosWorld);
+    vec3 halfwayVec = normalize(viewVec + lightVec);
+
+    return lightSpec * material.spec *
+           pow(max(dot(halfwayVec, fragNormWorld), 0.f),
+               4.f * material.shininess) *
+           lightDotNorm;
+}
+
+const int SDF_MAX_STEPS = 48;          // per pixel, whatever happens
+const float SDF_START_OFFSET = 0.15f;  // clears the surface we start on
+const float SDF_MIN_STEP = 0.02f;      // keeps grazing rays moving
+const float SDF_MAX_DISTANCE = 60.f;   // how far a directional light's rays go
+
+// signed distance from one placed field, in world units
+float fieldDistance(uint instance, vec3 positionWorld) {
+    uint field = fieldInstances[instance].field;
+    vec3 boxMin = fieldBoundsMin[field].xyz;
+    vec3 boxMax = fieldBoundsMax[field].xyz;
+
+    vec3 position =
+        (fieldInstances[instance].worldToObject * vec4(positionWorld, 1.f)).xyz;
+
+    // outside the grid, add the way there on top
+    vec3 clamped = clamp(position, boxMin, boxMax);
+    float outside = length(position - clamped);
+
+    // the corner samples sit on the box, then pick this field's half
+    float resolution = float(textureSize(distanceFields, 0).x);
+    vec3 uvw = (0.5f + (clamped - boxMin) / (boxMax - boxMin) *
+                           (resolution - 1.f)) /
+               resolution;
+    uvw.z = (uvw.z + float(field)) * 0.5f;
+
+    return (texture(distanceFields, uvw).r + outside) *
+           fieldInstances[instance].scale;
+}
+
+// distance to the closest object, skipping the ones whose bounds are further
+// away than the closest one so far
+float sceneDistance(vec3 positionWorld) {
+    float closest = SDF_MAX_DISTANCE;
+
+    for (uint i = 0u; i < numFieldInstances; ++i) {
+        vec4 bounds = fieldInstances[i].bounds;
+        if (distance(positionWorld, bounds.xyz) - bounds.w > closest)
+            continue;
+
+        closest = min(closest, fieldDistance(i, positionWorld));
+    }
+
+    return closest;
+}
+
+// sphere trace toward the light; the closest the ray passes by anything,
+// relative to how wide the light's cone is there, says how much of the light
+// gets covered (1 = fully in shadow)
+float distanceFieldShadow(vec3 fragPosWorld) {
+    vec3 toLight = lightPos.xyz - fragPosWorld * lightPos.w;
+    float lightDist = lightPos.w == 0.f ? SDF_MAX_DISTANCE : length(toLight);
+    vec3 dir = normalize(toLight);
+
+    // the same spherical light the analytic shadows use
+    float lightAngle = lightPos.w == 0.f
+                           ? lightRadius
+                           : asin(min(lightRadius / lightDist, 1.f));
+    float spread = tan(lightAngle);
+
+    // -1 = the cone is entirely blocked, 1 = entirely clear
+    float closest = 1.f;
+    float t = SDF_START_OFFSET;
+
+    for (int i = 0; i < SDF_MAX_STEPS && t < lightDist; ++i) {
+        float d = sceneDistance(fragPosWorld + t * dir);
+
+        closest = min(closest, d / (t * spread));
+        if (closest <= -1.f)
+            break;
+
+        // the fields are signed, so keep going through the inside as well
+        t += max(abs(d), SDF_MIN_STEP);
+    }
+
+    return 1.f - smoothstep(-1.f, 1.f, closest);
+}
+
+// shadow term of the single light, either a single hard test or the full
+// filter kernel
+float shadowLookup(vec3 fragPosWorld, bool filtered) {
+    if (sdfShadows == 1)
+        return distanceFieldShadow(fragPosWorld);
+
+    if (shadowProjection == 2)
+        return cascadeShadowCalculation(fragPosWorld, filtered);
+    if (shadowProjection == 3)
+        return spotShadowCalculation(fragPosWorld, filtered);
+
+    /* https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows */
+
+    // get vector between fragment position and light position
+    vec3 fragToLight = fragPosWorld - shadowMapOrigin();
+    // use the light to fragment vector to sample from the depth map
+    float closestDepth = closestDistance(fragToLight);
+    // now get current linear depth as the length between the fragment and light
+    // position
+    float currentDepth = length(fragToLight);
+
+    if (!filtered)
+        return currentDepth - shadowBias > closestDepth ? 1.f : 0.f;
+
+    // sample multiple times along each axis, average results
+    else {
+        float shadow = 0.0;
+        float offset = 0.1;
+        for (float x = -offset; x < offset;
+             x += offset / (shadowMapSamples * 0.5)) {
+            for (float y = -offset; y < offset;
+                 y += offset / (shadowMapSamples * 0.5)) {
+                for (float z = -offset; z < offset;
+                     z += offset / (shadowMapSamples * 0.5)) {
+                    float closestDepth =
+                        closestDistance(fragToLight + vec3(x, y, z));
+                    if (currentDepth - shadowBias > closestDepth)
+                        shadow += 1.0;
+                }
+            }
+        }
+        shadow /= (shadowMapSamples * shadowMapSamples * shadowMapSamples);
+
+        return shadow;
+    }
+}
+
+float ShadowCalculation(vec3 fragPosWorld) {
+    return shadowLookup(fragPosWorld, doMultisampling == 1);
+}
+
+// one unfiltered tap of the single light's map, offset anywhere inside the
+// footprint of the PCF kernel (offset in [-1;1]^2)
+float shadowTap(vec3 fragPosWorld, vec2 offset) {
+    if (sdfShadows == 1)
+        return distanceFieldShadow(fragPosWorld);
+
+    if (shadowProjection == 2) {
+        float viewDepth = -(cameraView * vec4(fragPosWorld, 1.f)).z;
+        if (viewDepth > cascadeSplits[3])
+            return 0.f;
+
+        int cascade = 0;
+        while (cascade < 3 && viewDepth > cascadeSplits[cascade])
+            ++cascade;
+
+        vec3 coords =
+            (cascadeViewProjections[cascade] * vec4(fragPosWorld, 1.f)).xyz *
+                0.5f +
+            0.5f;
+        float currentDepth =
+            coords.z - shadowBias / cascadeDepthRanges[cascade];
+
+        vec2 texelSize = 1.f / vec2(textureSize(shadowMapArray, 0).xy);
+        vec2 uv = coords.xy + offset * 1.5f * texelSize;
+        return currentDepth > texture(shadowMapArray, vec3(uv, cascade)).r
+                   ? 1.f
+                   : 0.f;
+    }
+
+    if (shadowProjection == 3) {
+        vec4 coords = spotViewProjection * vec4(fragPosWorld, 1.f);
+        if (coords.w <= 0.f)
+            return 0.f;
+
+        vec2 uv = coords.xy / coords.w * 0.5f + 0.5f;
+        float currentDepth = coords.w - shadowBias;
+
+        vec2 texelSize = 1.f / vec2(textureSize(spotShadowMap, 0));
+        uv += offset * 1.5f * texelSize;
+        return currentDepth > linearDepth(texture(spotShadowMap, uv).r,
+                                          shadowDepthRanges[6].xy)
+                   ? 1.f
+                   : 0.f;
+    }
+
+    // cubemap/paraboloid: nudge the lookup vector sideways, as far as the PCF
+    // box reaches
+    vec3 fragToLight = fragPosWorld - shadowMapOrigin();
+    vec3 dir = normalize(fragToLight);
+    vec3 side = normalize(cross(dir, abs(dir.y) < 0.99f ? vec3(0.f, 1.f, 0.f)
+                                                        : vec3(1.f, 0.f, 0.f)));
+    vec3 up = cross(side, dir);
+
+    vec3 nudge = 0.1f * (offset.x * side + offset.y * up);
+    float closestDepth = closestDistance(fragToLight + nudge);
+
+    return length(fragToLight) - shadowBias > closestDepth ? 1.f : 0.f;
+}
+
+// a few taps of a Vogel disk rotated by a per-pixel, per-frame angle; summed
+// up over a few frames they cover the whole kernel
+float temporalShadowTaps(vec3 fragPosWorld, float rotation) {
+    // area light: the softness comes from the points the frames were rendered
+    // from, each one only needs its hard shadow
+    if (areaLightSample.w == 1.f)
+        return shadowTap(fragPosWorld, vec2(0.f));
+
+    float shadow = 0.f;
+    for (int i = 0; i < temporalTaps; ++i) {
+        float radius = sqrt((float(i) + 0.5f) / float(temporalTaps));
+        float theta = float(i) * 2.399963f + rotation; // golden angle
+
+        shadow +=
+            shadowTap(fragPosWorld, radius * vec2(cos(theta), sin(theta)));
+    }
+
+    return shadow / float(temporalTaps);
+}
+
+/* Mazonka, "Solid Angle of Conical Surfaces, Polyhedral Cones, and
+   Intersecting Spherical Caps" (2012) */
+
+// solid angle of the overlap of two spherical caps with half-angles a and b,
+// whose axes are c apart
+float capOverlap(float a, float b, float c) {
+    const float PI = 3.14159265f;
+
+    // disjoint, or one cap entirely inside the other
+    if (c >= a + b)
+        return 0.f;
+    if (c <= abs(a - b))
+        return 2.f * PI * (1.f - cos(min(a, b)));
+
+    float cosA = cos(a), cosB = cos(b), cosC = cos(c);
+    float sinA = sin(a), sinB = sin(b), sinC = sin(c);
+
+    return 2.f *
+           (PI -
+            acos(clamp((cosC - cosA * cosB) / (sinA * sinB), -1.f, 1.f)) -
+            acos(clamp((cosB - cosC * cosA) / (sinC * sinA), -1.f, 1.f)) *
+                cosA -
+            acos(clamp((cosA - cosC * cosB) / (sinC * sinB), -1.f, 1.f)) *
+                cosB);
+}
+
+// how much of the spherical light one sphere leaves visible from this
+// fragment
+float sphereVisibility(vec3 fragPosWorld, vec3 toLight, float lightDist,
+                       float lightAngle, vec4 sphere) {
+    const float PI = 3.14159265f;
+
+    vec3 toSphere = sphere.xyz - fragPosWorld;
+    float sphereDist = length(toSphere);
+    float radius = sphere.w;
+
+    // the fragment is on (the tessellated surface of) this sphere, its own
+    // shading already takes care of that
+    if (sphereDist <= radius * 1.01f)
+        return 1.f;
+
+    // entirely behind the light
+    if (lightPos.w != 0.f && sphereDist - radius > lightDist)
+        return 1.f;
+
+    float sphereAngle = asin(radius / sphereDist);
+    float between = acos(clamp(dot(toSphere / sphereDist, toLight), -1.f, 1.f));
+
+    return 1.f - capOverlap(lightAngle, sphereAngle, between) /
+                     (2.f * PI * (1.f - cos(lightAngle)));
+}
+
+// a capsule hides about as much as the sphere around the point of its segment
+// closest to the ray toward the light
+vec4 capsuleSphere(vec3 fragPosWorld, vec3 toLight, uint capsule) {
+    vec3 start = capsuleOccluders[2u * capsule].xyz;
+    vec3 segment = capsuleOccluders[2u * capsule + 1u].xyz - start;
+    vec3 offset = start - fragPosWorld;
+
+    float segmentLength2 = dot(segment, segment);
+    float along = dot(segment, toLight);
+    float denom = segmentLength2 - along * along;
+
+    // parallel to the ray (or just a sphere), any point of it will do
+    float s = denom > 0.000001f ? clamp((along * dot(toLight, offset) -
+                                         dot(segment, offset)) /
+                                            denom,
+                                        0.f, 1.f)
+                                : 0.5f;
+
+    return vec4(start + s * segment, capsuleOccluders[2u * capsule].w);
+}
+
+// fraction of the spherical light the analytic occluders hide, seen from this
+// fragment, combined as if they were independent (1 = fully in shadow)
+float analyticOcclusion(vec3 fragPosWorld) {
+    // direction and angular radius of the light as seen from here
+    vec3 toLight = lightPos.xyz - fragPosWorld * lightPos.w;
+    float lightDist = length(toLight);
+    float lightAngle = lightPos.w == 0.f
+                           ? lightRadius
+                           : asin(min(lightRadius / lightDist, 1.f));
+    toLight /= lightDist;
+
+    float visibility = 1.f;
+    for (uint i = 0u; i < numSphereOccluders; ++i)
+        visibility *= sphereVisibility(fragPosWorld, toLight, lightDist,
+                                       lightAngle, sphereOccluders[i]);
+
+    for (uint i = 0u; i < numCapsuleOccluders; ++i)
+        visibility *=
+            sphereVisibility(fragPosWorld, toLight, lightDist, lightAngle,
+                             capsuleSphere(fragPosWorld, toLight, i));
+
+    return 1.f - visibility;
+}
+
+// add the analytic shadows to a shadow term from anywhere else
+float withAnalyticShadows(vec3 fragPosWorld, float shadow) {
+    if (numSphereOccluders == 0u && numCapsuleOccluders == 0u)
+        return shadow;
+
+    return 1.f - (1.f - shadow) * (1.f - analyticOcclusion(fragPosWorld));
+}
+
+int getTemporalShadowTaps() { return temporalTaps; }
+int getFrameIndex() { return frameIndex; }
+float getHistoryWeight() { return historyWeight; }
+mat4 getPreviousViewProjection() { return previousViewProjection; }
+mat4 getCameraViewProjection() { return viewProjection; }
+int getAreaLight() { return int(areaLightSample.w); }
+
+// is the shadow term ray traced? (1 = yes)
+int getRayTracedShadows() { return rayTracedShadows; }
+
+// resolution divisor of the screen-space shadow mask (0 = no mask)
+int getShadowMaskDivisor() { return shadowMaskDivisor; }
+
+// size of the penumbra classification tiles (0 = every pixel gets filtered)
+int getPenumbraTileSize() { return penumbraTileSize; }
+
+vec3 phongModel(vec3 fragPosWorld, vec3 fragNormWorld,
+                SurfaceMaterial material, float shadow) {
+    // compute ambient component
+    vec3 ambient = lightAmb * material.amb;
+
+    // spheres and distant teapots may not be in the shadow map at all
+    shadow = withAnalyticShadows(fragPosWorld, shadow);
+
+    // used for diffuse and specular (w = 0 means a directional light)
+    vec3 lightVec = normalize(lightPos.xyz - fragPosWorld * lightPos.w);
+    float lightDotNorm = max(dot(lightVec, fragNormWorld), 0.f);
+
+    // compute diffuse component
+    vec3 diffuse = lightDiff * material.diff * lightDotNorm;
+
+    // compute specular component
+    vec3 specular = blinnPhongSpecular(fragPosWorld, fragNormWorld, lightVec,
+                                       lightDotNorm, material);
+
+    // compute attenuation (directional lights don't fall off)
+    float lightDist =
+        lightPos.w == 0.f ? 0.f : distance(lightPos.xyz, fragPosWorld);
+    float attenuation =
+        attenConst + attenLin * lightDist + attenQuad * pow(lightDist, 2);
+
+    // spot lights fade out toward the edge of their cone
+    float spot = 1.f;
+    if (shadowProjection == 3)
+        spot = smoothstep(spotCosOuter, spotCosInner,
+                          dot(-lightVec, spotDirection.xyz));
+
+    return (ambient + spot * (1.f - shadow) * (diffuse + specular)) /
+           attenuation;
+}
+
+vec3 multiLightModel(vec3 fragPosWorld, vec3 fragNormWorld,
+                     SurfaceMaterial material) {
+    // ambient only gets counted once
+    vec3 color = lightAmb * material.amb;
+
+    // either every light, or only the ones binned into our cluster
+    uint lightCount = numPointLights;
+    uint listStart = 0u;
+    if (clusteredLighting == 1) {
+        listStart = clusterIndex(fragPosWorld) * CLUSTER_STRIDE;
+        lightCount = clusterLights[listStart];
+    }
+
+    for (uint n = 0u; n < lightCount; ++n) {
+        uint i = clusteredLighting == 1 ? clusterLights[listStart + 1u + n] : n;
+
+        vec3 toLight = pointLights[i].position.xyz - fragPosWorld;
+        float lightDist = length(toLight);
+        float radius = pointLights[i].position.w;
+
+        // only lights whose radius reaches us contribute (or need shadows)
+        if (lightDist >= radius)
+            continue;
+
+        vec3 lightVec = toLight / lightDist;
+        float lightDotNorm = max(dot(lightVec, fragNormWorld), 0.f);
+        if (lightDotNorm == 0.f)
+            continue;
+
+        vec3 lightColor = pointLights[i].color.rgb;
+        vec3 diffuse = lightDiff * lightColor * material.diff * lightDotNorm;
+        vec3 specular =
+            lightColor * blinnPhongSpecular(fragPosWorld, fragNormWorld,
+                                            lightVec, lightDotNorm, material);
+
+        // usual attenuation, windowed so it reaches zero at the radius
+        float window = pow(clamp(1.f - pow(lightDist / radius, 4.f), 0.f, 1.f),
+                           2.f);
+        float attenuation =
+            attenConst + attenLin * lightDist + attenQuad * pow(lightDist, 2);
+
+        color += window *
+                 (1.f - pointLightShadow(i, fragPosWorld, -toLight,
+                                         lightDist)) *
+                 (diffuse + specular) / attenuation;
+    }
+
+    return color;
+}
+
+vec3 shade(vec3 fragPosWorld, vec3 fragNormWorld, SurfaceMaterial material) {
+    if (shadowProjection == 4 || shadowProjection == 5)
+        return multiLightModel(fragPosWorld, fragNormWorld, material);
+
+    return phongModel(fragPosWorld, fragNormWorld, material,
+                      ShadowCalculation(fragPosWorld));
+}
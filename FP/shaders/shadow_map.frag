@@ -15,8 +15,6 @@ layout(location = 2) in vec3 edgeDistances; // interpolated triangle edge dists
 
 layout(location = 0) out vec4 fragColor; // color to apply to this fragment
 
-uniform samplerCube shadowMap;
-
 layout(shared, binding = 0) uniform Scene {
     mat4 model; // model matrix
     mat4 viewProjection;
@@ -33,22 +31,6 @@ layout(shared, binding = 0) uniform Scene {
     int controlPoints; // show control points
 };
 
-layout(shared, binding = 1) uniform Light {
-    vec4 lightPos; // light position in world space
-
-    vec3 lightAmb;  // ambient light intensity
-    vec3 lightDiff; // diffuse light intensity
-    vec3 lightSpec; // specular light intensity
-
-    float attenConst; // constant attenuation term
-    float attenLin;   // linear attenuation term
-    float attenQuad;  // quadratic attenuation term
-
-    float shadowBias;
-    int doMultisampling;
-    float shadowMapSamples;
-};
-
 layout(shared, binding = 2) uniform Material {
     vec3 materialAmb;  // ambient reflectivity
     vec3 materialDiff; // diffuse reflectivity
@@ -57,92 +39,31 @@ layout(shared, binding = 2) uniform Material {
     float shininess; // specular shininess factor
 };
 
-vec3 blinnPhongSpecular(vec3 fragPosWorld, vec3 fragNormWorld, vec3 lightVec,
-                        float lightDotNorm) {
-    vec3 viewVec = normalize(eyePos - fragPosWorld);
-    vec3 halfwayVec = normalize(viewVec + lightVec);
-
-    return lightSpec * materialSpec *
-           pow(max(dot(halfwayVec, fragNormWorld), 0.f), 4.f * shininess) *
-           lightDotNorm;
-}
-
-float ShadowCalculation() {
-    /* https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows */
-
-    // get vector between fragment position and light position
-    vec3 fragToLight = fragPosWorld - lightPos.xyz;
-    // use the light to fragment vector to sample from the depth map
-    float closestDepth = texture(shadowMap, fragToLight).r;
-    // it is currently in linear range between [0,1]. Re-transform back to
-    // original value
-    closestDepth *= 1000.f;
-    // now get current linear depth as the length between the fragment and light
-    // position
-    float currentDepth = length(fragToLight);
-
-    if (doMultisampling == 0)
-        return currentDepth - shadowBias > closestDepth ? 1.f : 0.f;
-
-    // sample multiple times along each axis, average results
-    else if (doMultisampling == 1) {
-        float shadow = 0.0;
-        float offset = 0.1;
-        for (float x = -offset; x < offset;
-             x += offset / (shadowMapSamples * 0.5)) {
-            for (float y = -offset; y < offset;
-                 y += offset / (shadowMapSamples * 0.5)) {
-                for (float z = -offset; z < offset;
-                     z += offset / (shadowMapSamples * 0.5)) {
-                    float closestDepth =
-                        texture(shadowMap, fragToLight + vec3(x, y, z)).r;
-                    closestDepth *= 1000.f; // undo mapping [0;1]
-                    if (currentDepth - shadowBias > closestDepth)
-                        shadow += 1.0;
-                }
-            }
-        }
-        shadow /= (shadowMapSamples * shadowMapSamples * shadowMapSamples);
-
-        return shadow;
-    }
-}
-
-vec3 phongModel(vec3 fragPosWorld, vec3 fragNormWorld) {
-    // compute ambient component
-    vec3 ambient = lightAmb * materialAmb;
-
-    // used for diffuse and specular
-    vec3 lightVec = normalize(lightPos.xyz - fragPosWorld);
-    float lightDotNorm = max(dot(lightVec, fragNormWorld), 0.f);
-
-    // compute diffuse component
-    vec3 diffuse = lightDiff * materialDiff * lightDotNorm;
+struct SurfaceMaterial {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
 
-    // compute specular component
-    vec3 specular =
-        blinnPhongSpecular(fragPosWorld, fragNormWorld, lightVec, lightDotNorm);
-
-    // compute attenuation
-    float lightDist = distance(lightPos.xyz, fragPosWorld);
-    float attenuation =
-        attenConst + attenLin * lightDist + attenQuad * pow(lightDist, 2);
+    float shininess;
+};
 
-    return (ambient + (1.f - ShadowCalculation()) * (diffuse + specular)) /
-           attenuation;
-}
+// lighting and shadows live in shadow_lighting.frag
+vec3 shade(vec3 fragPosWorld, vec3 fragNormWorld, SurfaceMaterial material);
 
 void main() {
+    SurfaceMaterial material =
+        SurfaceMaterial(materialAmb, materialDiff, materialSpec, shininess);
+
     // if we are looking at the front face of the fragment
     if (gl_FrontFacing)
-        fragColor =
-            vec4(phongModel(fragPosWorld, normalize(fragNormWorld)), 1.f);
+        fragColor = vec4(
+            shade(fragPosWorld, normalize(fragNormWorld), material), 1.f);
 
     // otherwise we are looking at the back face of the fragment
     // apply color w/ flipped normal
     else
-        fragColor =
-            vec4(phongModel(fragPosWorld, normalize(-fragNormWorld)), 1.f);
+        fragColor = vec4(
+            shade(fragPosWorld, normalize(-fragNormWorld), material), 1.f);
 
     if (wireframe == 1) {
         // find smallest edge distance
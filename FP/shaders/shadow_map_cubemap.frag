@@ -1,5 +1,9 @@
 #version 460
 
+// dual-paraboloid maps only: the paraboloid projection isn't linear, so the
+// interpolated depth would be off between the vertices (the cubemap and the
+// spot map keep the hardware's depth and have no fragment shader at all)
+
 layout(location = 0) in vec3 fragPosWorld;
 
 layout(shared, binding = 1) uniform Light {
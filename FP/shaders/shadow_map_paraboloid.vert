@@ -0,0 +1,37 @@
+#version 460
+
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNorm;
+
+layout(location = 0) out vec3 fragPosWorld;
+
+layout(shared, binding = 0) uniform Scene {
+    mat4 model; // model matrix
+    mat4 viewProjection;
+    mat4 modelViewProjection; // model-view-projection matrix
+    mat4 viewportMatrix;      // viewport matrix
+
+    mat4 shadowViewProjection; // shadow transforms
+
+    float tessLevel; // inner/outer tessellation level
+
+    vec3 eyePos; // eye position in world space
+
+    int wireframe;     // use wireframe rendering
+    int controlPoints; // show control points
+};
+
+void main() {
+    fragPosWorld = (model * vec4(vPos, 1.f)).xyz;
+
+    // shadowViewProjection is just the paraboloid's view matrix here
+    vec3 posLight = (shadowViewProjection * model * vec4(vPos, 1.f)).xyz;
+    float lightDistance = length(posLight);
+    vec3 dir = posLight / lightDistance;
+
+    // throw away everything in the other hemisphere (looking down -Z)
+    gl_ClipDistance[0] = -dir.z;
+
+    // paraboloid projection, depth gets overwritten per fragment anyway
+    gl_Position = vec4(dir.xy / (1.f - dir.z), lightDistance / 1000.f, 1.f);
+}
@@ -0,0 +1,24 @@
+#version 460 core
+
+// screen-space shadow mask: the single-light shadow term (with all of its
+// filtering) for one G-buffer texel out of every divisor x divisor block,
+// drawn at that lower resolution and upsampled by deferred_lighting.frag
+
+layout(location = 0) out float shadowMask; // 1 = fully in shadow
+
+layout(binding = 5) uniform sampler2D gPosition;
+
+// lighting and shadows live in shadow_lighting.frag
+float ShadowCalculation(vec3 fragPosWorld);
+int getShadowMaskDivisor();
+
+void main() {
+    // the G-buffer texel in the middle of our block
+    int divisor = getShadowMaskDivisor();
+    ivec2 texel = min(ivec2(gl_FragCoord.xy) * divisor + divisor / 2,
+                      textureSize(gPosition, 0) - 1);
+
+    // nothing was drawn there, the upsampler won't use it anyway
+    vec4 position = texelFetch(gPosition, texel, 0);
+    shadowMask = position.w == 0.f ? 0.f : ShadowCalculation(position.xyz);
+}
@@ -0,0 +1,23 @@
+#version 460
+
+layout(location = 0) in vec3 fragPosWorld;
+layout(location = 1) flat in int fragLightIndex;
+
+struct PointLight {
+    vec4 position; // xyz = world position, w = radius of influence
+    vec4 color;    // rgb = light color
+
+    mat4 faceViewProjections[6]; // one per cubemap face
+};
+
+layout(std430, binding = 0) readonly buffer PointLights {
+    uint numPointLights;
+    PointLight pointLights[];
+};
+
+void main() {
+    vec4 light = pointLights[fragLightIndex].position;
+
+    // nothing past the radius gets lit, so map [0;radius] onto [0;1]
+    gl_FragDepth = distance(fragPosWorld, light.xyz) / light.w;
+}
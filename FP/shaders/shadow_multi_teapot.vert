@@ -0,0 +1,12 @@
+#version 460 core
+
+layout(location = 0) in vec3 vPos;
+
+layout(location = 0) flat out int lightIndex; // one instance per light
+
+void main() {
+    lightIndex = gl_InstanceID;
+
+    // pass through vertex positions unchanged
+    gl_Position = vec4(vPos, 1.f);
+}
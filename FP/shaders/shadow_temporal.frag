@@ -0,0 +1,31 @@
+#version 460 core
+
+// temporal shadow filtering, first half: a few taps of the shadow filter per
+// pixel, rotated differently for every pixel and every frame
+
+layout(location = 0) out float currentShadow; // noisy shadow term
+
+layout(binding = 5) uniform sampler2D gPosition;
+
+// lighting and shadows live in shadow_lighting.frag
+float temporalShadowTaps(vec3 fragPosWorld, float rotation);
+int getFrameIndex();
+
+// interleaved gradient noise (Jimenez 2014), scrolled a little every frame so
+// neighbouring pixels and consecutive frames get well spread out rotations
+float rotationNoise(vec2 pixel) {
+    pixel += 5.588238f * float(getFrameIndex() % 64);
+    return fract(52.9829189f *
+                 fract(dot(pixel, vec2(0.06711056f, 0.00583715f))));
+}
+
+void main() {
+    vec4 position = texelFetch(gPosition, ivec2(gl_FragCoord.xy), 0);
+    if (position.w == 0.f) {
+        currentShadow = 0.f;
+        return;
+    }
+
+    currentShadow = temporalShadowTaps(
+        position.xyz, 6.2831853f * rotationNoise(floor(gl_FragCoord.xy)));
+}
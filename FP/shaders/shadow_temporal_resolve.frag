@@ -0,0 +1,69 @@
+#version 460 core
+
+// temporal shadow filtering, second half: reproject last frame's history onto
+// this frame's surfaces, clamp it to what this frame's taps around us say is
+// possible, and blend the new taps in (or, for an area light, average this
+// frame's light sample with the previous ones)
+
+// r = accumulated shadow term, g = clip w (view depth) it was accumulated at
+layout(location = 0) out vec2 history;
+
+layout(binding = 5) uniform sampler2D gPosition;
+layout(binding = 13) uniform sampler2D currentShadow;   // shadow_temporal.frag
+layout(binding = 14) uniform sampler2D previousHistory; // last frame's output
+
+// lighting and shadows live in shadow_lighting.frag
+float getHistoryWeight();
+mat4 getPreviousViewProjection();
+mat4 getCameraViewProjection();
+int getAreaLight();
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    vec4 position = texelFetch(gPosition, texel, 0);
+    if (position.w == 0.f) {
+        history = vec2(0.f);
+        return;
+    }
+
+    float current = texelFetch(currentShadow, texel, 0).r;
+
+    // range of this frame's taps around us (on any surface)
+    ivec2 size = textureSize(gPosition, 0);
+    float low = current, high = current;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            ivec2 neighbour = clamp(texel + ivec2(x, y), ivec2(0), size - 1);
+            if (texelFetch(gPosition, neighbour, 0).w == 0.f)
+                continue;
+
+            float tap = texelFetch(currentShadow, neighbour, 0).r;
+            low = min(low, tap);
+            high = max(high, tap);
+        }
+    }
+
+    // where this surface was on screen last frame
+    vec4 previousClip = getPreviousViewProjection() * vec4(position.xyz, 1.f);
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5f + 0.5f;
+
+    float weight = getHistoryWeight();
+    if (previousClip.w <= 0.f || any(lessThan(previousUV, vec2(0.f))) ||
+        any(greaterThan(previousUV, vec2(1.f))))
+        weight = 0.f; // came in from off screen
+
+    vec2 previous = texture(previousHistory, previousUV).rg;
+
+    // something else was there last frame (disocclusion, or a moving caster)
+    if (abs(previous.g - previousClip.w) > 0.02f * previousClip.w)
+        weight = 0.f;
+
+    // an area light's samples are each a different hard shadow, clamping to
+    // this frame's one would throw all the others away
+    float clamped =
+        getAreaLight() == 1 ? previous.r : clamp(previous.r, low, high);
+
+    vec4 currentClip = getCameraViewProjection() * vec4(position.xyz, 1.f);
+    history = vec2(mix(current, clamped, weight), currentClip.w);
+}
@@ -17,6 +17,10 @@ layout(location = 0) out vec4 fragColor; // color to apply to this fragment
 
 uniform samplerCube shadowTex;
 
+// with prefiltering on, the mask gets read this many mip levels down to soften
+// its edges (without it only level 0 exists, so this is a plain lookup)
+const float PREFILTER_LOD = 2.f;
+
 layout(shared, binding = 0) uniform Scene {
     mat4 model; // model matrix
     mat4 viewProjection;
@@ -89,7 +93,7 @@ vec3 phongModel(vec3 fragPosWorld, vec3 fragNormWorld) {
 
     // shadow calculation
     vec3 fragToLight = fragPosWorld - lightPos.xyz;
-    vec3 lit = texture(shadowTex, fragToLight).rgb;
+    float lit = textureLod(shadowTex, fragToLight, PREFILTER_LOD).r;
 
     return (ambient + (1.f - lit) * (diffuse + specular)) / attenuation;
 }
@@ -1,8 +1,9 @@
 #version 460
 
-layout(location = 0) out vec4 fragColor; // color to apply to this fragment
+// the shadow texture is a single channel (R8) mask
+layout(location = 0) out float occluded;
 
 void main() {
     // just draw the occluders as white (everything else should be black)
-    fragColor = vec4(1.f);
+    occluded = 1.f;
 }
@@ -0,0 +1,214 @@
+/**
+ * @file Bvh.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <limits>  // for numeric_limits
+#include <utility> // for swap
+
+#include <glm/common.hpp> // for min, max
+
+#include "Bvh.hpp"
+
+// *****************************************************************************
+// Public
+
+GLuint Bvh::addMesh(const std::vector<vec3>& vertices) {
+    GLuint first{(GLuint)_triangles.size()};
+    GLuint count{(GLuint)(vertices.size() / 3u)};
+
+    for (GLuint i{0u}; i < count; ++i) {
+        const vec3& a{vertices.at(3u * i)};
+        const vec3& b{vertices.at(3u * i + 1u)};
+        const vec3& c{vertices.at(3u * i + 2u)};
+
+        _triangles.push_back(
+            {vec4(a, 0.f), vec4(b - a, 0.f), vec4(c - a, 0.f)});
+        _centroids.push_back((a + b + c) / 3.f);
+    }
+
+    // everything starts out in one leaf
+    GLuint root{(GLuint)_nodes.size()};
+    _nodes.push_back({vec3(0.f), first, vec3(0.f), count});
+
+    _updateBounds(root);
+    _subdivide(root, 0u);
+
+    return root;
+}
+
+const std::vector<Bvh::Node>& Bvh::getNodes() { return _nodes; }
+
+const std::vector<Bvh::Triangle>& Bvh::getTriangles() { return _triangles; }
+
+// *****************************************************************************
+// Private
+
+void Bvh::_updateBounds(const GLuint& nodeIndex) {
+    Node& node{_nodes.at(nodeIndex)};
+
+    node.boundsMin = vec3(std::numeric_limits<GLfloat>::max());
+    node.boundsMax = vec3(std::numeric_limits<GLfloat>::lowest());
+
+    for (GLuint i{node.leftFirst}; i < node.leftFirst + node.triangleCount;
+         ++i) {
+        const Triangle& triangle{_triangles.at(i)};
+        vec3 v0{triangle.v0};
+
+        for (const vec3& v : {v0, v0 + vec3(triangle.edge1),
+                              v0 + vec3(triangle.edge2)}) {
+            node.boundsMin = glm::min(node.boundsMin, v);
+            node.boundsMax = glm::max(node.boundsMax, v);
+        }
+    }
+}
+
+void Bvh::_subdivide(const GLuint& nodeIndex, const GLuint& depth) {
+    /* Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies"
+       (2007) */
+
+    // copy, the node array grows below
+    Node node{_nodes.at(nodeIndex)};
+
+    if (node.triangleCount <= MAX_LEAF_TRIANGLES || depth >= MAX_DEPTH)
+        return;
+
+    // bins are spread over the centroids, not the triangles themselves
+    vec3 centroidMin{std::numeric_limits<GLfloat>::max()};
+    vec3 centroidMax{std::numeric_limits<GLfloat>::lowest()};
+
+    for (GLuint i{node.leftFirst}; i < node.leftFirst + node.triangleCount;
+         ++i) {
+        centroidMin = glm::min(centroidMin, _centroids.at(i));
+        centroidMax = glm::max(centroidMax, _centroids.at(i));
+    }
+
+    GLfloat bestCost{std::numeric_limits<GLfloat>::max()};
+    GLint bestAxis{-1};
+    GLuint bestBin{0u};
+
+    for (GLint axis{0}; axis < 3; ++axis) {
+        GLfloat extent{centroidMax[axis] - centroidMin[axis]};
+        if (extent <= 0.f)
+            continue;
+
+        GLfloat scale{(GLfloat)NUM_BINS / extent};
+
+        vec3 binMin[NUM_BINS], binMax[NUM_BINS];
+        GLuint binCount[NUM_BINS]{0u};
+
+        for (GLuint b{0u}; b < NUM_BINS; ++b) {
+            binMin[b] = vec3(std::numeric_limits<GLfloat>::max());
+            binMax[b] = vec3(std::numeric_limits<GLfloat>::lowest());
+        }
+
+        for (GLuint i{node.leftFirst}; i < node.leftFirst + node.triangleCount;
+             ++i) {
+            GLuint b{glm::min(
+                (GLuint)((_centroids.at(i)[axis] - centroidMin[axis]) * scale),
+                NUM_BINS - 1u)};
+
+            const Triangle& triangle{_triangles.at(i)};
+            vec3 v0{triangle.v0};
+
+            for (const vec3& v : {v0, v0 + vec3(triangle.edge1),
+                                  v0 + vec3(triangle.edge2)}) {
+                binMin[b] = glm::min(binMin[b], v);
+                binMax[b] = glm::max(binMax[b], v);
+            }
+
+            ++binCount[b];
+        }
+
+        // sweep from both ends to get the cost of every plane between bins
+        GLfloat leftArea[NUM_BINS - 1u], rightArea[NUM_BINS - 1u];
+        GLuint leftCount[NUM_BINS - 1u], rightCount[NUM_BINS - 1u];
+
+        vec3 leftMin{std::numeric_limits<GLfloat>::max()},
+            leftMax{std::numeric_limits<GLfloat>::lowest()};
+        vec3 rightMin{leftMin}, rightMax{leftMax};
+        GLuint leftSum{0u}, rightSum{0u};
+
+        for (GLuint b{0u}; b < NUM_BINS - 1u; ++b) {
+            leftSum += binCount[b];
+            leftCount[b] = leftSum;
+            leftMin = glm::min(leftMin, binMin[b]);
+            leftMax = glm::max(leftMax, binMax[b]);
+            leftArea[b] = leftSum > 0u ? _surfaceArea(leftMin, leftMax) : 0.f;
+
+            GLuint r{NUM_BINS - 1u - b};
+            rightSum += binCount[r];
+            rightCount[r - 1u] = rightSum;
+            rightMin = glm::min(rightMin, binMin[r]);
+            rightMax = glm::max(rightMax, binMax[r]);
+            rightArea[r - 1u] =
+                rightSum > 0u ? _surfaceArea(rightMin, rightMax) : 0.f;
+        }
+
+        for (GLuint b{0u}; b < NUM_BINS - 1u; ++b) {
+            GLfloat cost{(GLfloat)leftCount[b] * leftArea[b] +
+                         (GLfloat)rightCount[b] * rightArea[b]};
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    // all centroids in one spot, or splitting doesn't pay off
+    GLfloat leafCost{(GLfloat)node.triangleCount *
+                     _surfaceArea(node.boundsMin, node.boundsMax)};
+    if (bestAxis < 0 || bestCost >= leafCost)
+        return;
+
+    // partition in place, bins up to and including the best one go left
+    GLfloat scale{(GLfloat)NUM_BINS /
+                  (centroidMax[bestAxis] - centroidMin[bestAxis])};
+
+    GLuint i{node.leftFirst}, j{node.leftFirst + node.triangleCount};
+    while (i < j) {
+        GLuint b{glm::min(
+            (GLuint)((_centroids.at(i)[bestAxis] - centroidMin[bestAxis]) *
+                     scale),
+            NUM_BINS - 1u)};
+
+        if (b <= bestBin)
+            ++i;
+        else {
+            --j;
+            std::swap(_triangles.at(i), _triangles.at(j));
+            std::swap(_centroids.at(i), _centroids.at(j));
+        }
+    }
+
+    GLuint leftCount{i - node.leftFirst};
+    if (leftCount == 0u || leftCount == node.triangleCount)
+        return;
+
+    // children are always allocated next to each other
+    GLuint leftChild{(GLuint)_nodes.size()};
+    _nodes.push_back({vec3(0.f), node.leftFirst, vec3(0.f), leftCount});
+    _nodes.push_back(
+        {vec3(0.f), i, vec3(0.f), node.triangleCount - leftCount});
+
+    _nodes.at(nodeIndex).leftFirst = leftChild;
+    _nodes.at(nodeIndex).triangleCount = 0u;
+
+    _updateBounds(leftChild);
+    _updateBounds(leftChild + 1u);
+
+    _subdivide(leftChild, depth + 1u);
+    _subdivide(leftChild + 1u, depth + 1u);
+}
+
+GLfloat Bvh::_surfaceArea(const vec3& boundsMin, const vec3& boundsMax) {
+    vec3 extent{boundsMax - boundsMin};
+    return 2.f * (extent.x * extent.y + extent.y * extent.z +
+                  extent.z * extent.x);
+}
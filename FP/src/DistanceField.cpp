@@ -0,0 +1,366 @@
+/**
+ * @file DistanceField.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <filesystem> // for create_directories
+#include <fstream>    // for ifstream, ofstream
+#include <iostream>   // for cerr
+#include <limits>     // for numeric_limits
+#include <utility>    // for swap
+
+#include <glm/common.hpp>        // for min, max, abs
+#include <glm/geometric.hpp>     // for dot, cross, length
+#include <glm/gtc/constants.hpp> // for pi
+#include <glm/trigonometric.hpp> // for atan
+
+#include "DistanceField.hpp"
+#include "WorkStealingPool.hpp"
+
+// *****************************************************************************
+// Public
+
+DistanceField::DistanceField(const std::vector<vec3>& vertices,
+                             const GLuint& resolution,
+                             const std::string& cachePath)
+    : _resolution{resolution} {
+    GLuint64 hash{_hash(vertices, resolution)};
+
+    if (_load(cachePath, hash)) {
+        _cached = GL_TRUE;
+        return;
+    }
+
+    _bake(vertices);
+    _save(cachePath, hash);
+}
+
+GLuint DistanceField::getResolution() { return _resolution; }
+
+vec3 DistanceField::getBoundsMin() { return _boundsMin; }
+
+vec3 DistanceField::getBoundsMax() { return _boundsMax; }
+
+const std::vector<GLfloat>& DistanceField::getDistances() {
+    return _distances;
+}
+
+GLboolean DistanceField::wasCached() { return _cached; }
+
+// *****************************************************************************
+// Private
+
+void DistanceField::_bake(const std::vector<vec3>& vertices) {
+    _boundsMin = vec3(std::numeric_limits<GLfloat>::max());
+    _boundsMax = vec3(std::numeric_limits<GLfloat>::lowest());
+
+    for (const auto& vertex : vertices) {
+        _boundsMin = glm::min(_boundsMin, vertex);
+        _boundsMax = glm::max(_boundsMax, vertex);
+    }
+
+    vec3 extent{_boundsMax - _boundsMin};
+    GLfloat padding{PADDING * glm::max(extent.x, glm::max(extent.y, extent.z))};
+
+    _boundsMin -= vec3(padding);
+    _boundsMax += vec3(padding);
+
+    _root = _bvh.addMesh(vertices);
+
+    const std::vector<Bvh::Node>& nodes{_bvh.getNodes()};
+    const std::vector<Bvh::Triangle>& triangles{_bvh.getTriangles()};
+
+    // children always come after their parent, so going backwards every
+    // node sees finished children
+    _dipoles.assign(nodes.size(), {vec3(0.f), vec3(0.f), 0.f, 0.f});
+
+    for (GLuint i{(GLuint)nodes.size()}; i-- > _root;) {
+        const Bvh::Node& node{nodes.at(i)};
+        Dipole& dipole{_dipoles.at(i)};
+
+        if (node.triangleCount > 0u) {
+            for (GLuint t{node.leftFirst};
+                 t < node.leftFirst + node.triangleCount; ++t) {
+                const Bvh::Triangle& triangle{triangles.at(t)};
+
+                vec3 normal{glm::cross(vec3(triangle.edge1),
+                                       vec3(triangle.edge2)) *
+                            0.5f};
+                GLfloat area{glm::length(normal)};
+
+                dipole.areaNormal += normal;
+                dipole.center +=
+                    area * (vec3(triangle.v0) +
+                            (vec3(triangle.edge1) + vec3(triangle.edge2)) /
+                                3.f);
+                dipole.area += area;
+            }
+
+            dipole.center = dipole.area > 0.f
+                                ? dipole.center / dipole.area
+                                : (node.boundsMin + node.boundsMax) / 2.f;
+        } else {
+            const Dipole& left{_dipoles.at(node.leftFirst)};
+            const Dipole& right{_dipoles.at(node.leftFirst + 1u)};
+
+            dipole.areaNormal = left.areaNormal + right.areaNormal;
+            dipole.area = left.area + right.area;
+            dipole.center = dipole.area > 0.f
+                                ? (left.center * left.area +
+                                   right.center * right.area) /
+                                      dipole.area
+                                : (node.boundsMin + node.boundsMax) / 2.f;
+        }
+
+        vec3 farthest{glm::max(glm::abs(node.boundsMin - dipole.center),
+                               glm::abs(node.boundsMax - dipole.center))};
+        dipole.radius = glm::length(farthest);
+    }
+
+    _distances.assign((size_t)_resolution * _resolution * _resolution, 0.f);
+
+    vec3 spacing{(_boundsMax - _boundsMin) / (GLfloat)(_resolution - 1u)};
+
+    // the threads only live for the bake
+    WorkStealingPool pool;
+
+    pool.parallelFor(_resolution, [&](GLuint z) {
+        for (GLuint y{0u}; y < _resolution; ++y) {
+            for (GLuint x{0u}; x < _resolution; ++x) {
+                vec3 p{_boundsMin + spacing * vec3((GLfloat)x, (GLfloat)y,
+                                                   (GLfloat)z)};
+
+                // somewhere in between next to a hole in the mesh
+                GLfloat closest{_closestDistance(p)};
+                GLboolean inside{glm::abs(_windingNumber(p)) > 0.5f};
+
+                _distances.at((size_t)x + _resolution * (y + _resolution * z)) =
+                    inside ? -closest : closest;
+            }
+        }
+    });
+}
+
+GLfloat DistanceField::_closestDistance(const vec3& p) {
+    const std::vector<Bvh::Node>& nodes{_bvh.getNodes()};
+    const std::vector<Bvh::Triangle>& triangles{_bvh.getTriangles()};
+
+    // how far p is from a node's bounds (0 inside them)
+    auto boxDistance = [&](const GLuint& index) {
+        const Bvh::Node& node{nodes.at(index)};
+        return glm::length(glm::max(
+            glm::max(node.boundsMin - p, p - node.boundsMax), vec3(0.f)));
+    };
+
+    GLfloat closest{std::numeric_limits<GLfloat>::max()};
+
+    // Bvh::MAX_DEPTH, plus room for the sibling pushed at every level
+    GLuint stack[64];
+    GLuint top{0u};
+    stack[top++] = _root;
+
+    while (top > 0u) {
+        GLuint index{stack[--top]};
+        if (boxDistance(index) >= closest)
+            continue;
+
+        const Bvh::Node& node{nodes.at(index)};
+
+        if (node.triangleCount > 0u) {
+            for (GLuint t{node.leftFirst};
+                 t < node.leftFirst + node.triangleCount; ++t) {
+                const Bvh::Triangle& triangle{triangles.at(t)};
+                vec3 a{triangle.v0};
+
+                closest = glm::min(
+                    closest, _triangleDistance(p, a, a + vec3(triangle.edge1),
+                                               a + vec3(triangle.edge2)));
+            }
+            continue;
+        }
+
+        // the closer child goes on top, so it gets looked at first
+        GLuint near{node.leftFirst}, far{node.leftFirst + 1u};
+        if (boxDistance(far) < boxDistance(near))
+            std::swap(near, far);
+
+        stack[top++] = far;
+        stack[top++] = near;
+    }
+
+    return closest;
+}
+
+GLfloat DistanceField::_windingNumber(const vec3& p) {
+    const std::vector<Bvh::Node>& nodes{_bvh.getNodes()};
+    const std::vector<Bvh::Triangle>& triangles{_bvh.getTriangles()};
+
+    GLfloat solidAngle{0.f};
+
+    GLuint stack[64];
+    GLuint top{0u};
+    stack[top++] = _root;
+
+    while (top > 0u) {
+        GLuint index{stack[--top]};
+        const Bvh::Node& node{nodes.at(index)};
+        const Dipole& dipole{_dipoles.at(index)};
+
+        // far enough away to not care about the individual triangles
+        vec3 toCenter{dipole.center - p};
+        GLfloat distance{glm::length(toCenter)};
+
+        if (node.triangleCount == 0u &&
+            distance > DIPOLE_DISTANCE * dipole.radius) {
+            solidAngle += glm::dot(dipole.areaNormal, toCenter) /
+                          (distance * distance * distance);
+            continue;
+        }
+
+        if (node.triangleCount > 0u) {
+            for (GLuint t{node.leftFirst};
+                 t < node.leftFirst + node.triangleCount; ++t) {
+                const Bvh::Triangle& triangle{triangles.at(t)};
+                vec3 a{triangle.v0};
+
+                solidAngle += _solidAngle(p, a, a + vec3(triangle.edge1),
+                                          a + vec3(triangle.edge2));
+            }
+            continue;
+        }
+
+        stack[top++] = node.leftFirst;
+        stack[top++] = node.leftFirst + 1u;
+    }
+
+    return solidAngle / (4.f * glm::pi<GLfloat>());
+}
+
+GLboolean DistanceField::_load(const std::string& cachePath,
+                               const GLuint64& hash) {
+    std::ifstream fin{cachePath, std::ios::binary};
+    if (!fin)
+        return GL_FALSE;
+
+    GLuint magic{0u}, resolution{0u};
+    GLuint64 storedHash{0u};
+
+    fin.read((char*)&magic, sizeof(magic));
+    fin.read((char*)&storedHash, sizeof(storedHash));
+    fin.read((char*)&resolution, sizeof(resolution));
+
+    if (!fin || magic != CACHE_MAGIC || storedHash != hash ||
+        resolution != _resolution)
+        return GL_FALSE;
+
+    fin.read((char*)&_boundsMin, sizeof(_boundsMin));
+    fin.read((char*)&_boundsMax, sizeof(_boundsMax));
+
+    _distances.resize((size_t)_resolution * _resolution * _resolution);
+    fin.read((char*)_distances.data(),
+             (std::streamsize)(_distances.size() * sizeof(GLfloat)));
+
+    // cut short, bake it again
+    if (!fin) {
+        _distances.clear();
+        return GL_FALSE;
+    }
+
+    return GL_TRUE;
+}
+
+void DistanceField::_save(const std::string& cachePath,
+                          const GLuint64& hash) {
+    std::error_code error;
+    std::filesystem::path path{cachePath};
+
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), error);
+
+    std::ofstream fout{cachePath, std::ios::binary};
+    if (!fout) {
+        // not fatal, it just gets baked again next time
+        std::cerr << "\nCOULD NOT WRITE DISTANCE FIELD CACHE " << cachePath
+                  << std::endl;
+        return;
+    }
+
+    fout.write((const char*)&CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    fout.write((const char*)&hash, sizeof(hash));
+    fout.write((const char*)&_resolution, sizeof(_resolution));
+    fout.write((const char*)&_boundsMin, sizeof(_boundsMin));
+    fout.write((const char*)&_boundsMax, sizeof(_boundsMax));
+    fout.write((const char*)_distances.data(),
+               (std::streamsize)(_distances.size() * sizeof(GLfloat)));
+}
+
+GLuint64 DistanceField::_hash(const std::vector<vec3>& vertices,
+                              const GLuint& resolution) {
+    GLuint64 hash{14695981039346656037ull};
+
+    auto mix = [&hash](const void* data, const size_t& size) {
+        const GLubyte* bytes{(const GLubyte*)data};
+        for (size_t i{0u}; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(&resolution, sizeof(resolution));
+    mix(vertices.data(), vertices.size() * sizeof(vec3));
+
+    return hash;
+}
+
+/* Real-Time Collision Detection (Ericson), 5.1.5 */
+GLfloat DistanceField::_triangleDistance(const vec3& p, const vec3& a,
+                                         const vec3& b, const vec3& c) {
+    vec3 ab{b - a}, ac{c - a}, ap{p - a};
+
+    GLfloat d1{glm::dot(ab, ap)}, d2{glm::dot(ac, ap)};
+    if (d1 <= 0.f && d2 <= 0.f)
+        return glm::length(ap); // vertex a
+
+    vec3 bp{p - b};
+    GLfloat d3{glm::dot(ab, bp)}, d4{glm::dot(ac, bp)};
+    if (d3 >= 0.f && d4 <= d3)
+        return glm::length(bp); // vertex b
+
+    GLfloat vc{d1 * d4 - d3 * d2};
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+        return glm::length(p - (a + d1 / (d1 - d3) * ab)); // edge ab
+
+    vec3 cp{p - c};
+    GLfloat d5{glm::dot(ab, cp)}, d6{glm::dot(ac, cp)};
+    if (d6 >= 0.f && d5 <= d6)
+        return glm::length(cp); // vertex c
+
+    GLfloat vb{d5 * d2 - d1 * d6};
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+        return glm::length(p - (a + d2 / (d2 - d6) * ac)); // edge ac
+
+    GLfloat va{d3 * d6 - d5 * d4};
+    if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f)
+        return glm::length(
+            p - (b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b))); // bc
+
+    // inside the face
+    GLfloat denom{1.f / (va + vb + vc)};
+    return glm::length(p - (a + ab * vb * denom + ac * vc * denom));
+}
+
+GLfloat DistanceField::_solidAngle(const vec3& p, const vec3& a,
+                                   const vec3& b, const vec3& c) {
+    vec3 ra{a - p}, rb{b - p}, rc{c - p};
+    GLfloat la{glm::length(ra)}, lb{glm::length(rb)}, lc{glm::length(rc)};
+
+    GLfloat numerator{glm::dot(ra, glm::cross(rb, rc))};
+    GLfloat denominator{la * lb * lc + glm::dot(ra, rb) * lc +
+                        glm::dot(ra, rc) * lb + glm::dot(rb, rc) * la};
+
+    return 2.f * glm::atan(numerator, denominator);
+}
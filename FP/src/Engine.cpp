@@ -7,24 +7,54 @@
  *        A2 ~ Noisy Teapotahedron
  */
 
+#include <algorithm> // for min, max
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>  // for memcpy
 #include <iomanip>  // for fixed, precision
 #include <iostream> // for cout
+#include <limits>   // for numeric_limits
 #include <sstream>  // for stringstream
 
 #include <glm/gtc/matrix_transform.hpp> // for scale, translate
+#include <glm/gtc/packing.hpp>          // for packSnorm3x10_1x2, packHalf4x16
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp> // for value_ptr
+#include <glm/vector_relational.hpp> // for all, lessThanEqual
+
+// pull in <thread>/<string>, have to come before TeapotData.hpp's macros
+#include "DistanceField.hpp"
+#include "ReferenceTracer.hpp"
 
 #include "TeapotData.hpp"
+#include "VertexCache.hpp"
 
 #include "Engine.hpp"
 
 #define st (size_t)
 static constexpr GLfloat PI = glm::pi<GLfloat>();
 
+// perspective projection for [0;1] clip depth (glClipControl), reversed so
+// depth is 1 at the near plane and falls to 0 at infinity
+static mat4 reversedInfinitePerspective(const GLfloat& fovy,
+                                        const GLfloat& aspect,
+                                        const GLfloat& zNear) {
+    GLfloat f{1.f / glm::tan(fovy / 2.f)};
+
+    mat4 projection{0.f};
+    projection[0][0] = f / aspect;
+    projection[1][1] = f;
+    projection[2][3] = -1.f;  // w = view depth
+    projection[3][2] = zNear; // z = near, so depth = near / view depth
+
+    return projection;
+}
+
+// model matrix of the unit sphere mesh at xyz = center, w = radius
+static mat4 sphereModel(const vec4& sphere) {
+    return glm::scale(glm::translate(mat4(1.f), vec3(sphere)), vec3(sphere.w));
+}
+
 /* https://stackoverflow.com/a/18067245/10323091 */
 void ETB_GL_ERROR_CALLBACK(GLenum source, GLenum type, GLuint id,
                            GLenum severity, GLsizei length,
@@ -60,17 +90,6 @@ void Engine::run() {
 
     // this is the main draw loop
     while (!glfwWindowShouldClose(_window)) {
-        // first pass: render shadow textures to cubemap
-        if (_which_shadows == TEXTURES)
-            _renderShadowTextures();
-        if (_which_shadows == MAPS)
-            _renderShadowMaps();
-
-        glDrawBuffer(GL_BACK); // work with our back frame buffer
-        // clear the current color contents and depth buffer in the window
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-                GL_STENCIL_BUFFER_BIT);
-
         /* Get the size of our framebuffer. Ideally this should be the same
         dimensions as our window, but when using a Retina display the actual
         window can be larger than the requested window. Therefore, query what
@@ -78,21 +97,24 @@ void Engine::run() {
         GLint framebufferWidth, framebufferHeight;
         glfwGetFramebufferSize(_window, &framebufferWidth, &framebufferHeight);
 
-        // define Z range
+        // define Z range (reversed-Z has no far plane, the cascades still
+        // stop at maxZ)
         GLfloat minZ{0.001f}, maxZ{1000.f};
-
-        // update viewport - tell OpenGL we want to render to the whole window
-        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        GLboolean reversedZ{_options(REVERSED_Z)};
 
         /*https://www3.ntu.edu.sg/home/ehchua/programming/opengl/CG_BasicsTheory.html*/
         // manually define viewport transform
         GLfloat w2 = (GLfloat)framebufferWidth / 2.f;
         GLfloat h2 = (GLfloat)framebufferHeight / 2.f;
 
+        // reversed-Z's [0;1] NDC depth goes straight through
+        GLfloat depthScale{reversedZ ? 1.f : maxZ - minZ};
+        GLfloat depthOffset{reversedZ ? 0.f : minZ};
+
         mat4 viewportMatrix{{w2, 0.f, 0.f, 0.f},
                             {0.f, -h2, 0.f, 0.f},
-                            {0.f, 0.f, maxZ - minZ, 0.f},
-                            {w2, h2, minZ, 1.f}};
+                            {0.f, 0.f, depthScale, 0.f},
+                            {w2, h2, depthOffset, 1.f}};
 
         // set up our look at matrix to position our camera
         mat4 viewMatrix{_arcballCam->getViewMatrix()};
@@ -100,14 +122,82 @@ void Engine::run() {
         /* set the projection matrix based on the window size
         use a perspective projection that ranges
         with a FOV of 45 degrees, for our current aspect ratio, and Z ranges
-        from [0.001, 1000]. */
-        mat4 projectionMatrix{glm::perspective(
-            45.f, (GLfloat)framebufferWidth / (GLfloat)framebufferHeight, minZ,
-            maxZ)};
+        from [0.001, 1000] (or [0.001, infinity) with reversed-Z). */
+        GLfloat aspect{(GLfloat)framebufferWidth / (GLfloat)framebufferHeight};
+        mat4 projectionMatrix{
+            reversedZ ? reversedInfinitePerspective(45.f, aspect, minZ)
+                      : glm::perspective(45.f, aspect, minZ, maxZ)};
+
+        // the shadow scheduler wants to know what's on screen
+        _cameraViewProjection = projectionMatrix * viewMatrix;
+
+        // so do the teapot proxies, before any shadow map leaves teapots out
+        _updateTeapotProxies();
+
+        // and the area light, before its cubemap gets rendered
+        if (_areaLightActive())
+            _nextAreaLightSample();
+
+        // first pass: render shadow textures to cubemap
+        if (_which_shadows == TEXTURES)
+            _renderShadowTextures();
+        // (exact and distance field shadows don't need any maps)
+        if (_which_shadows == MAPS && !_exactShadowsActive() &&
+            !_sdfShadowsActive()) {
+            // cascades need to know what the camera can see
+            if (_light_type == DIRECTIONAL)
+                _renderCascadedShadowMaps(viewMatrix, projectionMatrix, minZ,
+                                          maxZ);
+            else if (_light_type == SPOT)
+                _renderSpotShadowMap();
+            else if (_light_type == MULTI_POINT)
+                _renderPointLightShadowMaps(viewMatrix, projectionMatrix,
+                                            (GLfloat)framebufferHeight);
+            else
+                _renderShadowMaps();
+        }
+
+        // bin the point lights (uploaded by their shadow pass) into froxels
+        if (_lightIs(MULTI_POINT))
+            _buildLightClusters(viewMatrix, projectionMatrix, framebufferWidth,
+                                framebufferHeight);
+
+        // work with our back frame buffer (or the camera's own)
+        _bindCameraFramebuffer(framebufferWidth, framebufferHeight);
+
+        // reversed-Z: depth is 1 at the near plane and 0 at infinity, only
+        // for the camera (the shadow passes above keep the usual convention)
+        if (reversedZ) {
+            glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+            glClearDepth(0.0);
+        }
+        glDepthFunc(_cameraDepthFunc());
+
+        // clear the current color contents and depth buffer in the window
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+                GL_STENCIL_BUFFER_BIT);
+
+        // update viewport - tell OpenGL we want to render to the whole window
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
 
         // second pass: draw everything to the window
         _renderScene(viewMatrix, projectionMatrix, viewportMatrix);
 
+        if (reversedZ) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, _cameraFBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glDrawBuffer(GL_BACK);
+            glBlitFramebuffer(0, 0, framebufferWidth, framebufferHeight, 0, 0,
+                              framebufferWidth, framebufferHeight,
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            // back to the usual convention for next frame's shadow passes
+            glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+            glClearDepth(1.0);
+            glDepthFunc(GL_LESS);
+        }
+
         _updateScene();
 
         // flush the OpenGL commands and make sure they get rendered!
@@ -281,6 +371,30 @@ void Engine::handleKeyEvent(GLint key, GLint action) {
             else
                 _turn_on(LINEAR_TEXTURE_FILTER);
             break;
+
+        // toggle mipmapped prefiltering of the shadow textures
+        case GLFW_KEY_F3:
+            if (_options(TEXTURES_PREFILTER))
+                _turn_off(TEXTURES_PREFILTER);
+            else
+                _turn_on(TEXTURES_PREFILTER);
+            break;
+
+        // toggle reversed-Z (float depth, infinite far plane) for the camera
+        case GLFW_KEY_F4:
+            if (_options(REVERSED_Z))
+                _turn_off(REVERSED_Z);
+            else
+                _turn_on(REVERSED_Z);
+            break;
+
+        // toggle picking each sphere's subdivision level from its size
+        case GLFW_KEY_F5:
+            if (_options(SPHERE_LOD))
+                _turn_off(SPHERE_LOD);
+            else
+                _turn_on(SPHERE_LOD);
+            break;
         case GLFW_KEY_6:
             _which_shadows = MAPS;
             break;
@@ -289,6 +403,198 @@ void Engine::handleKeyEvent(GLint key, GLint action) {
                 _doMultisampling = 1;
             else
                 _doMultisampling = 0;
+            break;
+        case GLFW_KEY_8:
+            if (_options(MAPS_DUAL_PARABOLOID))
+                _turn_off(MAPS_DUAL_PARABOLOID);
+            else
+                _turn_on(MAPS_DUAL_PARABOLOID);
+            break;
+
+        // compare cubemap vs. dual-paraboloid shadow pass cost
+        case GLFW_KEY_P:
+            _benchmarkShadowMaps();
+            break;
+
+        // cycle through light types
+        case GLFW_KEY_K:
+            _light_type = (LIGHT_TYPE)((_light_type + 1) % (MULTI_POINT + 1));
+            break;
+
+        // toggle between a cubemap per point light and the shadow atlas
+        case GLFW_KEY_A:
+            if (_options(MAPS_SHADOW_ATLAS))
+                _turn_off(MAPS_SHADOW_ATLAS);
+            else
+                _turn_on(MAPS_SHADOW_ATLAS);
+            break;
+
+        // toggle time-sliced shadow map updates
+        case GLFW_KEY_T:
+            if (_options(MAPS_TIME_SLICED))
+                _turn_off(MAPS_TIME_SLICED);
+            else
+                _turn_on(MAPS_TIME_SLICED);
+            break;
+
+        // shrink/grow the GPU budget for time-sliced shadow map updates
+        case GLFW_KEY_COMMA:
+            _shadowScheduler->setBudget(
+                glm::max(_shadowScheduler->getBudget() - 0.25f, 0.25f));
+            break;
+        case GLFW_KEY_PERIOD:
+            _shadowScheduler->setBudget(_shadowScheduler->getBudget() + 0.25f);
+            break;
+
+        // toggle clustered lighting for the point lights
+        case GLFW_KEY_Y:
+            if (_options(MAPS_CLUSTERED))
+                _turn_off(MAPS_CLUSTERED);
+            else
+                _turn_on(MAPS_CLUSTERED);
+            break;
+
+        // toggle deferred shading for the shadow map receivers
+        case GLFW_KEY_E:
+            if (_options(MAPS_DEFERRED))
+                _turn_off(MAPS_DEFERRED);
+            else
+                _turn_on(MAPS_DEFERRED);
+            break;
+
+        // cycle the screen-space shadow mask between full, 1/2, and 1/4 res
+        case GLFW_KEY_M:
+            _shadowMaskDivisor =
+                _shadowMaskDivisor == 4u ? 1u : _shadowMaskDivisor * 2u;
+            break;
+
+        // toggle filtering only the penumbra tiles
+        case GLFW_KEY_J:
+            if (_options(MAPS_PENUMBRA_TILES))
+                _turn_off(MAPS_PENUMBRA_TILES);
+            else
+                _turn_on(MAPS_PENUMBRA_TILES);
+            break;
+
+        // toggle temporally accumulated shadow filtering
+        case GLFW_KEY_U:
+            if (_options(MAPS_TEMPORAL))
+                _turn_off(MAPS_TEMPORAL);
+            else
+                _turn_on(MAPS_TEMPORAL);
+            break;
+
+        // toggle ray traced shadows
+        case GLFW_KEY_R:
+            if (_options(MAPS_RAY_TRACED))
+                _turn_off(MAPS_RAY_TRACED);
+            else
+                _turn_on(MAPS_RAY_TRACED);
+            break;
+
+        // toggle irregular z-buffer shadows
+        case GLFW_KEY_F1:
+            if (_options(MAPS_IRREGULAR))
+                _turn_off(MAPS_IRREGULAR);
+            else
+                _turn_on(MAPS_IRREGULAR);
+            break;
+
+        // cycle the single light's shadow map depth format (16, 24, 32F),
+        // every depth map gets reallocated before it's rendered next
+        case GLFW_KEY_F2:
+            _shadowDepthFormat =
+                (SHADOW_DEPTH_FORMAT)((_shadowDepthFormat + 1) %
+                                      (DEPTH_32F + 1));
+            _depthCubeMapResolution = _depthParaboloidMapResolution = 0u;
+            _cascadeMapResolution = _spotShadowMapResolution = 0u;
+            break;
+
+        // compare the next frame's shadows against the CPU reference
+        case GLFW_KEY_I:
+            _compareReference = GL_TRUE;
+            break;
+
+        // toggle analytic soft shadows for the spheres
+        case GLFW_KEY_9:
+            if (_options(MAPS_ANALYTIC_SPHERES))
+                _turn_off(MAPS_ANALYTIC_SPHERES);
+            else
+                _turn_on(MAPS_ANALYTIC_SPHERES);
+
+            // the cached cubemap faces have the wrong casters in them now
+            for (GLuint i{0u}; i < 6u; ++i)
+                _faceValid[i] = GL_FALSE;
+            break;
+
+        // toggle ray marched distance field shadows
+        case GLFW_KEY_SLASH:
+            if (_options(MAPS_SDF))
+                _turn_off(MAPS_SDF);
+            else
+                _turn_on(MAPS_SDF);
+            break;
+
+        // cycle the point light between a point, a sphere, and a quad
+        // emitter (whatever the history held was for another light)
+        case GLFW_KEY_BACKSLASH:
+            _areaLightShape =
+                (AREA_LIGHT_SHAPE)((_areaLightShape + 1) % (QUAD_EMITTER + 1));
+            _shadowHistoryValid = GL_FALSE;
+            break;
+
+        // toggle averaging every area light sample (for stills) instead of
+        // only the most recent ones
+        case GLFW_KEY_GRAVE_ACCENT:
+            if (_options(MAPS_AREA_PROGRESSIVE))
+                _turn_off(MAPS_AREA_PROGRESSIVE);
+            else
+                _turn_on(MAPS_AREA_PROGRESSIVE);
+            _shadowHistoryValid = GL_FALSE;
+            break;
+
+        // toggle capsule proxies for the far away teapots (their faces get
+        // invalidated once the proxied set actually changes)
+        case GLFW_KEY_F:
+            if (_options(MAPS_TEAPOT_PROXIES))
+                _turn_off(MAPS_TEAPOT_PROXIES);
+            else
+                _turn_on(MAPS_TEAPOT_PROXIES);
+            break;
+
+        // toggle the depth pre-pass for the main view
+        case GLFW_KEY_D:
+            if (_options(DEPTH_PREPASS))
+                _turn_off(DEPTH_PREPASS);
+            else
+                _turn_on(DEPTH_PREPASS);
+            break;
+
+        // halve/double the number of shadowed point lights
+        case GLFW_KEY_MINUS:
+            _numPointLights = glm::max(_numPointLights / 2u, 1u);
+            break;
+        case GLFW_KEY_EQUAL:
+            _numPointLights = glm::min(_numPointLights * 2u, MAX_POINT_LIGHTS);
+            break;
+
+        // narrow/widen the spot light's cone
+        case GLFW_KEY_SEMICOLON:
+            _spotConeAngle =
+                glm::max(_spotConeAngle - glm::radians(5.f), glm::radians(5.f));
+            break;
+        case GLFW_KEY_APOSTROPHE:
+            _spotConeAngle = glm::min(_spotConeAngle + glm::radians(5.f),
+                                      glm::radians(80.f));
+            break;
+
+        // blend cascade splits between uniform and logarithmic
+        case GLFW_KEY_LEFT_BRACKET:
+            _cascadeSplitLambda = glm::max(_cascadeSplitLambda - 0.05f, 0.f);
+            break;
+        case GLFW_KEY_RIGHT_BRACKET:
+            _cascadeSplitLambda = glm::min(_cascadeSplitLambda + 0.05f, 1.f);
+            break;
         }
     }
 }
@@ -381,6 +687,10 @@ void Engine::_setupOpenGL() {
     glBlendFunc(GL_SRC_ALPHA,
                 GL_ONE_MINUS_SRC_ALPHA); // use one minus blending equation
 
+    // filter across cubemap face edges (the prefiltered shadow textures'
+    // coarse mip levels would show the seams otherwise)
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
     glClearColor(0.f, 0.f, 0.f, 1.f); // clear the frame buffer to black
 
     glFrontFace(GL_CCW); // the front faces are CCW
@@ -536,6 +846,8 @@ void Engine::_setupShaders() {
     _shadowMapShader->compileShader("shaders/gouraud.geom", GL_GEOMETRY_SHADER);
     _shadowMapShader->compileShader("shaders/shadow_map.frag",
                                     GL_FRAGMENT_SHADER);
+    _shadowMapShader->compileShader("shaders/shadow_lighting.frag",
+                                    GL_FRAGMENT_SHADER);
 
     std::cout << "Linking shader program and detaching shader objects ...\n";
 
@@ -555,6 +867,8 @@ void Engine::_setupShaders() {
                                        GL_GEOMETRY_SHADER);
     _shadowMapTesShader->compileShader("shaders/shadow_map.frag",
                                        GL_FRAGMENT_SHADER);
+    _shadowMapTesShader->compileShader("shaders/shadow_lighting.frag",
+                                       GL_FRAGMENT_SHADER);
 
     std::cout << "Linking shader program and detaching shader objects ...\n";
 
@@ -565,10 +879,11 @@ void Engine::_setupShaders() {
 
     std::cout << "Compiling depth cubemap shader program ...\n";
 
+    // no fragment shader, plain hardware depth is all the map keeps (the
+    // cubemap and the spot map both get near/far planes fitted to their
+    // casters, see _fitShadowDepthRange())
     _depthCubemapShader->compileShader("shaders/shadow_map_cubemap.vert",
                                        GL_VERTEX_SHADER);
-    _depthCubemapShader->compileShader("shaders/shadow_map_cubemap.frag",
-                                       GL_FRAGMENT_SHADER);
 
     std::cout << "Linking shader program and detaching shader objects ...\n";
 
@@ -586,877 +901,4190 @@ void Engine::_setupShaders() {
                                           GL_TESS_CONTROL_SHADER);
     _depthCubemapTesShader->compileShader("shaders/shadow_map_cubemap.tese",
                                           GL_TESS_EVALUATION_SHADER);
-    _depthCubemapTesShader->compileShader("shaders/shadow_map_cubemap.frag",
-                                          GL_FRAGMENT_SHADER);
 
     std::cout << "Linking shader program and detaching shader objects ...\n";
 
     _depthCubemapTesShader->linkProgram();
-}
 
-void Engine::_setupBuffers() {
-    std::cout << "Generating buffers ...\n";
+    // setup dual-paraboloid shadow map shader
+    _depthParaboloidShader = new ShaderProgram;
 
-    // generate VAO/VBO/IBO/UBO descriptors
-    glGenVertexArrays(NUM_VAOS, _vaos);
+    std::cout << "Compiling depth paraboloid shader program ...\n";
 
-    glGenBuffers(NUM_VAOS, _vbos);
-    glGenBuffers(NUM_VAOS, _ibos);
+    _depthParaboloidShader->compileShader("shaders/shadow_map_paraboloid.vert",
+                                          GL_VERTEX_SHADER);
+    _depthParaboloidShader->compileShader("shaders/shadow_map_cubemap.frag",
+                                          GL_FRAGMENT_SHADER);
 
-    glGenBuffers(NUM_UBOS, _ubos);
-}
+    std::cout << "Linking shader program and detaching shader objects ...\n";
 
-void Engine::_setupTextures() {
-    // create cubemap textures
-    glGenTextures(1, &_shadowCubeMap);
-    glGenTextures(1, &_depthCubeMap);
+    _depthParaboloidShader->linkProgram();
 
-    // create framebuffer objects to render to
-    glGenFramebuffers(1, &_shadowCubeMapFBO);
-    glGenFramebuffers(1, &_depthCubeMapFBO);
-}
+    // setup dual-paraboloid shadow map shader (w/ tessellation)
+    _depthParaboloidTesShader = new ShaderProgram;
 
-void Engine::_setupScene() {
-    std::cout << "Constructing geometry ...\n";
+    std::cout
+        << "Compiling depth paraboloid shader program (w/ tessellation) ...\n";
 
-    // create scene objects
-    _createPlatform(_vaos[VAO_ID::PLATFORM], _vbos[VAO_ID::PLATFORM],
-                    _ibos[VAO_ID::PLATFORM], _numVAOPoints[VAO_ID::PLATFORM]);
-    _createSphere(_vaos[VAO_ID::SPHERE], _vbos[VAO_ID::SPHERE],
-                  _ibos[VAO_ID::SPHERE], _numVAOPoints[VAO_ID::SPHERE]);
-    _createTeapot(_vaos[VAO_ID::TEAPOT], _vbos[VAO_ID::TEAPOT],
-                  _ibos[VAO_ID::TEAPOT], _numVAOPoints[VAO_ID::TEAPOT]);
+    _depthParaboloidTesShader->compileShader("shaders/teapot.vert",
+                                             GL_VERTEX_SHADER);
+    _depthParaboloidTesShader->compileShader("shaders/teapot.tesc",
+                                             GL_TESS_CONTROL_SHADER);
+    _depthParaboloidTesShader->compileShader(
+        "shaders/shadow_map_paraboloid.tese", GL_TESS_EVALUATION_SHADER);
+    _depthParaboloidTesShader->compileShader("shaders/shadow_map_cubemap.frag",
+                                             GL_FRAGMENT_SHADER);
 
-    std::cout << "Filling GPU uniform buffers ...\n";
+    std::cout << "Linking shader program and detaching shader objects ...\n";
 
-    /* Scene Uniforms */
+    _depthParaboloidTesShader->linkProgram();
 
-    // buffer used for staging data to send to GPU
-    GLubyte* blockBuffer{nullptr};
+    // setup cascaded shadow map shader (layered, all cascades in one pass)
+    _depthCascadeShader = new ShaderProgram;
 
-    // just send identity matrices initially, will get updated in render loop
-    mat4 model{1.f}, viewProjection{1.f}, modelViewProjection{1.f},
-        viewportMatrix{1.f};
-    mat4 shadowViewProjection{1.f};
-    vec3 eyePos{0.f};
+    std::cout << "Compiling depth cascade shader program ...\n";
 
-    // ask the GPU how the block is stored in memory, cache responses
-    _wireShader->queryUniformBlock(
-        "Scene",
-        {"model", "viewProjection", "modelViewProjection", "viewportMatrix",
-         "shadowViewProjection", "tessLevel", "eyePos", "wireframe",
-         "controlPoints"},
-        _blockSizes[UBO_ID::SCENE], _uniformOffsets[UBO_ID::SCENE]);
+    _depthCascadeShader->compileShader("shaders/shadow_layered.vert",
+                                       GL_VERTEX_SHADER);
+    _depthCascadeShader->compileShader("shaders/shadow_map_cascade.geom",
+                                       GL_GEOMETRY_SHADER);
 
-    // set up CPU-side buffer mirroring memory layout on GPU
-    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::SCENE]);
+    std::cout << "Linking shader program and detaching shader objects ...\n";
 
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 0u),
-           &model[st 0u][st 0u], sizeof(mat4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 1u),
-           &viewProjection[st 0u][st 0u], sizeof(mat4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 2u),
-           &modelViewProjection[st 0u][st 0u], sizeof(mat4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 3u),
-           &viewportMatrix[st 0u][st 0u], sizeof(mat4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 4u),
-           &shadowViewProjection[0][0], sizeof(mat4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 5u), &_tessLevel,
-           sizeof(GLfloat));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 6u),
-           &eyePos[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 7u), &_wireframe,
-           sizeof(GLint));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 8u),
-           &_controlPoints, sizeof(GLint));
+    _depthCascadeShader->linkProgram();
 
-    // send buffer to GPU
-    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SCENE]);
-    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::SCENE], blockBuffer,
-                 GL_DYNAMIC_DRAW);
+    // setup cascaded shadow map shader (w/ tessellation)
+    _depthCascadeTesShader = new ShaderProgram;
 
-    free(blockBuffer);
-    blockBuffer = nullptr;
+    std::cout
+        << "Compiling depth cascade shader program (w/ tessellation) ...\n";
 
-    // bind the buffer object to the uniform buffer-binding point at the index
-    // specified by the binding-layout qualifier in the shader
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0u, _ubos[UBO_ID::SCENE]);
+    _depthCascadeTesShader->compileShader("shaders/teapot.vert",
+                                          GL_VERTEX_SHADER);
+    _depthCascadeTesShader->compileShader("shaders/teapot.tesc",
+                                          GL_TESS_CONTROL_SHADER);
+    _depthCascadeTesShader->compileShader("shaders/shadow_layered.tese",
+                                          GL_TESS_EVALUATION_SHADER);
+    _depthCascadeTesShader->compileShader("shaders/shadow_map_cascade.geom",
+                                          GL_GEOMETRY_SHADER);
 
-    /* Light Uniforms */
+    std::cout << "Linking shader program and detaching shader objects ...\n";
 
-    vec3 lightAmb{1.f}, lightDiff{1.f}, lightSpec{1.f}; // white light
-    // attenuation values for distance of 3250
-    GLfloat attenConst{1.f}, attenLin{0.0014f}, attenQuad{0.000007f},
-        shadowBias{0.f}, shadowMapSamples{0.f};
-    GLint doMultisampling{0};
+    _depthCascadeTesShader->linkProgram();
 
-    // ask the GPU how the block is stored in memory, cache responses
-    _wireShader->queryUniformBlock(
-        "Light",
-        {"lightPos", "lightAmb", "lightDiff", "lightSpec", "attenConst",
-         "attenLin", "attenQuad", "shadowBias", "doMultisampling",
-         "shadowMapSamples"},
-        _blockSizes[UBO_ID::LIGHT], _uniformOffsets[UBO_ID::LIGHT]);
+    // setup multi-light shadow map shader (instanced per light, layered per
+    // cubemap face)
+    _depthMultiShader = new ShaderProgram;
 
-    // set up CPU-side buffer mirroring memory layout on GPU
-    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::LIGHT]);
+    std::cout << "Compiling depth multi-light shader program ...\n";
 
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 0u),
-           &light_position[st 0u], sizeof(vec4));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 1u),
-           &lightAmb[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 2u),
-           &lightDiff[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 3u),
-           &lightSpec[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 4u), &attenConst,
-           sizeof(GLfloat));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 5u), &attenLin,
-           sizeof(GLfloat));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 6u), &attenQuad,
-           sizeof(GLfloat));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(7), &shadowBias,
-           sizeof shadowBias);
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(8), &doMultisampling,
-           sizeof doMultisampling);
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(9),
-           &shadowMapSamples, sizeof shadowMapSamples);
+    _depthMultiShader->compileShader("shaders/shadow_multi.vert",
+                                     GL_VERTEX_SHADER);
+    _depthMultiShader->compileShader("shaders/shadow_multi.geom",
+                                     GL_GEOMETRY_SHADER);
+    _depthMultiShader->compileShader("shaders/shadow_multi.frag",
+                                     GL_FRAGMENT_SHADER);
 
-    // send buffer to GPU
-    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::LIGHT]);
-    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::LIGHT], blockBuffer,
-                 GL_DYNAMIC_DRAW);
+    std::cout << "Linking shader program and detaching shader objects ...\n";
 
-    free(blockBuffer);
-    blockBuffer = nullptr;
+    _depthMultiShader->linkProgram();
 
-    // bind the buffer object to the uniform buffer-binding point at the index
-    // specified by the binding-layout qualifier in the shader
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1u, _ubos[UBO_ID::LIGHT]);
+    // setup multi-light shadow map shader (w/ tessellation)
+    _depthMultiTesShader = new ShaderProgram;
 
-    /* Material Uniforms */
+    std::cout
+        << "Compiling depth multi-light shader program (w/ tessellation) ...\n";
+
+    _depthMultiTesShader->compileShader("shaders/shadow_multi_teapot.vert",
+                                        GL_VERTEX_SHADER);
+    _depthMultiTesShader->compileShader("shaders/shadow_multi.tesc",
+                                        GL_TESS_CONTROL_SHADER);
+    _depthMultiTesShader->compileShader("shaders/shadow_multi.tese",
+                                        GL_TESS_EVALUATION_SHADER);
+    _depthMultiTesShader->compileShader("shaders/shadow_multi.geom",
+                                        GL_GEOMETRY_SHADER);
+    _depthMultiTesShader->compileShader("shaders/shadow_multi.frag",
+                                        GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _depthMultiTesShader->linkProgram();
+
+    // setup shadow atlas shader (same as multi-light, but every face goes to
+    // its own tile of a 2D texture instead of a cubemap array layer)
+    _depthAtlasShader = new ShaderProgram;
+
+    std::cout << "Compiling depth atlas shader program ...\n";
+
+    _depthAtlasShader->compileShader("shaders/shadow_multi.vert",
+                                     GL_VERTEX_SHADER);
+    _depthAtlasShader->compileShader("shaders/shadow_atlas.geom",
+                                     GL_GEOMETRY_SHADER);
+    _depthAtlasShader->compileShader("shaders/shadow_multi.frag",
+                                     GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _depthAtlasShader->linkProgram();
+
+    // setup shadow atlas shader (w/ tessellation)
+    _depthAtlasTesShader = new ShaderProgram;
+
+    std::cout << "Compiling depth atlas shader program (w/ tessellation) ...\n";
+
+    _depthAtlasTesShader->compileShader("shaders/shadow_multi_teapot.vert",
+                                        GL_VERTEX_SHADER);
+    _depthAtlasTesShader->compileShader("shaders/shadow_multi.tesc",
+                                        GL_TESS_CONTROL_SHADER);
+    _depthAtlasTesShader->compileShader("shaders/shadow_multi.tese",
+                                        GL_TESS_EVALUATION_SHADER);
+    _depthAtlasTesShader->compileShader("shaders/shadow_atlas.geom",
+                                        GL_GEOMETRY_SHADER);
+    _depthAtlasTesShader->compileShader("shaders/shadow_multi.frag",
+                                        GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _depthAtlasTesShader->linkProgram();
+
+    // setup light clustering compute shader
+    _clusterShader = new ShaderProgram;
+
+    std::cout << "Compiling light clustering compute shader program ...\n";
+
+    _clusterShader->compileShader("shaders/cluster_lights.comp",
+                                  GL_COMPUTE_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _clusterShader->linkProgram();
+
+    // setup G-buffer shader
+    _gBufferShader = new ShaderProgram;
+
+    std::cout << "Compiling G-buffer shader program ...\n";
+
+    _gBufferShader->compileShader("shaders/gouraud.vert", GL_VERTEX_SHADER);
+    _gBufferShader->compileShader("shaders/gouraud.geom", GL_GEOMETRY_SHADER);
+    _gBufferShader->compileShader("shaders/gbuffer.frag", GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _gBufferShader->linkProgram();
+
+    // setup G-buffer shader (w/ tessellation)
+    _gBufferTesShader = new ShaderProgram;
+
+    std::cout << "Compiling G-buffer shader program (w/ tessellation) ...\n";
+
+    _gBufferTesShader->compileShader("shaders/teapot.vert", GL_VERTEX_SHADER);
+    _gBufferTesShader->compileShader("shaders/teapot.tesc",
+                                     GL_TESS_CONTROL_SHADER);
+    _gBufferTesShader->compileShader("shaders/teapot.tese",
+                                     GL_TESS_EVALUATION_SHADER);
+    _gBufferTesShader->compileShader("shaders/gouraud.geom",
+                                     GL_GEOMETRY_SHADER);
+    _gBufferTesShader->compileShader("shaders/gbuffer.frag",
+                                     GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _gBufferTesShader->linkProgram();
+
+    // setup deferred lighting shader
+    _deferredLightingShader = new ShaderProgram;
+
+    std::cout << "Compiling deferred lighting shader program ...\n";
+
+    _deferredLightingShader->compileShader("shaders/fullscreen.vert",
+                                           GL_VERTEX_SHADER);
+    _deferredLightingShader->compileShader("shaders/deferred_lighting.frag",
+                                           GL_FRAGMENT_SHADER);
+    _deferredLightingShader->compileShader("shaders/deferred_shadow.frag",
+                                           GL_FRAGMENT_SHADER);
+    _deferredLightingShader->compileShader("shaders/shadow_lighting.frag",
+                                           GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _deferredLightingShader->linkProgram();
+
+    // setup depth pre-pass shader (same vertex stage as the shading pass)
+    _depthPrepassShader = new ShaderProgram;
+
+    std::cout << "Compiling depth pre-pass shader program ...\n";
+
+    _depthPrepassShader->compileShader("shaders/gouraud.vert",
+                                       GL_VERTEX_SHADER);
+    _depthPrepassShader->compileShader("shaders/depth_prepass.frag",
+                                       GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _depthPrepassShader->linkProgram();
+
+    // setup depth pre-pass shader (w/ tessellation, at the same level)
+    _depthPrepassTesShader = new ShaderProgram;
+
+    std::cout
+        << "Compiling depth pre-pass shader program (w/ tessellation) ...\n";
+
+    _depthPrepassTesShader->compileShader("shaders/teapot.vert",
+                                          GL_VERTEX_SHADER);
+    _depthPrepassTesShader->compileShader("shaders/teapot.tesc",
+                                          GL_TESS_CONTROL_SHADER);
+    _depthPrepassTesShader->compileShader("shaders/teapot.tese",
+                                          GL_TESS_EVALUATION_SHADER);
+    _depthPrepassTesShader->compileShader("shaders/depth_prepass.frag",
+                                          GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _depthPrepassTesShader->linkProgram();
+
+    // setup screen-space shadow mask shader
+    _shadowMaskShader = new ShaderProgram;
+
+    std::cout << "Compiling shadow mask shader program ...\n";
+
+    _shadowMaskShader->compileShader("shaders/fullscreen.vert",
+                                     GL_VERTEX_SHADER);
+    _shadowMaskShader->compileShader("shaders/shadow_mask.frag",
+                                     GL_FRAGMENT_SHADER);
+    _shadowMaskShader->compileShader("shaders/shadow_lighting.frag",
+                                     GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _shadowMaskShader->linkProgram();
+
+    // setup penumbra classification shader
+    _penumbraClassifyShader = new ShaderProgram;
+
+    std::cout << "Compiling penumbra classification shader program ...\n";
+
+    _penumbraClassifyShader->compileShader("shaders/fullscreen.vert",
+                                           GL_VERTEX_SHADER);
+    _penumbraClassifyShader->compileShader("shaders/penumbra_classify.frag",
+                                           GL_FRAGMENT_SHADER);
+    _penumbraClassifyShader->compileShader("shaders/shadow_lighting.frag",
+                                           GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _penumbraClassifyShader->linkProgram();
+
+    // setup penumbra filter shader
+    _penumbraFilterShader = new ShaderProgram;
+
+    std::cout << "Compiling penumbra filter shader program ...\n";
+
+    _penumbraFilterShader->compileShader("shaders/penumbra_tile.vert",
+                                         GL_VERTEX_SHADER);
+    _penumbraFilterShader->compileShader("shaders/penumbra_filter.frag",
+                                         GL_FRAGMENT_SHADER);
+    _penumbraFilterShader->compileShader("shaders/shadow_lighting.frag",
+                                         GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _penumbraFilterShader->linkProgram();
+
+    // setup temporal shadow taps shader
+    _temporalTapsShader = new ShaderProgram;
+
+    std::cout << "Compiling temporal shadow taps shader program ...\n";
+
+    _temporalTapsShader->compileShader("shaders/fullscreen.vert",
+                                       GL_VERTEX_SHADER);
+    _temporalTapsShader->compileShader("shaders/shadow_temporal.frag",
+                                       GL_FRAGMENT_SHADER);
+    _temporalTapsShader->compileShader("shaders/shadow_lighting.frag",
+                                       GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _temporalTapsShader->linkProgram();
+
+    // setup temporal shadow resolve shader
+    _temporalResolveShader = new ShaderProgram;
+
+    std::cout << "Compiling temporal shadow resolve shader program ...\n";
+
+    _temporalResolveShader->compileShader("shaders/fullscreen.vert",
+                                          GL_VERTEX_SHADER);
+    _temporalResolveShader->compileShader(
+        "shaders/shadow_temporal_resolve.frag", GL_FRAGMENT_SHADER);
+    _temporalResolveShader->compileShader("shaders/shadow_lighting.frag",
+                                          GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _temporalResolveShader->linkProgram();
+
+    // setup ray traced shadow shader
+    _rayTraceShader = new ShaderProgram;
+
+    std::cout << "Compiling ray traced shadow shader program ...\n";
+
+    _rayTraceShader->compileShader("shaders/shadow_raytrace.comp",
+                                   GL_COMPUTE_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _rayTraceShader->linkProgram();
+
+    // setup irregular z-buffer shaders
+    _irregularInsertShader = new ShaderProgram;
+
+    std::cout << "Compiling irregular z-buffer insert shader program ...\n";
+
+    _irregularInsertShader->compileShader(
+        "shaders/shadow_irregular_insert.comp", GL_COMPUTE_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _irregularInsertShader->linkProgram();
+
+    _irregularTestShader = new ShaderProgram;
+
+    std::cout << "Compiling irregular z-buffer test shader program ...\n";
+
+    _irregularTestShader->compileShader("shaders/shadow_irregular_test.comp",
+                                        GL_COMPUTE_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _irregularTestShader->linkProgram();
+
+    // setup shadow capture shader (same shadow term as the lighting pass)
+    _shadowCaptureShader = new ShaderProgram;
+
+    std::cout << "Compiling shadow capture shader program ...\n";
+
+    _shadowCaptureShader->compileShader("shaders/fullscreen.vert",
+                                        GL_VERTEX_SHADER);
+    _shadowCaptureShader->compileShader("shaders/shadow_capture.frag",
+                                        GL_FRAGMENT_SHADER);
+    _shadowCaptureShader->compileShader("shaders/deferred_shadow.frag",
+                                        GL_FRAGMENT_SHADER);
+    _shadowCaptureShader->compileShader("shaders/shadow_lighting.frag",
+                                        GL_FRAGMENT_SHADER);
+
+    std::cout << "Linking shader program and detaching shader objects ...\n";
+
+    _shadowCaptureShader->linkProgram();
+}
+
+void Engine::_setupBuffers() {
+    std::cout << "Generating buffers ...\n";
+
+    // generate VAO/VBO/IBO/UBO descriptors
+    glGenVertexArrays(NUM_VAOS, _vaos);
+
+    glGenBuffers(NUM_VAOS, _vbos);
+    glGenBuffers(NUM_VAOS, _ibos);
+
+    glGenBuffers(NUM_UBOS, _ubos);
+
+    glGenBuffers(1, &_pointLightSSBO);
+    glGenBuffers(1, &_shadowTileSSBO);
+    glGenBuffers(1, &_clusterSSBO);
+    glGenBuffers(1, &_penumbraTileSSBO);
+    glGenBuffers(1, &_penumbraCountBuffer);
+    glGenBuffers(1, &_bvhNodeSSBO);
+    glGenBuffers(1, &_bvhTriangleSSBO);
+    glGenBuffers(1, &_rayInstanceSSBO);
+    glGenBuffers(1, &_sphereOccluderSSBO);
+    glGenBuffers(1, &_capsuleOccluderSSBO);
+    glGenBuffers(1, &_fieldInstanceSSBO);
+    glGenBuffers(1, &_irregularGridSSBO);
+    glGenBuffers(1, &_irregularNodeSSBO);
+
+    glGenVertexArrays(1, &_fullscreenVAO);
+}
+
+void Engine::_setupTextures() {
+    // create cubemap textures
+    glGenTextures(1, &_shadowCubeMap);
+    glGenTextures(1, &_depthCubeMap);
+
+    // create dual-paraboloid and cascade texture arrays
+    glGenTextures(1, &_depthParaboloidMap);
+    glGenTextures(1, &_cascadeMap);
+
+    // create spot light depth map
+    glGenTextures(1, &_spotShadowMap);
+
+    // create point light cubemap array and shadow atlas
+    glGenTextures(1, &_pointShadowMaps);
+    glGenTextures(1, &_shadowAtlasMap);
+
+    // create framebuffer objects to render to
+    glGenFramebuffers(1, &_shadowCubeMapFBO);
+    glGenFramebuffers(1, &_depthCubeMapFBO);
+    glGenFramebuffers(1, &_depthParaboloidMapFBO);
+    glGenFramebuffers(1, &_cascadeMapFBO);
+    glGenFramebuffers(1, &_spotShadowMapFBO);
+    glGenFramebuffers(1, &_pointShadowMapsFBO);
+    glGenFramebuffers(1, &_shadowAtlasFBO);
+
+    // create G-buffer attachments (allocated at the window size on first use)
+    glGenTextures(NUM_GBUFFER_TEXTURES, _gBufferTextures);
+    glGenRenderbuffers(1, &_gBufferDepth);
+    glGenFramebuffers(1, &_gBufferFBO);
+
+    // create the camera's own framebuffer for reversed-Z (allocated at the
+    // window size on first use)
+    glGenRenderbuffers(1, &_cameraColor);
+    glGenRenderbuffers(1, &_cameraDepth);
+    glGenFramebuffers(1, &_cameraFBO);
+
+    // create screen-space shadow mask
+    glGenTextures(1, &_shadowMask);
+    glGenFramebuffers(1, &_shadowMaskFBO);
+
+    // create penumbra tile classes and filtered shadows
+    glGenTextures(1, &_penumbraClass);
+    glGenTextures(1, &_penumbraShadow);
+    glGenFramebuffers(1, &_penumbraClassFBO);
+    glGenFramebuffers(1, &_penumbraShadowFBO);
+
+    // create temporal shadow taps and history
+    glGenTextures(1, &_temporalTaps);
+    glGenTextures(2, _shadowHistory);
+    glGenFramebuffers(1, &_temporalTapsFBO);
+    glGenFramebuffers(2, _shadowHistoryFBO);
+
+    // create ray traced shadows (written as an image, no framebuffer)
+    glGenTextures(1, &_rayTracedShadow);
+
+    // create irregular z-buffer shadows (also written as an image)
+    glGenTextures(1, &_irregularShadow);
+
+    // create captured shadow term for the reference comparison
+    glGenTextures(1, &_shadowCapture);
+    glGenFramebuffers(1, &_shadowCaptureFBO);
+
+    // create distance fields (filled once by _bakeDistanceFields())
+    glGenTextures(1, &_distanceFields);
+}
+
+void Engine::_setupScene() {
+    std::cout << "Constructing geometry ...\n";
+
+    // create scene objects
+    _createPlatform(_vaos[VAO_ID::PLATFORM], _vbos[VAO_ID::PLATFORM],
+                    _ibos[VAO_ID::PLATFORM], _numVAOPoints[VAO_ID::PLATFORM]);
+    _createSphere(_vaos[VAO_ID::SPHERE], _vbos[VAO_ID::SPHERE],
+                  _ibos[VAO_ID::SPHERE], _numVAOPoints[VAO_ID::SPHERE]);
+    _createTeapot(_vaos[VAO_ID::TEAPOT], _vbos[VAO_ID::TEAPOT],
+                  _ibos[VAO_ID::TEAPOT], _numVAOPoints[VAO_ID::TEAPOT]);
+
+    std::cout << "Filling GPU uniform buffers ...\n";
+
+    /* Scene Uniforms */
+
+    // buffer used for staging data to send to GPU
+    GLubyte* blockBuffer{nullptr};
+
+    // just send identity matrices initially, will get updated in render loop
+    mat4 model{1.f}, viewProjection{1.f}, modelViewProjection{1.f},
+        viewportMatrix{1.f};
+    mat4 shadowViewProjection{1.f};
+    vec3 eyePos{0.f};
+
+    // ask the GPU how the block is stored in memory, cache responses
+    _wireShader->queryUniformBlock(
+        "Scene",
+        {"model", "viewProjection", "modelViewProjection", "viewportMatrix",
+         "shadowViewProjection", "tessLevel", "eyePos", "wireframe",
+         "controlPoints"},
+        _blockSizes[UBO_ID::SCENE], _uniformOffsets[UBO_ID::SCENE]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::SCENE]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 0u),
+           &model[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 1u),
+           &viewProjection[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 2u),
+           &modelViewProjection[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 3u),
+           &viewportMatrix[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 4u),
+           &shadowViewProjection[0][0], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 5u), &_tessLevel,
+           sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 6u),
+           &eyePos[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 7u), &_wireframe,
+           sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SCENE].at(st 8u),
+           &_controlPoints, sizeof(GLint));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SCENE]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::SCENE], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0u, _ubos[UBO_ID::SCENE]);
+
+    /* Light Uniforms */
+
+    vec3 lightAmb{1.f}, lightDiff{1.f}, lightSpec{1.f}; // white light
+    // attenuation values for distance of 3250
+    GLfloat attenConst{1.f}, attenLin{0.0014f}, attenQuad{0.000007f},
+        shadowBias{0.f}, shadowMapSamples{0.f};
+    GLint doMultisampling{0};
+
+    // ask the GPU how the block is stored in memory, cache responses
+    _wireShader->queryUniformBlock(
+        "Light",
+        {"lightPos", "lightAmb", "lightDiff", "lightSpec", "attenConst",
+         "attenLin", "attenQuad", "shadowBias", "doMultisampling",
+         "shadowMapSamples"},
+        _blockSizes[UBO_ID::LIGHT], _uniformOffsets[UBO_ID::LIGHT]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::LIGHT]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 0u),
+           &light_position[st 0u], sizeof(vec4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 1u),
+           &lightAmb[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 2u),
+           &lightDiff[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 3u),
+           &lightSpec[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 4u), &attenConst,
+           sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 5u), &attenLin,
+           sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(st 6u), &attenQuad,
+           sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(7), &shadowBias,
+           sizeof shadowBias);
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(8), &doMultisampling,
+           sizeof doMultisampling);
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::LIGHT].at(9),
+           &shadowMapSamples, sizeof shadowMapSamples);
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::LIGHT]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::LIGHT], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1u, _ubos[UBO_ID::LIGHT]);
+
+    /* Material Uniforms */
+
+    // just send white material initially, will get updated in render loop
+    vec3 materialAmb{1.f}, materialDiff{1.f}, materialSpec{1.f};
+    GLfloat shininess{64.f}; // that's pretty shiny ig
+
+    // ask the GPU how the block is stored in memory, cache responses
+    _wireShader->queryUniformBlock(
+        "Material",
+        {"materialAmb", "materialDiff", "materialSpec", "shininess"},
+        _blockSizes[UBO_ID::MATERIAL], _uniformOffsets[UBO_ID::MATERIAL]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::MATERIAL]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 0u),
+           &materialAmb[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 1u),
+           &materialDiff[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 2u),
+           &materialSpec[st 0u], sizeof(vec3));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 3u),
+           &shininess, sizeof(GLfloat));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::MATERIAL]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::MATERIAL], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 2u, _ubos[UBO_ID::MATERIAL]);
+
+    /* Shadow Uniforms */
+
+    mat4 lightView{1.f}, cameraView{1.f};
+    GLint shadowProjection{SHADOW_PROJECTION::CUBEMAP};
+    GLint shadowMaskDivisor{0}, penumbraTileSize{0}, temporalTaps{0},
+        frameIndex{0};
+    GLfloat historyWeight{0.f};
+    GLint rayTracedShadows{0}, sdfShadows{0};
+    vec4 areaLightSample{0.f};
+
+    for (GLuint i{0u}; i < NUM_CASCADES; ++i) {
+        _cascadeViewProjections[i] = mat4(1.f);
+        _cascadeSplits[i] = _cascadeDepthRanges[i] = 1.f;
+    }
+
+    for (GLuint i{0u}; i < NUM_SHADOW_DEPTH_RANGES; ++i)
+        _shadowDepthRanges[i] = vec4(0.001f, 1'000.f, 0.f, 0.f);
+
+    // only the shadow map programs declare this block (std140, so the array
+    // strides are known ahead of time)
+    _shadowMapShader->queryUniformBlock(
+        "Shadow",
+        {"lightView", "shadowProjection", "cameraView",
+         "cascadeViewProjections[0]", "cascadeSplits", "cascadeDepthRanges",
+         "shadowMaskDivisor", "penumbraTileSize", "previousViewProjection",
+         "temporalTaps", "frameIndex", "historyWeight",
+         "rayTracedShadows", "sdfShadows", "areaLightSample",
+         "shadowDepthRanges[0]"},
+        _blockSizes[UBO_ID::SHADOW], _uniformOffsets[UBO_ID::SHADOW]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::SHADOW]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 0u),
+           &lightView[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 1u),
+           &shadowProjection, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 2u),
+           &cameraView[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 3u),
+           _cascadeViewProjections, sizeof(_cascadeViewProjections));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 4u),
+           _cascadeSplits, sizeof(_cascadeSplits));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 5u),
+           _cascadeDepthRanges, sizeof(_cascadeDepthRanges));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 6u),
+           &shadowMaskDivisor, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 7u),
+           &penumbraTileSize, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 8u),
+           &lightView[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 9u),
+           &temporalTaps, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 10u),
+           &frameIndex, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 11u),
+           &historyWeight, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 12u),
+           &rayTracedShadows, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 13u),
+           &sdfShadows, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 14u),
+           &areaLightSample[st 0u], sizeof(vec4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 15u),
+           _shadowDepthRanges, sizeof(_shadowDepthRanges));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SHADOW]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::SHADOW], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 3u, _ubos[UBO_ID::SHADOW]);
+
+    /* Spot Uniforms */
+
+    mat4 spotViewProjection{1.f};
+    vec4 spotDirection{0.f, -1.f, 0.f, 0.f};
+    GLfloat spotCosOuter{glm::cos(_spotConeAngle)}, spotCosInner{1.f};
+
+    // only the shadow map programs declare this block
+    _shadowMapShader->queryUniformBlock(
+        "Spot",
+        {"spotViewProjection", "spotDirection", "spotCosOuter",
+         "spotCosInner"},
+        _blockSizes[UBO_ID::SPOT_CONE], _uniformOffsets[UBO_ID::SPOT_CONE]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::SPOT_CONE]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 0u),
+           &spotViewProjection[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 1u),
+           &spotDirection[st 0u], sizeof(vec4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 2u),
+           &spotCosOuter, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 3u),
+           &spotCosInner, sizeof(GLfloat));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SPOT_CONE]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::SPOT_CONE], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 4u, _ubos[UBO_ID::SPOT_CONE]);
+
+    /* Cluster Uniforms */
+
+    mat4 clusterView{1.f}, inverseProjection{1.f};
+    glm::uvec4 clusterGrid{CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0u};
+    vec2 screenSize{_windowWidth, _windowHeight};
+    GLfloat clusterNear{CLUSTER_NEAR}, clusterFar{CLUSTER_FAR};
+    GLint clusteredLighting{0};
+
+    // only the shadow map programs (and the cluster compute pass) declare
+    // this block
+    _shadowMapShader->queryUniformBlock(
+        "Cluster",
+        {"clusterView", "inverseProjection", "clusterGrid", "screenSize",
+         "clusterNear", "clusterFar", "clusteredLighting"},
+        _blockSizes[UBO_ID::CLUSTER], _uniformOffsets[UBO_ID::CLUSTER]);
+
+    // set up CPU-side buffer mirroring memory layout on GPU
+    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::CLUSTER]);
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 0u),
+           &clusterView[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 1u),
+           &inverseProjection[st 0u][st 0u], sizeof(mat4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 2u),
+           &clusterGrid[st 0u], sizeof(glm::uvec4));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 3u),
+           &screenSize[st 0u], sizeof(vec2));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 4u),
+           &clusterNear, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 5u),
+           &clusterFar, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 6u),
+           &clusteredLighting, sizeof(GLint));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::CLUSTER]);
+    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::CLUSTER], blockBuffer,
+                 GL_DYNAMIC_DRAW);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    // bind the buffer object to the uniform buffer-binding point at the index
+    // specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_UNIFORM_BUFFER, 5u, _ubos[UBO_ID::CLUSTER]);
+
+    /* Point Light Storage */
+
+    // room for the most lights we'll ever have, the count is updated along
+    // with the lights every frame
+    GLuint numPointLights{0u};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _pointLightSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 POINT_LIGHTS_HEADER_SIZE +
+                     MAX_POINT_LIGHTS * sizeof(PointLight),
+                 NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint),
+                    &numPointLights);
+
+    // binding point specified by the binding-layout qualifier in the shader
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0u, _pointLightSSBO);
+
+    // scheduler starts out with a 1 ms budget for the cubemap faces
+    _shadowScheduler = new ShadowScheduler(1.f);
+    glGenQueries(1, &_shadowTimerQuery);
+
+    // no light faces have atlas tiles yet
+    _shadowAtlas = new ShadowAtlas(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE);
+    _faceTiles.assign(6u * MAX_POINT_LIGHTS, vec4(0.f));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _shadowTileSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, _faceTiles.size() * sizeof(vec4),
+                 _faceTiles.data(), GL_DYNAMIC_DRAW);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1u, _shadowTileSSBO);
+
+    // every cluster has a light count followed by room for every light, so
+    // the compute pass never has to worry about running out of space
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _clusterSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z *
+                     (MAX_POINT_LIGHTS + 1u) * sizeof(GLuint),
+                 NULL, GL_DYNAMIC_COPY);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2u, _clusterSSBO);
+
+    // room for every sphere, none of them are shadowed analytically yet
+    const GLuint noSpheres[4]{0u, 0u, 0u, 0u};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _sphereOccluderSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 SPHERE_OCCLUDERS_HEADER_SIZE +
+                     MAX_SPHERE_OCCLUDERS * sizeof(vec4),
+                 NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(noSpheres),
+                    noSpheres);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7u, _sphereOccluderSSBO);
+
+    /* Teapot Proxies */
+
+    _fitTeapotProxies();
+
+    // room for every teapot's capsules, every teapot is in the shadow map yet
+    const GLuint noCapsules[4]{0u, 0u, 0u, 0u};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _capsuleOccluderSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 CAPSULE_OCCLUDERS_HEADER_SIZE +
+                     4u * NUM_TEAPOT_PROXIES * 2u * sizeof(vec4),
+                 NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(noCapsules),
+                    noCapsules);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8u, _capsuleOccluderSSBO);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+    /* Ray Tracing Storage */
+
+    _buildRayTracingBvh();
+    glGenQueries(1, &_rayTimerQuery);
+
+    /* Distance Field Storage */
+
+    _bakeDistanceFields();
+
+    /* Irregular Z-Buffer */
+
+    // room for every face's list heads, filled in every frame
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _irregularGridSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 IRREGULAR_GRID_HEADER_SIZE + 6u * IRREGULAR_RESOLUTION *
+                                                  IRREGULAR_RESOLUTION *
+                                                  sizeof(GLuint),
+                 NULL, GL_DYNAMIC_DRAW);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10u, _irregularGridSSBO);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0u); // unbind uniform buffers from staging
+
+    // set up camera
+    std::cout << "Setting up arcball camera ...\n";
+
+    _arcballCam = new ArcballCam(); // use default values
+
+    // shouldn't need to do this manually, but there's a black frame at start of
+    // rendering if I don't :(
+    _arcballCam->setLookAtPoint(EYE_CENTER);
+    _arcballCam->setUpVector(vec3(0.f, 1.f, 0.f));
+}
+
+void Engine::_printSetupInfo() {
+    // request OpenGL driver info
+    const GLubyte* renderer{glGetString(GL_RENDERER)};
+    const GLubyte* vendor{glGetString(GL_VENDOR)};
+    const GLubyte* version{glGetString(GL_VERSION)};
+    const GLubyte* glslVersion{glGetString(GL_SHADING_LANGUAGE_VERSION)};
+
+    // request GL version
+    GLint major, minor;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+    std::cout << "GL Vendor            : " << vendor << '\n';
+    std::cout << "GL Renderer          : " << renderer << '\n';
+    std::cout << "GL Version (string)  : " << version << '\n';
+    std::cout << "GL Version (integer) : " << major << '.' << minor << '\n';
+    std::cout << "GLSL Version         : " << glslVersion << '\n';
+}
+
+// *****************************************************************************
+// Engine Cleanup
+
+void Engine::_cleanupGLFW() {
+    std::cout << "Shutting down GLFW ...\n";
+
+    glfwDestroyWindow(_window);
+    _window = nullptr;
+
+    glfwTerminate();
+}
+
+void Engine::_cleanupShaders() {
+    std::cout << "Deleting shader programs ...\n";
+
+    delete _wireShader;
+    _wireShader = nullptr;
+
+    delete _wireTesShader;
+    _wireTesShader = nullptr;
+
+    delete _flatShader;
+    _flatShader = nullptr;
+
+    delete _flatLightShader;
+    _flatLightShader = nullptr;
+
+    delete _teapotPlanarShadowShader;
+    _teapotPlanarShadowShader = nullptr;
+
+    delete _spherePlanarShadowShader;
+    _spherePlanarShadowShader = nullptr;
+
+    delete _shadowTextureCubemapShader;
+    _shadowTextureCubemapShader = nullptr;
+
+    delete _shadowTextureCubemapTesShader;
+    _shadowTextureCubemapTesShader = nullptr;
+
+    delete _shadowTextureShader;
+    _shadowTextureShader = nullptr;
+
+    delete _shadowMapShader;
+    _shadowMapShader = nullptr;
+
+    delete _shadowMapTesShader;
+    _shadowMapTesShader = nullptr;
+
+    delete _depthCubemapShader;
+    _depthCubemapShader = nullptr;
+
+    delete _depthCubemapTesShader;
+    _depthCubemapTesShader = nullptr;
+
+    delete _depthParaboloidShader;
+    _depthParaboloidShader = nullptr;
+
+    delete _depthParaboloidTesShader;
+    _depthParaboloidTesShader = nullptr;
+
+    delete _depthCascadeShader;
+    _depthCascadeShader = nullptr;
+
+    delete _depthCascadeTesShader;
+    _depthCascadeTesShader = nullptr;
+
+    delete _depthMultiShader;
+    _depthMultiShader = nullptr;
+
+    delete _depthMultiTesShader;
+    _depthMultiTesShader = nullptr;
+
+    delete _depthAtlasShader;
+    _depthAtlasShader = nullptr;
+
+    delete _depthAtlasTesShader;
+    _depthAtlasTesShader = nullptr;
+
+    delete _clusterShader;
+    _clusterShader = nullptr;
+
+    delete _gBufferShader;
+    _gBufferShader = nullptr;
+
+    delete _gBufferTesShader;
+    _gBufferTesShader = nullptr;
+
+    delete _deferredLightingShader;
+    _deferredLightingShader = nullptr;
+
+    delete _depthPrepassShader;
+    _depthPrepassShader = nullptr;
+
+    delete _depthPrepassTesShader;
+    _depthPrepassTesShader = nullptr;
+
+    delete _shadowMaskShader;
+    _shadowMaskShader = nullptr;
+
+    delete _penumbraClassifyShader;
+    _penumbraClassifyShader = nullptr;
+
+    delete _penumbraFilterShader;
+    _penumbraFilterShader = nullptr;
+
+    delete _temporalTapsShader;
+    _temporalTapsShader = nullptr;
+
+    delete _temporalResolveShader;
+    _temporalResolveShader = nullptr;
+
+    delete _rayTraceShader;
+    _rayTraceShader = nullptr;
+
+    delete _irregularInsertShader;
+    _irregularInsertShader = nullptr;
+
+    delete _irregularTestShader;
+    _irregularTestShader = nullptr;
+
+    delete _shadowCaptureShader;
+    _shadowCaptureShader = nullptr;
+}
+
+void Engine::_cleanupBuffers() {
+    std::cout << "Deleting GPU buffers ...\n";
+
+    glDeleteVertexArrays(NUM_VAOS, _vaos);
+
+    glDeleteBuffers(NUM_VAOS, _vbos);
+    glDeleteBuffers(NUM_VAOS, _ibos);
+
+    glDeleteBuffers(NUM_UBOS, _ubos);
+
+    glDeleteBuffers(1, &_pointLightSSBO);
+    glDeleteBuffers(1, &_shadowTileSSBO);
+    glDeleteBuffers(1, &_clusterSSBO);
+    glDeleteBuffers(1, &_penumbraTileSSBO);
+    glDeleteBuffers(1, &_penumbraCountBuffer);
+    glDeleteSync(_penumbraCountFence);
+    glDeleteBuffers(1, &_bvhNodeSSBO);
+    glDeleteBuffers(1, &_bvhTriangleSSBO);
+    glDeleteBuffers(1, &_rayInstanceSSBO);
+    glDeleteBuffers(1, &_sphereOccluderSSBO);
+    glDeleteBuffers(1, &_capsuleOccluderSSBO);
+    glDeleteBuffers(1, &_fieldInstanceSSBO);
+    glDeleteBuffers(1, &_irregularGridSSBO);
+    glDeleteBuffers(1, &_irregularNodeSSBO);
+
+    glDeleteVertexArrays(1, &_fullscreenVAO);
+}
+
+void Engine::_cleanupScene() {
+    std::cout << "Deleting camera ...\n";
+
+    delete _arcballCam;
+
+    delete _shadowAtlas;
+
+    delete _shadowScheduler;
+    glDeleteQueries(1, &_shadowTimerQuery);
+
+    delete _bvh;
+    glDeleteQueries(1, &_rayTimerQuery);
+
+    delete _referenceTracer;
+}
+
+// *****************************************************************************
+// Engine Rendering & Updating
+
+Engine::SceneInstances Engine::_sceneInstances(const GLfloat& angleOffset) {
+    SceneInstances scene;
+
+    // teapots and spheres take turns around the inner ring, every other teapot
+    // sitting higher up
+    for (GLuint i{0u}; i < 4u; ++i) {
+        GLfloat angle{angleOffset + (GLfloat)i * PI / 2.f};
+
+        mat4 model{glm::translate(mat4(1.f),
+                                  circlePos(9.f, angle, i % 2u ? 1.5f : 0.5f))};
+        model = glm::rotate(model, PI / -2.f, {1.f, 0.f, 0.f});
+        model = glm::rotate(model, ((GLfloat)i + 1.f) * (PI / 2.f),
+                            {0.f, 0.f, 1.f});
+
+        scene.teapots.push_back(model);
+        scene.spheres.push_back(
+            vec4(circlePos(9.f, angle + PI / 4.f, 1.1f), 1.f));
+    }
+
+    // the outer ring never spins
+    for (GLuint i{0u}; i < 8u; ++i)
+        scene.outerRing.push_back(
+            vec4(circlePos(20.f, (GLfloat)i * PI / 4.f, 1.6f), 1.5f));
+
+    return scene;
+}
+
+void Engine::_renderScene(const mat4& viewMatrix, const mat4& projectionMatrix,
+                          const mat4& viewportMatrix) {
+    // if shader program is null, do not continue to prevent run time errors
+    if (!_wireShader || !_wireTesShader || !_flatShader)
+        return;
+
+    // send light properties
+    vec3 lightAmb{1.f}, lightDiff{1.f}, lightSpec{1.f}; // white light
+    /* https://learnopengl.com/Lighting/Light-casters */
+    // attenuation values for distance of 160
+    GLfloat attenConst{1.f}, attenLin{0.027f}, attenQuad{0.0028f};
+
+    // a directional light is sent as a direction (w = 0) toward the sun
+    if (_lightIs(DIRECTIONAL))
+        _sendLightBlock(vec4(-_sunDirection(), 0.f), lightAmb, lightDiff,
+                        lightSpec, attenConst, attenLin, attenQuad);
+    else
+        _sendLightBlock(light_position, lightAmb, lightDiff, lightSpec,
+                        attenConst, attenLin, attenQuad);
+
+    // spheres might be shadowed by the receivers rather than the map
+    _updateSphereOccluders();
+
+    // or everything might be, through the distance fields
+    if (_sdfShadowsActive()) {
+        _updateFieldInstances();
+
+        glActiveTexture(GL_TEXTURE15);
+        glBindTexture(GL_TEXTURE_3D, _distanceFields);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // tell the shadow map receivers which layout to sample
+    if (_lightIs(DIRECTIONAL)) {
+        _sendShadowBlock(mat4(1.f), viewMatrix, SHADOW_PROJECTION::CASCADES);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, _cascadeMap);
+        glActiveTexture(GL_TEXTURE0);
+    } else if (_lightIs(SPOT)) {
+        _sendShadowBlock(mat4(1.f), viewMatrix, SHADOW_PROJECTION::SPOT_MAP);
+        _sendSpotBlock(_spotViewProjection(), _spotDirection(), _spotConeAngle,
+                       _spotFalloff);
+
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, _spotShadowMap);
+        glActiveTexture(GL_TEXTURE0);
+    } else if (_lightIs(MULTI_POINT) && _options(MAPS_SHADOW_ATLAS)) {
+        // the lights and tile rects were uploaded by the shadow pass
+        _sendShadowBlock(mat4(1.f), viewMatrix,
+                         SHADOW_PROJECTION::SHADOW_ATLAS);
+
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, _shadowAtlasMap);
+        glActiveTexture(GL_TEXTURE0);
+    } else if (_lightIs(MULTI_POINT)) {
+        // the lights themselves were uploaded by the shadow pass
+        _sendShadowBlock(mat4(1.f), viewMatrix,
+                         SHADOW_PROJECTION::CUBEMAP_ARRAY);
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, _pointShadowMaps);
+        glActiveTexture(GL_TEXTURE0);
+    } else if (_options(MAPS_DUAL_PARABOLOID)) {
+        _sendShadowBlock(_paraboloidLightView(), viewMatrix,
+                         SHADOW_PROJECTION::DUAL_PARABOLOID);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, _depthParaboloidMap);
+        glActiveTexture(GL_TEXTURE0);
+    } else
+        _sendShadowBlock(mat4(1.f), viewMatrix, SHADOW_PROJECTION::CUBEMAP);
+
+    // deferred: the receivers only fill the G-buffer, lighting comes after
+    GLboolean deferred{_which_shadows == MAPS && _options(MAPS_DEFERRED)};
+    ShaderProgram* receiverShader{_shadowMapShader};
+    ShaderProgram* receiverTesShader{_shadowMapTesShader};
+
+    if (deferred) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        _bindGBuffer(viewport[2], viewport[3]);
+
+        receiverShader = _gBufferShader;
+        receiverTesShader = _gBufferTesShader;
+    }
+
+    // matrices to use for setting object transformations
+    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
+    mat4 viewProjection{projectionMatrix * viewMatrix};
+    mat4 shadowViewProjections{1.f};
+    vec3 eyePos{_arcballCam->getPosition()};
+
+    // vectors to use for setting object materials
+    vec3 materialAmb{0.f}, materialDiff{0.f}, materialSpec{0.f};
+    GLfloat shininess{0.f};
+
+    // where everything is this frame
+    SceneInstances scene{_sceneInstances(_angle_offset)};
+
+    // depth pre-pass: the shadowed receivers below only shade the closest
+    // surface of each pixel
+    GLboolean depthPrepass{
+        _options(DEPTH_PREPASS) &&
+        (_which_shadows == TEXTURES || _which_shadows == MAPS)};
+
+    if (depthPrepass) {
+        _renderDepthPrepass(viewMatrix, projectionMatrix, viewportMatrix,
+                            scene);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    /* Drawing the Platform */
+
+    if (_which_shadows == TEXTURES) {
+        _shadowTextureShader->useProgram();
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+    } else if (_which_shadows == MAPS) {
+        receiverShader->useProgram();
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+    } else
+        _wireShader->useProgram();
+
+    if (_which_shadows == PLANAR && _options(PLANAR_STENCIL_TEST)) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xffff);
+        glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
+    }
+
+    // compute and send transformation matrices
+    model = glm::scale(mat4(1.f), vec3(100.f));
+
+    modelView = viewMatrix * model;
+    modelViewProjection = projectionMatrix * modelView;
+
+    _sendSceneBlock(model, viewProjection, modelViewProjection, viewportMatrix,
+                    shadowViewProjections, eyePos);
+
+    // send material properties
+    materialAmb = materialDiff = vec3{0.2f, 0.1f, 0.7f}; // bluish
+    materialSpec = vec3{1.f};                            // white
+    shininess = 64.f;                                    // pwetty shiny uwu
+
+    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+    _drawPlatform(); // draw the platform
+
+    /* Drawing planar projection of teapot onto the platform */
+
+    if (_which_shadows == PLANAR) {
+        glDisable(GL_CULL_FACE);
+
+        if (_options(PLANAR_DEPTH_TEST))
+            glDisable(GL_DEPTH_TEST);
+
+        if (_options(PLANAR_STENCIL_TEST)) {
+            // glDisable(GL_DEPTH_TEST);
+            glStencilFunc(GL_EQUAL, 1, 0xffff);
+            glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
+        }
+
+        // send material properties
+        if (_options(PLANAR_BLEND))
+            shininess = 0.5f; // using this as alpha value
+        else
+            shininess = 1.f;
+
+        _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+        _teapotPlanarShadowShader->useProgram();
+        for (std::size_t i{0}; i < scene.teapots.size(); ++i) {
+            model = scene.teapots.at(i);
+
+            modelView = viewMatrix * model;
+            modelViewProjection = projectionMatrix * modelView;
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections, eyePos);
+
+            _drawTeapot();
+        }
+
+        // flattened shadows get the level of the sphere casting them
+        _spherePlanarShadowShader->useProgram();
+        for (std::size_t i{0}; i < scene.spheres.size(); ++i) {
+            model = sphereModel(scene.spheres.at(i));
+
+            modelView = viewMatrix * model;
+            modelViewProjection = projectionMatrix * modelView;
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections, eyePos);
+
+            _drawSphere(1, _sphereLod(0u, i, vec3(scene.spheres.at(i)),
+                                      scene.spheres.at(i).w, viewProjection));
+        }
+
+        if (_outerRing) {
+            for (std::size_t i{0}; i < scene.outerRing.size(); ++i) {
+                model = sphereModel(scene.outerRing.at(i));
+
+                modelView = viewMatrix * model;
+                modelViewProjection = projectionMatrix * modelView;
+
+                _sendSceneBlock(model, viewProjection, modelViewProjection,
+                                viewportMatrix, shadowViewProjections, eyePos);
+
+                _drawSphere(1, _sphereLod(0u, 4u + i,
+                                          vec3(scene.outerRing.at(i)),
+                                          scene.outerRing.at(i).w,
+                                          viewProjection));
+            }
+        }
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_STENCIL_TEST);
+    }
+
+    /* Drawing the teapots */
+
+    if (_which_shadows == MAPS) {
+        receiverTesShader->useProgram();
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+    } else
+        _wireTesShader->useProgram();
+
+    // send material properties
+    materialAmb = materialDiff = {0.4f, 0.f, 0.6f}; // purplish
+    materialSpec = vec3{1.f};                       // white
+    shininess = 64.f;                               // weeeee big specular
+
+    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+    for (std::size_t i{0}; i < scene.teapots.size(); ++i) {
+        model = scene.teapots.at(i);
+
+        modelView = viewMatrix * model;
+        modelViewProjection = projectionMatrix * modelView;
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, shadowViewProjections, eyePos);
+
+        _drawTeapot();
+    }
+
+    /* Drawing the spheres */
+
+    if (_which_shadows == MAPS) {
+        receiverShader->useProgram();
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+    } else
+        _wireShader->useProgram();
+
+    // send material properties
+    materialAmb = materialDiff = {1.f, 0.078f, 0.576f}; // pink!
+    materialSpec = vec3{1.f};                           // white
+    shininess = 64.f;                                   // :o shinnne
+
+    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+    for (std::size_t i{0}; i < scene.spheres.size(); ++i) {
+        model = sphereModel(scene.spheres.at(i));
+
+        modelView = viewMatrix * model;
+        modelViewProjection = projectionMatrix * modelView;
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, shadowViewProjections, eyePos);
+
+        _drawSphere(1, _sphereLod(0u, i, vec3(scene.spheres.at(i)),
+                                  scene.spheres.at(i).w, viewProjection));
+    }
+
+    // outer ring of unmoving circles
+    if (_outerRing) {
+        if (_which_shadows == TEXTURES) {
+            _shadowTextureShader->useProgram();
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+
+        } else if (_which_shadows == MAPS) {
+            receiverShader->useProgram();
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+        } else
+            _wireShader->useProgram();
+
+        materialAmb = materialDiff = {0.f, 0.9804f, 0.6039f}; // pale green?
+
+        _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+        for (std::size_t i{0}; i < scene.outerRing.size(); ++i) {
+            model = sphereModel(scene.outerRing.at(i));
+
+            modelView = viewMatrix * model;
+            modelViewProjection = projectionMatrix * modelView;
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections, eyePos);
+
+            _drawSphere(1, _sphereLod(0u, 4u + i, vec3(scene.outerRing.at(i)),
+                                      scene.outerRing.at(i).w, viewProjection));
+        }
+    }
+
+    if (_which_shadows == TEXTURES)
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    if (_which_shadows == MAPS)
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    if (depthPrepass) {
+        glDepthFunc(_cameraDepthFunc());
+        glDepthMask(GL_TRUE);
+    }
+
+    // light and shadow whatever the receivers left in the G-buffer
+    if (deferred)
+        _renderDeferredLighting();
+
+    /* Drawing the light */
+
+    _flatLightShader->useProgram();
+    // _wireShader->useProgram();
+
+    // send material properties
+    materialAmb = materialDiff = {1.f, 1.f, 1.f}; // white privilege
+    materialSpec = vec3{1.f};                     // white light buh duh buh duh
+    shininess = 128.f;                            // even shinier ooOOoo
+
+    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+    // every point light gets its own marker in its own color
+    if (_lightIs(MULTI_POINT)) {
+        for (std::size_t i{0}; i < _pointLights.size(); ++i) {
+            const auto& light{_pointLights.at(i)};
+            materialAmb = materialDiff = vec3(light.color);
+
+            _sendMaterialBlock(materialAmb, materialDiff, materialSpec,
+                               shininess);
+
+            model = glm::translate(mat4(1.f), vec3(light.position));
+            model = glm::scale(model, vec3(0.1f));
+
+            modelView = viewMatrix * model;
+            modelViewProjection = projectionMatrix * modelView;
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections, eyePos);
+
+            _drawSphere(1, _sphereLod(0u, 12u + i, vec3(light.position), 0.1f,
+                                      viewProjection));
+        }
+    } else {
+        // compute and send transformation matrices (the sun sits far up the
+        // direction it shines from)
+        if (_lightIs(DIRECTIONAL))
+            model =
+                glm::translate(mat4(1.f), EYE_CENTER - 30.f * _sunDirection());
+        else
+            model = glm::translate(mat4(1.f), vec3(light_position.x,
+                                                   light_position.y,
+                                                   light_position.z));
+        model = glm::scale(model, vec3(0.1f));
+
+        modelView = viewMatrix * model;
+        modelViewProjection = projectionMatrix * modelView;
+        // normalMtx = glm::transpose(glm::inverse(modelView));
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, shadowViewProjections, eyePos);
+
+        _drawSphere(1, _sphereLod(0u, 12u, vec3(model[3]), 0.1f,
+                                  viewProjection));
+    }
+
+    /* Drawing the teapot control points */
+
+    // _flatShader->useProgram();
+    // // _wireShader->useProgram();
+
+    // // send material properties
+    // materialAmb = materialDiff = {0.f, 1.f, 0.f}; // oooo so green
+    // materialSpec = vec3{1.f};                     // white
+    // shininess = 128.f;                            // even shinier ooOOoo
+
+    // _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+
+    // // TODO: use instanced rendering for this (maybe that would even be fast
+    // // enough to go back to actually shading the spheres instead of using
+    // flat
+    // // shader)
+    // for (size_t i{st 0u}; i < TEAPOT_NUM_VERTICES; ++i) {
+    //     // compute and send transformation matrices
+    //     model = glm::translate(mat4(1.f), {0.f, 1.f, 0.f});
+    //     model = glm::rotate(model, glm::pi<GLfloat>() / -2.f, {1.f, 0.f,
+    //     0.f}); model = glm::translate(model, teapot_cp_vertices[i]); model =
+    //     glm::scale(model, vec3(0.03f));
+
+    //     modelView = viewMatrix * model;
+    //     modelViewProjection = projectionMatrix * modelView;
+    //     // normalMtx = glm::transpose(glm::inverse(modelView));
+
+    //     _sendSceneBlock(model, viewProjection, modelViewProjection,
+    //                     viewportMatrix, eyePos);
+
+    //     _drawSphere();
+    // }
+}
+
+void Engine::_renderDepthPrepass(
+    const mat4& viewMatrix, const mat4& projectionMatrix,
+    const mat4& viewportMatrix, const SceneInstances& scene) {
+    // the transforms have to be the ones _renderScene() uses, or the depths
+    // won't match under GL_EQUAL
+    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
+    mat4 viewProjection{projectionMatrix * viewMatrix};
+    vec3 eyePos{_arcballCam->getPosition()};
+
+    // depth only
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    _depthPrepassShader->useProgram();
+
+    // the platform
+    model = glm::scale(mat4(1.f), vec3(100.f));
+
+    modelView = viewMatrix * model;
+    modelViewProjection = projectionMatrix * modelView;
+
+    _sendSceneBlock(model, viewProjection, modelViewProjection, viewportMatrix,
+                    mat4(1.f), eyePos);
+
+    _drawPlatform();
+
+    // the spheres (and outer ring), at the same levels as the shading pass
+    for (std::size_t i{0}; i < scene.spheres.size(); ++i) {
+        model = sphereModel(scene.spheres.at(i));
+
+        modelView = viewMatrix * model;
+        modelViewProjection = projectionMatrix * modelView;
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, mat4(1.f), eyePos);
+
+        _drawSphere(1, _sphereLod(0u, i, vec3(scene.spheres.at(i)),
+                                  scene.spheres.at(i).w, viewProjection));
+    }
+
+    if (_outerRing) {
+        for (std::size_t i{0}; i < scene.outerRing.size(); ++i) {
+            model = sphereModel(scene.outerRing.at(i));
+
+            modelView = viewMatrix * model;
+            modelViewProjection = projectionMatrix * modelView;
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, mat4(1.f), eyePos);
+
+            _drawSphere(1, _sphereLod(0u, 4u + i, vec3(scene.outerRing.at(i)),
+                                      scene.outerRing.at(i).w, viewProjection));
+        }
+    }
+
+    // the teapots, at the same tessellation level as the shading pass
+    _depthPrepassTesShader->useProgram();
+
+    for (std::size_t i{0}; i < scene.teapots.size(); ++i) {
+        model = scene.teapots.at(i);
+
+        modelView = viewMatrix * model;
+        modelViewProjection = projectionMatrix * modelView;
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, mat4(1.f), eyePos);
+
+        _drawTeapot();
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void Engine::_renderShadowTextures() {
+    // assign a texture image to each face of the cubemap
+    glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+
+    // a single channel is all the covered/uncovered mask needs (only
+    // reallocate when the resolution actually changes)
+    if (_shadowCubeMapResolution != SHADOW_TEXTURE_RESOLUTION) {
+        for (GLuint i = 0; i < 6u; ++i) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_R8,
+                         SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION,
+                         0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        }
+
+        _shadowCubeMapResolution = SHADOW_TEXTURE_RESOLUTION;
+    }
+
+    // prefiltering builds the mip chain after the faces are drawn, and the
+    // receivers read a blurrier level of it (see shadow_texture.frag);
+    // otherwise level 0 is all they ever see
+    GLboolean prefilter{_options(TEXTURES_PREFILTER)};
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL,
+                    prefilter ? 1'000 : 0);
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
+                        prefilter ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
+                        prefilter ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // each face uses the same projection matrix
+    mat4 shadowProjection =
+        glm::perspective(glm::radians(90.f), 1.f, 0.001f, 1'000.f);
+
+    // faces use different view matrices (right, left, top, bottom, near, far)
+    vec3 lightPos = vec3(light_position);
+
+    std::vector<mat4> shadowViewProjections{
+        glm::lookAt(lightPos, lightPos + vec3(1.f, 0.f, 0.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(-1.f, 0.f, 0.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 1.f, 0.f),
+                    vec3(0.f, 0.f, 1.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, -1.f, 0.f),
+                    vec3(0.f, 0.f, -1.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, 1.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, -1.f),
+                    vec3(0.f, -1.f, 0.f))};
+
+    for (auto& m : shadowViewProjections)
+        m = shadowProjection * m;
+
+    // rendering code below
+
+    // matrices to use for setting object transformations
+    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
+    mat4 viewProjection{1.f}, viewportMatrix{1.f};
+    vec3 eyePos{lightPos};
+
+    // where everything is this frame
+    SceneInstances scene{_sceneInstances(_angle_offset)};
+
+    for (std::size_t i{0}; i < 6u; ++i) {
+        // attach the texture to the framebuffer object
+        glBindFramebuffer(GL_FRAMEBUFFER, _shadowCubeMapFBO);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+        glViewport(0, 0, SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                               _shadowCubeMap, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "\nSHADOW CUBEMAP FRAMEBUFFER IS BROKEN!!"
+                      << std::endl;
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+                GL_STENCIL_BUFFER_BIT);
+
+        /* Drawing the spheres */
+        _shadowTextureCubemapShader->useProgram();
+
+        for (std::size_t j{0}; j < scene.spheres.size(); ++j) {
+            model = sphereModel(scene.spheres.at(j));
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections.at(i),
+                            eyePos);
+
+            _drawSphere(1, _sphereLod(1u + i, j, vec3(scene.spheres.at(j)),
+                                      scene.spheres.at(j).w,
+                                      shadowViewProjections.at(i)));
+        }
+
+        /* Drawing the teapots */
+        _shadowTextureCubemapTesShader->useProgram();
+
+        for (std::size_t j{0}; j < scene.teapots.size(); ++j) {
+            model = scene.teapots.at(j);
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjections.at(i),
+                            eyePos);
+
+            _drawTeapot();
+        }
+    }
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // box-filter the mask down, every level blurs the edges twice as wide
+    if (prefilter) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    }
+}
+
+void Engine::_renderShadowMaps() {
+    /* https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows */
+
+    if (_options(MAPS_DUAL_PARABOLOID)) {
+        _renderDualParaboloidMaps();
+        return;
+    }
+
+    // cull front faces to fix peter-panning
+    if (_options(MAPS_CULL_FRONT_FACE))
+        glCullFace(GL_FRONT);
+
+    // assign a texture image to each face of the cubemap
+    glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+
+    // the area light renders a whole cubemap every frame, but only a coarse
+    // one (the samples average out its blockiness)
+    GLuint resolution{_areaLightActive() ? AREA_LIGHT_SHADOW_RESOLUTION
+                                         : SHADOW_TEXTURE_RESOLUTION};
+
+    // only reallocate when the resolution actually changes
+    if (_depthCubeMapResolution != resolution) {
+        for (GLuint i = 0; i < 6u; ++i) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
+                         _shadowDepthInternalFormat(), resolution, resolution,
+                         0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        }
+
+        _depthCubeMapResolution = resolution;
+
+        // nothing to keep from the old faces
+        for (GLuint i{0u}; i < 6u; ++i)
+            _faceValid[i] = GL_FALSE;
+    }
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // each face uses the same projection matrix (only for deciding which
+    // faces to render, each one gets its own near/far planes when it is)
+    mat4 shadowProjection =
+        glm::perspective(glm::radians(90.f), 1.f, 0.001f, 1'000.f);
+
+    // faces use different view matrices (right, left, top, bottom, near, far)
+    // (seen from this frame's point on the area light, if there is one)
+    vec3 lightPos =
+        _areaLightActive() ? _areaLightSample : vec3(light_position);
+
+    // the direction each of them looks in
+    const vec3 faceAxes[6]{{1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f},
+                           {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f},
+                           {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+
+    std::vector<mat4> shadowViewProjections{
+        glm::lookAt(lightPos, lightPos + vec3(1.f, 0.f, 0.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(-1.f, 0.f, 0.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 1.f, 0.f),
+                    vec3(0.f, 0.f, 1.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, -1.f, 0.f),
+                    vec3(0.f, 0.f, -1.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, 1.f),
+                    vec3(0.f, -1.f, 0.f)),
+        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, -1.f),
+                    vec3(0.f, -1.f, 0.f))};
+
+    std::vector<mat4> shadowViews{shadowViewProjections};
+
+    for (auto& m : shadowViewProjections)
+        m = shadowProjection * m;
+
+    // by default every face gets re-rendered every frame (always, for the
+    // area light, since every frame has moved to another point on it)
+    std::vector<GLboolean> renderFace(6u, GL_TRUE);
+    GLboolean timeSliced{_options(MAPS_TIME_SLICED) && !_areaLightActive()};
+
+    if (timeSliced) {
+        // read back how long last frame's faces took (without stalling)
+        if (_shadowTimerPending) {
+            GLint available{0};
+            glGetQueryObjectiv(_shadowTimerQuery, GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+
+            if (available) {
+                GLuint64 elapsed{0u};
+                glGetQueryObjectui64v(_shadowTimerQuery, GL_QUERY_RESULT,
+                                      &elapsed);
+
+                _shadowScheduler->reportCost((GLfloat)elapsed / 1.0e6f,
+                                             _shadowTimerFaces);
+                _shadowTimerPending = GL_FALSE;
+            }
+        }
+
+        // only faces that changed compete for the budget
+        for (GLuint i{0u}; i < 6u; ++i) {
+            GLfloat priority{
+                _shadowFacePriority(i, shadowViewProjections.at(i))};
+
+            if (priority > 0.f)
+                _shadowScheduler->submit(i, priority);
+        }
+
+        renderFace.assign(6u, GL_FALSE);
+        for (const auto& face : _shadowScheduler->schedule())
+            renderFace.at(face) = GL_TRUE;
+    }
+
+    // only one timer in flight at a time
+    GLboolean timeFaces{timeSliced && !_shadowTimerPending};
+    GLuint facesRendered{0u};
+
+    if (timeFaces)
+        glBeginQuery(GL_TIME_ELAPSED, _shadowTimerQuery);
+
+    // rendering code below
+
+    for (std::size_t i{0}; i < 6u; ++i) {
+        // skipped faces keep last frame's contents
+        if (!renderFace.at(i))
+            continue;
+
+        // attach the texture to the framebuffer object
+        glBindFramebuffer(GL_FRAMEBUFFER, _depthCubeMapFBO);
+        glDrawBuffer(GL_NONE);
+
+        glViewport(0, 0, resolution, resolution);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                               _depthCubeMap, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "\nDEPTH CUBEMAP FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+                GL_STENCIL_BUFFER_BIT);
+
+        // squeeze the face's depth range around its casters, the receivers
+        // need the same planes to get the distance back out
+        vec2 depthRange{_fitShadowDepthRange(lightPos, faceAxes[i],
+                                             shadowViewProjections.at(i))};
+        _shadowDepthRanges[i] = vec4(depthRange, 0.f, 0.f);
+
+        mat4 faceProjection{glm::perspective(glm::radians(90.f), 1.f,
+                                             depthRange.x, depthRange.y)};
+
+        _renderShadowCasters(_depthCubemapShader, _depthCubemapTesShader,
+                             faceProjection * shadowViews.at(i), lightPos, 1,
+                             1 + (GLint)i);
+
+        // remember what this face was rendered with
+        _faceLightPositions[i] = lightPos;
+        _faceAngleOffsets[i] = _angle_offset;
+        _faceLastRendered[i] = _frameCount;
+        _faceValid[i] = GL_TRUE;
+
+        ++facesRendered;
+    }
+
+    if (timeFaces) {
+        glEndQuery(GL_TIME_ELAPSED);
+
+        _shadowTimerPending = GL_TRUE;
+        _shadowTimerFaces = facesRendered;
+    }
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
+
+void Engine::_renderDualParaboloidMaps() {
+    /* Brabec et al., "Shadow Mapping for Hemispherical and Omnidirectional
+     * Light Sources" (2002) */
+
+    // cull front faces to fix peter-panning
+    if (_options(MAPS_CULL_FRONT_FACE))
+        glCullFace(GL_FRONT);
+
+    // two layers cost the same memory as the cubemap's six at sqrt(3) times
+    // the resolution
+    GLint maxTextureSize{0};
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+    GLuint resolution{glm::min(
+        (GLuint)glm::round((GLfloat)SHADOW_TEXTURE_RESOLUTION * glm::sqrt(3.f)),
+        (GLuint)maxTextureSize)};
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _depthParaboloidMap);
+
+    // only reallocate when the resolution actually changes
+    if (_depthParaboloidMapResolution != resolution) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, _shadowDepthInternalFormat(),
+                     resolution, resolution, 2, 0, GL_DEPTH_COMPONENT,
+                     GL_FLOAT, NULL);
+
+        _depthParaboloidMapResolution = resolution;
+    }
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // front paraboloid looks down, back paraboloid looks up
+    vec3 lightPos = vec3(light_position);
+    mat4 frontView{_paraboloidLightView()};
+
+    std::vector<mat4> paraboloidViews{
+        frontView,
+        glm::rotate(mat4(1.f), PI, vec3(0.f, 1.f, 0.f)) * frontView};
+
+    // the projection itself happens in the vertex/tessellation shaders, which
+    // clip away whatever is behind each paraboloid
+    glEnable(GL_CLIP_DISTANCE0);
+
+    for (std::size_t i{0}; i < paraboloidViews.size(); ++i) {
+        // attach the layer to the framebuffer object
+        glBindFramebuffer(GL_FRAMEBUFFER, _depthParaboloidMapFBO);
+        glDrawBuffer(GL_NONE);
+
+        glViewport(0, 0, resolution, resolution);
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  _depthParaboloidMap, 0, (GLint)i);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "\nDEPTH PARABOLOID FRAMEBUFFER IS BROKEN!!"
+                      << std::endl;
+
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        _renderShadowCasters(_depthParaboloidShader, _depthParaboloidTesShader,
+                             paraboloidViews.at(i), lightPos);
+    }
+
+    glDisable(GL_CLIP_DISTANCE0);
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
+
+void Engine::_renderShadowCasters(ShaderProgram* sphereShader,
+                                  ShaderProgram* teapotShader,
+                                  const mat4& shadowViewProjection,
+                                  const vec3& eyePos,
+                                  const GLsizei& instanceCount,
+                                  const GLint& lodView) {
+    // matrices to use for setting object transformations
+    mat4 model{1.f}, modelViewProjection{1.f};
+    mat4 viewProjection{1.f}, viewportMatrix{1.f};
+
+    // where everything is this frame
+    SceneInstances scene{_sceneInstances(_angle_offset)};
+
+    /* Drawing the spheres */
+    sphereShader->useProgram();
+
+    // the receivers shadow the spheres themselves
+    if (_analyticSpheresActive())
+        scene.spheres.clear();
+
+    // layered passes draw every face at once, those keep the default level
+    auto sphereLod{[&](const GLuint& sphere, const vec4& bounds) {
+        return lodView < 0 ? SPHERE_SUBDIVISIONS
+                           : _sphereLod((GLuint)lodView, sphere, vec3(bounds),
+                                        bounds.w, shadowViewProjection);
+    }};
+
+    for (std::size_t i{0}; i < scene.spheres.size(); ++i) {
+        model = sphereModel(scene.spheres.at(i));
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, shadowViewProjection, eyePos);
+
+        _drawSphere(instanceCount, sphereLod(i, scene.spheres.at(i)));
+    }
+
+    if (_outerRing && !_analyticSpheresActive()) {
+        for (std::size_t i{0}; i < scene.outerRing.size(); ++i) {
+            model = sphereModel(scene.outerRing.at(i));
+
+            _sendSceneBlock(model, viewProjection, modelViewProjection,
+                            viewportMatrix, shadowViewProjection, eyePos);
+
+            _drawSphere(instanceCount,
+                        sphereLod(4u + i, scene.outerRing.at(i)));
+        }
+    }
+
+    /* Drawing the teapots */
+    teapotShader->useProgram();
+
+    for (std::size_t j{0}; j < scene.teapots.size(); ++j) {
+        // the receivers shadow this one with its proxies
+        if (_teapotProxied[j])
+            continue;
+
+        model = scene.teapots.at(j);
+
+        _sendSceneBlock(model, viewProjection, modelViewProjection,
+                        viewportMatrix, shadowViewProjection, eyePos);
+
+        _drawTeapot(instanceCount);
+    }
+}
+
+mat4 Engine::_paraboloidLightView() {
+    vec3 lightPos = vec3(light_position);
+
+    return glm::lookAt(lightPos, lightPos + vec3(0.f, -1.f, 0.f),
+                       vec3(0.f, 0.f, 1.f));
+}
+
+void Engine::_benchmarkShadowMaps() {
+    std::cout << "Benchmarking omnidirectional shadow maps ("
+              << SHADOW_BENCHMARK_FRAMES << " frames each) ...\n";
+
+    // GPU timer for the shadow pass alone, the main pass is identical
+    GLuint timerQuery;
+    glGenQueries(1, &timerQuery);
+
+    int savedOptions{_shadow_options};
+
+    // every face has to be rendered every frame for a fair comparison
+    _turn_off(MAPS_TIME_SLICED);
+
+    for (GLboolean paraboloid : {GL_FALSE, GL_TRUE}) {
+        if (paraboloid)
+            _turn_on(MAPS_DUAL_PARABOLOID);
+        else
+            _turn_off(MAPS_DUAL_PARABOLOID);
+
+        // warm up once so allocation doesn't count against either technique
+        _renderShadowMaps();
+
+        GLuint64 totalTime{0u};
+
+        for (GLuint frame{0u}; frame < SHADOW_BENCHMARK_FRAMES; ++frame) {
+            glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+            _renderShadowMaps();
+            glEndQuery(GL_TIME_ELAPSED);
+
+            // blocks until the GPU is done, fine for a benchmark
+            GLuint64 elapsed{0u};
+            glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &elapsed);
+            totalTime += elapsed;
+        }
+
+        // ask the driver what it actually allocated
+        GLint depthBits{0};
+        GLuint resolution, layers, passes;
+        if (paraboloid) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, _depthParaboloidMap);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0,
+                                     GL_TEXTURE_DEPTH_SIZE, &depthBits);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+            resolution = _depthParaboloidMapResolution;
+            layers = passes = 2u;
+        } else {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+            glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0,
+                                     GL_TEXTURE_DEPTH_SIZE, &depthBits);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+            resolution = _depthCubeMapResolution;
+            layers = passes = 6u;
+        }
+
+        GLdouble megabytes{(GLdouble)resolution * resolution * layers *
+                           (depthBits / 8) / (1024.0 * 1024.0)};
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << (paraboloid ? "  dual-paraboloid" : "  cubemap        ")
+                  << " | " << resolution << "^2 x " << layers << " ("
+                  << megabytes << " MB) | " << passes << " passes | "
+                  << (GLdouble)totalTime / SHADOW_BENCHMARK_FRAMES / 1.0e6
+                  << " ms/frame\n"
+                  << std::defaultfloat << std::setprecision(6);
+    }
+
+    _shadow_options = savedOptions;
+
+    glDeleteQueries(1, &timerQuery);
+}
+
+void Engine::_renderCascadedShadowMaps(const mat4& viewMatrix,
+                                       const mat4& projectionMatrix,
+                                       const GLfloat& nearZ,
+                                       const GLfloat& farZ) {
+    /* https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-10-parallel-split-shadow-maps-programmable-gpus */
+
+    _fitCascades(viewMatrix, projectionMatrix, nearZ, farZ);
+
+    // cull front faces to fix peter-panning
+    if (_options(MAPS_CULL_FRONT_FACE))
+        glCullFace(GL_FRONT);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _cascadeMap);
+
+    // only reallocate when the resolution actually changes
+    if (_cascadeMapResolution != SHADOW_TEXTURE_RESOLUTION) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, _shadowDepthInternalFormat(),
+                     SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION,
+                     NUM_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+        _cascadeMapResolution = SHADOW_TEXTURE_RESOLUTION;
+    }
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // the layered geometry shader reads the cascade matrices from here
+    _sendShadowBlock(mat4(1.f), viewMatrix, SHADOW_PROJECTION::CASCADES);
+
+    // attach every layer at once, gl_Layer picks the cascade
+    glBindFramebuffer(GL_FRAMEBUFFER, _cascadeMapFBO);
+    glDrawBuffer(GL_NONE);
+
+    glViewport(0, 0, SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION);
+
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _cascadeMap, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nCASCADE FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // casters between the sun and a cascade's near plane still need to land
+    // in the map, so flatten them onto it instead of clipping them
+    glEnable(GL_DEPTH_CLAMP);
+
+    _renderShadowCasters(_depthCascadeShader, _depthCascadeTesShader,
+                         mat4(1.f), vec3(0.f));
+
+    glDisable(GL_DEPTH_CLAMP);
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
+
+void Engine::_fitCascades(const mat4& viewMatrix, const mat4& projectionMatrix,
+                          const GLfloat& nearZ, const GLfloat& farZ) {
+    GLfloat shadowFar{glm::min(farZ, _shadowDistance)};
+
+    // view-space corners of the near plane, every slice's corners lie on the
+    // same rays out of the eye
+    mat4 inverseProjection{glm::inverse(projectionMatrix)};
+    mat4 viewToLight{1.f};
+
+    const vec2 ndcCorners[4]{
+        {-1.f, -1.f}, {1.f, -1.f}, {1.f, 1.f}, {-1.f, 1.f}};
+    vec3 nearCorners[4];
+
+    // NDC depth 0.5 is in front of the eye with either depth convention (the
+    // near plane isn't at the same depth in both), then slide onto the plane
+    for (std::size_t i{0}; i < 4u; ++i) {
+        vec4 corner{inverseProjection * vec4(ndcCorners[i], 0.5f, 1.f)};
+        vec3 onRay{vec3(corner) / corner.w};
+        nearCorners[i] = onRay * (nearZ / -onRay.z);
+    }
+
+    // sun never goes straight overhead, so world up is a safe up vector
+    mat4 lightView{
+        glm::lookAt(vec3(0.f), _sunDirection(), vec3(0.f, 1.f, 0.f))};
+    viewToLight = lightView * glm::inverse(viewMatrix);
+
+    // light-space depth of the nearest point any caster could be at
+    GLfloat casterMaxZ{(lightView * vec4(0.f, 0.f, 0.f, 1.f)).z +
+                       SCENE_RADIUS};
+
+    GLfloat sliceNear{nearZ};
+
+    for (GLuint i{0u}; i < NUM_CASCADES; ++i) {
+        // blend uniform and logarithmic split schemes
+        GLfloat p{(GLfloat)(i + 1u) / (GLfloat)NUM_CASCADES};
+        GLfloat logSplit{nearZ * glm::pow(shadowFar / nearZ, p)};
+        GLfloat uniformSplit{nearZ + (shadowFar - nearZ) * p};
+        GLfloat sliceFar{
+            glm::mix(uniformSplit, logSplit, _cascadeSplitLambda)};
+
+        // bounding sphere of the slice's 8 corners, which is the same size
+        // however the camera turns (tight AABBs grow and shrink with it)
+        vec3 center{0.f};
+        for (const auto& corner : nearCorners)
+            for (GLfloat depth : {sliceNear, sliceFar})
+                center += corner * (depth / nearZ) / 8.f;
+
+        GLfloat radius{0.f};
+        for (const auto& corner : nearCorners)
+            for (GLfloat depth : {sliceNear, sliceFar})
+                radius = glm::max(
+                    radius, glm::distance(center, corner * (depth / nearZ)));
+
+        // round up so float noise in the corners can't change the size, then
+        // snap to the texel grid so moving the camera doesn't make shadow
+        // edges shimmer
+        radius = glm::ceil(radius * 16.f) / 16.f;
+
+        GLfloat extent{2.f * radius};
+        GLfloat texelSize{extent / (GLfloat)SHADOW_TEXTURE_RESOLUTION};
+
+        vec3 centerLight{viewToLight * vec4(center, 1.f)};
+        vec2 snappedMin{glm::floor((vec2(centerLight) - radius) / texelSize) *
+                        texelSize};
+        vec2 snappedMax{snappedMin + extent};
+
+        // pull the near plane back so casters outside the slice still count
+        GLfloat minZ{centerLight.z - radius};
+        GLfloat maxZ{glm::max(centerLight.z + radius, casterMaxZ)};
+
+        mat4 lightProjection{glm::ortho(snappedMin.x, snappedMax.x,
+                                        snappedMin.y, snappedMax.y, -maxZ,
+                                        -minZ)};
+
+        _cascadeViewProjections[i] = lightProjection * lightView;
+        _cascadeSplits[i] = sliceFar;
+        _cascadeDepthRanges[i] = maxZ - minZ;
+
+        sliceNear = sliceFar;
+    }
+}
+
+void Engine::_renderSpotShadowMap() {
+    // cull front faces to fix peter-panning
+    if (_options(MAPS_CULL_FRONT_FACE))
+        glCullFace(GL_FRONT);
+
+    glBindTexture(GL_TEXTURE_2D, _spotShadowMap);
+
+    // only reallocate when the resolution actually changes
+    if (_spotShadowMapResolution != SHADOW_TEXTURE_RESOLUTION) {
+        glTexImage2D(GL_TEXTURE_2D, 0, _shadowDepthInternalFormat(),
+                     SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+        _spotShadowMapResolution = SHADOW_TEXTURE_RESOLUTION;
+    }
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // attach the texture to the framebuffer object
+    glBindFramebuffer(GL_FRAMEBUFFER, _spotShadowMapFBO);
+    glDrawBuffer(GL_NONE);
+
+    glViewport(0, 0, SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                           _spotShadowMap, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nSPOT FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // one frustum instead of six cube faces, fitted to its casters the same
+    // way (the Spot block keeps the loose one, its x, y and w are the same)
+    vec3 lightPos = vec3(light_position);
+    vec2 depthRange{_fitShadowDepthRange(lightPos, _spotDirection(),
+                                         _spotViewProjection())};
+    _shadowDepthRanges[6] = vec4(depthRange, 0.f, 0.f);
+
+    _renderShadowCasters(_depthCubemapShader, _depthCubemapTesShader,
+                         _spotViewProjection(depthRange.x, depthRange.y),
+                         lightPos, 1, 7);
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
+
+mat4 Engine::_spotViewProjection(const GLfloat& nearZ, const GLfloat& farZ) {
+    vec3 lightPos = vec3(light_position);
+
+    // the frustum just has to cover the outer cone
+    mat4 spotProjection =
+        glm::perspective(2.f * _spotConeAngle, 1.f, nearZ, farZ);
+
+    return spotProjection * glm::lookAt(lightPos, lightPos + _spotDirection(),
+                                        vec3(0.f, 1.f, 0.f));
+}
+
+vec3 Engine::_spotDirection() {
+    // aim at the first teapot as it spins around
+    vec3 teapot{_sceneInstances(_angle_offset).teapots.front()[3]};
+
+    return glm::normalize(teapot - vec3(light_position));
+}
+
+void Engine::_updatePointLights() {
+    _pointLights.resize(_numPointLights);
+
+    // same face orientations as the single-light cubemap
+    const vec3 faceDirections[6]{{1.f, 0.f, 0.f},  {-1.f, 0.f, 0.f},
+                                 {0.f, 1.f, 0.f},  {0.f, -1.f, 0.f},
+                                 {0.f, 0.f, 1.f},  {0.f, 0.f, -1.f}};
+    const vec3 faceUps[6]{{0.f, -1.f, 0.f}, {0.f, -1.f, 0.f},
+                          {0.f, 0.f, 1.f},  {0.f, 0.f, -1.f},
+                          {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}};
+
+    // far plane at the radius, nothing past it gets lit anyway
+    mat4 faceProjection{
+        glm::perspective(glm::radians(90.f), 1.f, 0.05f, POINT_LIGHT_RADIUS)};
+
+    for (GLuint i{0u}; i < _numPointLights; ++i) {
+        PointLight& light{_pointLights.at(i)};
+        GLfloat t{(GLfloat)i / (GLfloat)_numPointLights};
+
+        // alternate between an inner and outer ring, counter to the objects
+        GLfloat ringRadius{i % 2u ? 14.f : 5.f};
+        GLfloat height{3.f + 1.5f * glm::sin(3.f * _angle_offset + 7.f * t)};
+        vec3 lightPos{
+            circlePos(ringRadius, 2.f * PI * t - 0.5f * _angle_offset, height)};
+
+        // spread the hues evenly around the color wheel
+        vec3 hue{0.5f + 0.5f * glm::cos(2.f * PI *
+                                        (t + vec3(0.f, 1.f / 3.f, 2.f / 3.f)))};
+
+        light.position = vec4(lightPos, POINT_LIGHT_RADIUS);
+        light.color = vec4(hue, 1.f);
+
+        for (std::size_t face{0}; face < 6u; ++face)
+            light.faceViewProjections[face] =
+                faceProjection *
+                glm::lookAt(lightPos, lightPos + faceDirections[face],
+                            faceUps[face]);
+    }
+}
+
+void Engine::_renderPointLightShadowMaps(const mat4& viewMatrix,
+                                         const mat4& projectionMatrix,
+                                         const GLfloat& viewportHeight) {
+    _updatePointLights();
+
+    // upload the lights for both the shadow pass and the receivers
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _pointLightSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint),
+                    &_numPointLights);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, POINT_LIGHTS_HEADER_SIZE,
+                    _numPointLights * sizeof(PointLight), _pointLights.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (_options(MAPS_SHADOW_ATLAS)) {
+        _renderShadowAtlas(viewMatrix, projectionMatrix, viewportHeight);
+        return;
+    }
+
+    // cull front faces to fix peter-panning
+    if (_options(MAPS_CULL_FRONT_FACE))
+        glCullFace(GL_FRONT);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, _pointShadowMaps);
+
+    // only reallocate when the number of lights changes (depth is 6 layer-faces
+    // per light)
+    if (_pointShadowMapsCount != _numPointLights) {
+        glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT,
+                     POINT_LIGHT_SHADOW_RESOLUTION,
+                     POINT_LIGHT_SHADOW_RESOLUTION, 6 * _numPointLights, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+        _pointShadowMapsCount = _numPointLights;
+    }
+
+    // texture settings
+    if (_options(LINEAR_TEXTURE_FILTER)) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER,
+                        GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER,
+                        GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER,
+                        GL_NEAREST);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S,
+                    GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T,
+                    GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R,
+                    GL_CLAMP_TO_EDGE);
 
-    // just send white material initially, will get updated in render loop
-    vec3 materialAmb{1.f}, materialDiff{1.f}, materialSpec{1.f};
-    GLfloat shininess{64.f}; // that's pretty shiny ig
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
 
-    // ask the GPU how the block is stored in memory, cache responses
-    _wireShader->queryUniformBlock(
-        "Material",
-        {"materialAmb", "materialDiff", "materialSpec", "shininess"},
-        _blockSizes[UBO_ID::MATERIAL], _uniformOffsets[UBO_ID::MATERIAL]);
+    // attach every layer-face at once, gl_Layer picks the light and face
+    glBindFramebuffer(GL_FRAMEBUFFER, _pointShadowMapsFBO);
+    glDrawBuffer(GL_NONE);
 
-    // set up CPU-side buffer mirroring memory layout on GPU
-    blockBuffer = (GLubyte*)malloc(_blockSizes[UBO_ID::MATERIAL]);
+    glViewport(0, 0, POINT_LIGHT_SHADOW_RESOLUTION,
+               POINT_LIGHT_SHADOW_RESOLUTION);
 
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 0u),
-           &materialAmb[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 1u),
-           &materialDiff[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 2u),
-           &materialSpec[st 0u], sizeof(vec3));
-    memcpy(blockBuffer + _uniformOffsets[UBO_ID::MATERIAL].at(st 3u),
-           &shininess, sizeof(GLfloat));
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _pointShadowMaps,
+                         0);
 
-    // send buffer to GPU
-    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::MATERIAL]);
-    glBufferData(GL_UNIFORM_BUFFER, _blockSizes[UBO_ID::MATERIAL], blockBuffer,
-                 GL_DYNAMIC_DRAW);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nPOINT LIGHT FRAMEBUFFER IS BROKEN!!" << std::endl;
 
-    free(blockBuffer);
-    blockBuffer = nullptr;
+    glClear(GL_DEPTH_BUFFER_BIT);
 
-    // bind the buffer object to the uniform buffer-binding point at the index
-    // specified by the binding-layout qualifier in the shader
-    glBindBufferBase(GL_UNIFORM_BUFFER, 2u, _ubos[UBO_ID::MATERIAL]);
+    // one instance per light, one geometry shader invocation per face
+    _renderShadowCasters(_depthMultiShader, _depthMultiTesShader, mat4(1.f),
+                         vec3(0.f), (GLsizei)_numPointLights);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, 0u); // unbind uniform buffers from staging
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // set up camera
-    std::cout << "Setting up arcball camera ...\n";
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
 
-    _arcballCam = new ArcballCam(); // use default values
+void Engine::_buildLightClusters(const mat4& viewMatrix,
+                                 const mat4& projectionMatrix,
+                                 const GLint& framebufferWidth,
+                                 const GLint& framebufferHeight) {
+    /* Olsson et al., "Clustered Deferred and Forward Shading" (2012) */
 
-    // shouldn't need to do this manually, but there's a black frame at start of
-    // rendering if I don't :(
-    _arcballCam->setLookAtPoint(EYE_CENTER);
-    _arcballCam->setUpVector(vec3(0.f, 1.f, 0.f));
+    _sendClusterBlock(viewMatrix, glm::inverse(projectionMatrix),
+                      vec2(framebufferWidth, framebufferHeight),
+                      _options(MAPS_CLUSTERED) ? 1 : 0);
+
+    // receivers just loop over every light
+    if (!_options(MAPS_CLUSTERED))
+        return;
+
+    // one work group per depth slice, one invocation per screen tile
+    _clusterShader->useProgram();
+    glDispatchCompute(1u, 1u, CLUSTER_GRID_Z);
+
+    // light lists have to be written before the receivers read them
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void Engine::_printSetupInfo() {
-    // request OpenGL driver info
-    const GLubyte* renderer{glGetString(GL_RENDERER)};
-    const GLubyte* vendor{glGetString(GL_VENDOR)};
-    const GLubyte* version{glGetString(GL_VERSION)};
-    const GLubyte* glslVersion{glGetString(GL_SHADING_LANGUAGE_VERSION)};
+void Engine::_bindGBuffer(const GLint& width, const GLint& height) {
+    // only reallocate when the window actually changes size
+    if (_gBufferWidth != width || _gBufferHeight != height) {
+        // positions need full precision, normals (and shininess) get by with
+        // half, the material colors are all in [0;1]
+        const GLenum formats[NUM_GBUFFER_TEXTURES]{
+            GL_RGBA32F, GL_RGBA16F, GL_RGBA8, GL_RGBA8, GL_RGBA8};
+
+        for (GLsizei i{0}; i < NUM_GBUFFER_TEXTURES; ++i) {
+            glBindTexture(GL_TEXTURE_2D, _gBufferTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, formats[i], width, height, 0,
+                         GL_RGBA, GL_FLOAT, NULL);
+
+            // the lighting pass reads exact texels, nothing to filter
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        }
 
-    // request GL version
-    GLint major, minor;
-    glGetIntegerv(GL_MAJOR_VERSION, &major);
-    glGetIntegerv(GL_MINOR_VERSION, &minor);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
-    std::cout << "GL Vendor            : " << vendor << '\n';
-    std::cout << "GL Renderer          : " << renderer << '\n';
-    std::cout << "GL Version (string)  : " << version << '\n';
-    std::cout << "GL Version (integer) : " << major << '.' << minor << '\n';
-    std::cout << "GLSL Version         : " << glslVersion << '\n';
+        _gBufferWidth = width;
+        _gBufferHeight = height;
+        _gBufferDepthFormat = GL_NONE;
+    }
+
+    // same format as the camera's, so the depth can be blitted over
+    if (_gBufferDepthFormat != _cameraDepthFormat()) {
+        glBindRenderbuffer(GL_RENDERBUFFER, _gBufferDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, _cameraDepthFormat(), width,
+                              height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        _gBufferDepthFormat = _cameraDepthFormat();
+    }
+
+    // attach the textures to the framebuffer object
+    glBindFramebuffer(GL_FRAMEBUFFER, _gBufferFBO);
+
+    GLenum drawBuffers[NUM_GBUFFER_TEXTURES];
+    for (GLsizei i{0}; i < NUM_GBUFFER_TEXTURES; ++i) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                               GL_TEXTURE_2D, _gBufferTextures[i], 0);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, _gBufferDepth);
+
+    glDrawBuffers(NUM_GBUFFER_TEXTURES, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nG-BUFFER FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    // clear to zero rather than the clear color, position.w = 0 marks the
+    // pixels nothing got drawn to
+    const GLfloat zero[4]{0.f, 0.f, 0.f, 0.f};
+    for (GLsizei i{0}; i < NUM_GBUFFER_TEXTURES; ++i)
+        glClearBufferfv(GL_COLOR, i, zero);
+
+    glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 
-// *****************************************************************************
-// Engine Cleanup
+void Engine::_renderDeferredLighting() {
+    for (GLsizei i{0}; i < NUM_GBUFFER_TEXTURES; ++i) {
+        glActiveTexture(GL_TEXTURE5 + i);
+        glBindTexture(GL_TEXTURE_2D, _gBufferTextures[i]);
+    }
 
-void Engine::_cleanupGLFW() {
-    std::cout << "Shutting down GLFW ...\n";
+    // the other shadow maps are still bound from _renderScene()
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
 
-    glfwDestroyWindow(_window);
-    _window = nullptr;
+    // one fullscreen triangle, the G-buffer already resolved visibility
+    glDisable(GL_DEPTH_TEST);
 
-    glfwTerminate();
+    // only filter the tiles that straddle a shadow edge
+    if (_penumbraTilesActive()) {
+        _renderPenumbraShadows();
+
+        glActiveTexture(GL_TEXTURE11);
+        glBindTexture(GL_TEXTURE_2D, _penumbraClass);
+        glActiveTexture(GL_TEXTURE12);
+        glBindTexture(GL_TEXTURE_2D, _penumbraShadow);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // or skip the shadow maps and trace a ray per pixel instead
+    if (_rayTracedShadowsActive()) {
+        _renderRayTracedShadows();
+
+        glActiveTexture(GL_TEXTURE13);
+        glBindTexture(GL_TEXTURE_2D, _rayTracedShadow);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // or test the samples against the triangles over them in light space
+    if (_irregularShadowsActive()) {
+        _renderIrregularShadows();
+
+        glActiveTexture(GL_TEXTURE13);
+        glBindTexture(GL_TEXTURE_2D, _irregularShadow);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // or accumulate a few filter taps per frame over time
+    if (_temporalShadowsActive())
+        _renderTemporalShadows();
+
+    // filter the shadows at a lower resolution first
+    if (_activeShadowMaskDivisor() > 0) {
+        _renderShadowMask();
+
+        glActiveTexture(GL_TEXTURE10);
+        glBindTexture(GL_TEXTURE_2D, _shadowMask);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // everything the lighting pass samples is bound now
+    if (_compareReference) {
+        if (_light_type != MULTI_POINT)
+            _compareAgainstReference();
+        else
+            std::cout << "Reference shadows only cover a single light\n";
+
+        _compareReference = GL_FALSE;
+    }
+
+    // back to the window, run() already cleared it
+    _bindCameraFramebuffer(_gBufferWidth, _gBufferHeight);
+
+    _deferredLightingShader->useProgram();
+
+    glBindVertexArray(_fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(GL_NONE);
+
+    glEnable(GL_DEPTH_TEST);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    // forward passes after this one (the light markers) still depth test
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _gBufferFBO);
+    glBlitFramebuffer(0, 0, _gBufferWidth, _gBufferHeight, 0, 0,
+                      _gBufferWidth, _gBufferHeight, GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    _bindCameraFramebuffer(_gBufferWidth, _gBufferHeight);
 }
 
-void Engine::_cleanupShaders() {
-    std::cout << "Deleting shader programs ...\n";
+void Engine::_bindCameraFramebuffer(const GLint& width, const GLint& height) {
+    if (!_options(REVERSED_Z)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDrawBuffer(GL_BACK);
+        return;
+    }
 
-    delete _wireShader;
-    _wireShader = nullptr;
+    // only reallocate when the window actually changes size
+    if (_cameraWidth != width || _cameraHeight != height) {
+        glBindRenderbuffer(GL_RENDERBUFFER, _cameraColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
 
-    delete _wireTesShader;
-    _wireTesShader = nullptr;
+        // float depth, most of its precision ends up far from the eye, which
+        // is exactly where the reversed projection needs it
+        glBindRenderbuffer(GL_RENDERBUFFER, _cameraDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH32F_STENCIL8, width,
+                              height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-    delete _flatShader;
-    _flatShader = nullptr;
+        _cameraWidth = width;
+        _cameraHeight = height;
+    }
 
-    delete _flatLightShader;
-    _flatLightShader = nullptr;
+    glBindFramebuffer(GL_FRAMEBUFFER, _cameraFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, _cameraColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, _cameraDepth);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-    delete _teapotPlanarShadowShader;
-    _teapotPlanarShadowShader = nullptr;
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nCAMERA FRAMEBUFFER IS BROKEN!!" << std::endl;
+}
 
-    delete _spherePlanarShadowShader;
-    _spherePlanarShadowShader = nullptr;
+void Engine::_renderShadowMask() {
+    GLint divisor{_activeShadowMaskDivisor()};
 
-    delete _shadowTextureCubemapShader;
-    _shadowTextureCubemapShader = nullptr;
+    // round up so the last partial block still gets a texel
+    GLint width{(_gBufferWidth + divisor - 1) / divisor};
+    GLint height{(_gBufferHeight + divisor - 1) / divisor};
 
-    delete _shadowTextureCubemapTesShader;
-    _shadowTextureCubemapTesShader = nullptr;
+    glBindTexture(GL_TEXTURE_2D, _shadowMask);
 
-    delete _shadowTextureShader;
-    _shadowTextureShader = nullptr;
+    // only reallocate when the size actually changes
+    if (_shadowMaskWidth != width || _shadowMaskHeight != height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED,
+                     GL_UNSIGNED_BYTE, NULL);
 
-    delete _shadowMapShader;
-    _shadowMapShader = nullptr;
+        _shadowMaskWidth = width;
+        _shadowMaskHeight = height;
+    }
+
+    // the upsampler does its own (bilateral) filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // attach the texture to the framebuffer object
+    glBindFramebuffer(GL_FRAMEBUFFER, _shadowMaskFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _shadowMask, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nSHADOW MASK FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    glViewport(0, 0, width, height);
+
+    // every texel gets written, no need to clear (or blend, the mask has no
+    // alpha to blend with)
+    glDisable(GL_BLEND);
+
+    _shadowMaskShader->useProgram();
+
+    glBindVertexArray(_fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(GL_NONE);
+
+    glEnable(GL_BLEND);
+
+    // unbind framebuffer, back to the full-resolution viewport
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, _gBufferWidth, _gBufferHeight);
+}
+
+void Engine::_renderPenumbraShadows() {
+    GLint tilesX{(_gBufferWidth + PENUMBRA_TILE_SIZE - 1) / PENUMBRA_TILE_SIZE};
+    GLint tilesY{(_gBufferHeight + PENUMBRA_TILE_SIZE - 1) /
+                 PENUMBRA_TILE_SIZE};
+
+    // read back an earlier frame's tile count once its copy has landed
+    // (without stalling), otherwise keep showing the last one
+    if (_penumbraCountFence &&
+        glClientWaitSync(_penumbraCountFence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        GLuint tileCount{0u};
+        glBindBuffer(GL_COPY_READ_BUFFER, _penumbraCountBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &tileCount);
+        glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+
+        _penumbraFraction = (GLfloat)tileCount / (GLfloat)_penumbraCountTiles;
+
+        glDeleteSync(_penumbraCountFence);
+        _penumbraCountFence = nullptr;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _penumbraTileSSBO);
+
+    if (_penumbraWidth != _gBufferWidth || _penumbraHeight != _gBufferHeight) {
+        // only reallocate when the G-buffer actually changes size
+        glBindTexture(GL_TEXTURE_2D, _penumbraClass);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, tilesX, tilesY, 0, GL_RED,
+                     GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        glBindTexture(GL_TEXTURE_2D, _penumbraShadow);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, _gBufferWidth, _gBufferHeight, 0,
+                     GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // room for every tile, in case they all end up in penumbra
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     PENUMBRA_TILES_HEADER_SIZE +
+                         tilesX * tilesY * sizeof(vec4),
+                     NULL, GL_DYNAMIC_DRAW);
+
+        // a copy still in flight would land in the orphaned storage, drop it
+        glDeleteSync(_penumbraCountFence);
+        _penumbraCountFence = nullptr;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _penumbraCountBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), NULL,
+                     GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+
+        _penumbraWidth = _gBufferWidth;
+        _penumbraHeight = _gBufferHeight;
+    }
+
+    // reset the draw command: 6 vertices per tile, no tiles yet
+    const GLuint drawCommand[4]{6u, 0u, 0u, 0u};
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(drawCommand),
+                    drawCommand);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3u, _penumbraTileSSBO);
+
+    // single channel targets, nothing to blend with
+    glDisable(GL_BLEND);
+
+    glBindVertexArray(_fullscreenVAO);
+
+    // classify every tile, penumbra tiles get appended to the list
+    glBindFramebuffer(GL_FRAMEBUFFER, _penumbraClassFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _penumbraClass, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nPENUMBRA CLASS FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    glViewport(0, 0, tilesX, tilesY);
+
+    _penumbraClassifyShader->useProgram();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // the list gets read by the vertex shader, as the draw command, and
+    // copied out for the CPU
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // one copy in flight at a time, fenced so the read never waits on it
+    if (!_penumbraCountFence) {
+        glBindBuffer(GL_COPY_READ_BUFFER, _penumbraTileSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _penumbraCountBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            sizeof(GLuint), 0, sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
+
+        _penumbraCountFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _penumbraCountTiles = tilesX * tilesY;
+    }
+
+    // full filter over the penumbra tiles only, the rest of the texture is
+    // never read
+    glBindFramebuffer(GL_FRAMEBUFFER, _penumbraShadowFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _penumbraShadow, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nPENUMBRA SHADOW FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    glViewport(0, 0, _gBufferWidth, _gBufferHeight);
+
+    _penumbraFilterShader->useProgram();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _penumbraTileSSBO);
+    glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+
+    glBindVertexArray(GL_NONE);
+
+    glEnable(GL_BLEND);
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Engine::_renderTemporalShadows() {
+    // only reallocate when the G-buffer actually changes size
+    if (_temporalWidth != _gBufferWidth || _temporalHeight != _gBufferHeight) {
+        glBindTexture(GL_TEXTURE_2D, _temporalTaps);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, _gBufferWidth, _gBufferHeight,
+                     0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        // the history gets resampled wherever the surface was last frame
+        for (GLuint i{0u}; i < 2u; ++i) {
+            glBindTexture(GL_TEXTURE_2D, _shadowHistory[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, _gBufferWidth,
+                         _gBufferHeight, 0, GL_RG, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        _temporalWidth = _gBufferWidth;
+        _temporalHeight = _gBufferHeight;
+
+        // whatever was in there is garbage (weight was sent as 0 already if
+        // this is the first frame)
+        _shadowHistoryValid = GL_FALSE;
+    }
+
+    // single/dual channel targets, nothing to blend with
+    glDisable(GL_BLEND);
+
+    glBindVertexArray(_fullscreenVAO);
+
+    // a few rotated taps per pixel for this frame
+    glBindFramebuffer(GL_FRAMEBUFFER, _temporalTapsFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _temporalTaps, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nTEMPORAL TAPS FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    _temporalTapsShader->useProgram();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // reproject, clamp, and blend into the other history buffer
+    GLuint previous{_shadowHistoryIndex}, next{1u - _shadowHistoryIndex};
+
+    glActiveTexture(GL_TEXTURE13);
+    glBindTexture(GL_TEXTURE_2D, _temporalTaps);
+    glActiveTexture(GL_TEXTURE14);
+    glBindTexture(GL_TEXTURE_2D, _shadowHistory[previous]);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _shadowHistoryFBO[next]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _shadowHistory[next], 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nSHADOW HISTORY FRAMEBUFFER IS BROKEN!!" << std::endl;
+
+    _temporalResolveShader->useProgram();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // one more point on the area light in there
+    if (_areaLightActive() && _areaLightSamples < AREA_LIGHT_MAX_SAMPLES)
+        ++_areaLightSamples;
+
+    // the lighting pass reads the newest history from the same unit
+    glBindTexture(GL_TEXTURE_2D, _shadowHistory[next]);
+    glActiveTexture(GL_TEXTURE0);
+
+    _shadowHistoryIndex = next;
+
+    glBindVertexArray(GL_NONE);
+
+    glEnable(GL_BLEND);
+
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // remember what this frame looked like for the next one
+    _previousViewProjection = _cameraViewProjection;
+    _previousLightPosition = light_position;
+    _previousAngleOffset = _angle_offset;
+    _previousLightType = _light_type;
+    _shadowHistoryValid = GL_TRUE;
+}
+
+GLfloat Engine::_temporalHistoryWeight() {
+    // nothing (sensible) to reproject
+    if (!_shadowHistoryValid || _light_type != _previousLightType)
+        return 0.f;
+
+    GLboolean moved{light_position != _previousLightPosition ||
+                    _angle_offset != _previousAngleOffset};
+
+    // area light: every frame adds one sample, weighed the same as all the
+    // ones before it (so the history is their plain average) until the cap
+    if (_areaLightActive()) {
+        GLfloat n{(GLfloat)_areaLightSamples};
+        GLfloat average{n / (n + 1.f)};
+
+        // only a still frame ever converges, the other mode keeps blending in
+        // new samples so moving shadows (and dropped history) catch up
+        if (_options(MAPS_AREA_PROGRESSIVE))
+            return _areaLightSamples >= AREA_LIGHT_MAX_SAMPLES ? 1.f
+                                                               : average;
+
+        return glm::min(average, moved ? AREA_LIGHT_MOVING_WEIGHT
+                                       : AREA_LIGHT_HISTORY_WEIGHT);
+    }
+
+    // the shadows slid across the receivers, lean on this frame's taps more
+    // (clamping to them catches the rest)
+    if (moved)
+        return 0.8f;
+
+    return 0.95f;
+}
+
+// radical inverse of i in the given base (Halton sequence)
+static GLfloat halton(GLuint i, const GLuint& base) {
+    GLfloat result{0.f}, fraction{1.f};
+
+    while (i > 0u) {
+        fraction /= (GLfloat)base;
+        result += fraction * (GLfloat)(i % base);
+        i /= base;
+    }
+
+    return result;
+}
+
+void Engine::_nextAreaLightSample() {
+    // the progressive average only holds while nothing on screen changes, the
+    // other mode lets the history weight deal with it
+    if (!_shadowHistoryValid || _light_type != _previousLightType ||
+        (_options(MAPS_AREA_PROGRESSIVE) &&
+         (_cameraViewProjection != _previousViewProjection ||
+          light_position != _previousLightPosition ||
+          _angle_offset != _previousAngleOffset))) {
+        _areaLightSamples = 0u;
+        _areaLightSampleIndex = 0u;
+    }
+
+    // well spread out over the emitter after any number of frames (index 0
+    // would be a corner)
+    ++_areaLightSampleIndex;
+    GLfloat u{halton(_areaLightSampleIndex, 2u)};
+    GLfloat v{halton(_areaLightSampleIndex, 3u)};
+
+    vec3 offset{0.f};
+    if (_areaLightShape == SPHERE_EMITTER) {
+        // uniform over the sphere's surface
+        GLfloat z{1.f - 2.f * u}, phi{2.f * PI * v};
+        GLfloat r{glm::sqrt(glm::max(0.f, 1.f - z * z))};
+
+        offset = AREA_LIGHT_RADIUS * vec3(r * glm::cos(phi), z,
+                                          r * glm::sin(phi));
+    } else {
+        // uniform over a horizontal square as wide as the sphere
+        offset = 2.f * AREA_LIGHT_RADIUS * vec3(u - 0.5f, 0.f, v - 0.5f);
+    }
+
+    _areaLightSample = vec3(light_position) + offset;
+}
+
+// same as teapot.tese, for evaluating patches on the CPU
+static vec3 evalBezierCurve(const vec3& P0, const vec3& P1, const vec3& P2,
+                            const vec3& P3, const GLfloat& t) {
+    GLfloat s{1.f - t};
+    return s * s * s * P0 + 3.f * s * s * t * P1 + 3.f * s * t * t * P2 +
+           t * t * t * P3;
+}
+
+std::vector<vec3> Engine::_tessellateTeapot(const GLuint& level) {
+    std::vector<vec3> vertices;
+
+    for (size_t patch{(size_t)0u}; patch < TEAPOT_NUM_PATCHES; ++patch) {
+        // get this patch's control points
+        vec3 p[PATCH_DIMENSION * PATCH_DIMENSION];
+
+        for (size_t i{(size_t)0u}; i < PATCH_DIMENSION * PATCH_DIMENSION; ++i)
+            p[i] = teapot_cp_vertices[teapot_patches[patch * PATCH_DIMENSION *
+                                                         PATCH_DIMENSION +
+                                                     i] -
+                                      (GLushort)1u];
+
+        // evaluate the surface on a (level + 1) x (level + 1) grid of (u, v)
+        std::vector<vec3> grid;
+
+        for (GLuint j{0u}; j <= level; ++j) {
+            GLfloat v{(GLfloat)j / (GLfloat)level};
+
+            for (GLuint i{0u}; i <= level; ++i) {
+                GLfloat u{(GLfloat)i / (GLfloat)level};
+
+                grid.push_back(evalBezierCurve(
+                    evalBezierCurve(p[0], p[1], p[2], p[3], u),
+                    evalBezierCurve(p[4], p[5], p[6], p[7], u),
+                    evalBezierCurve(p[8], p[9], p[10], p[11], u),
+                    evalBezierCurve(p[12], p[13], p[14], p[15], u), v));
+            }
+        }
+
+        // two triangles per grid cell
+        for (GLuint j{0u}; j < level; ++j) {
+            for (GLuint i{0u}; i < level; ++i) {
+                GLuint corner{j * (level + 1u) + i};
+
+                const vec3& a{grid.at(corner)};
+                const vec3& b{grid.at(corner + 1u)};
+                const vec3& c{grid.at(corner + level + 1u)};
+                const vec3& d{grid.at(corner + level + 2u)};
+
+                vertices.insert(vertices.end(), {a, b, d, a, d, c});
+            }
+        }
+    }
+
+    return vertices;
+}
+
+std::vector<vec3> Engine::_icosphereTriangles() {
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+
+    _buildIcosphere(vertices, indices);
+
+    std::vector<vec3> triangles;
+    for (const auto& index : indices)
+        triangles.push_back(vec3(vertices.at(st index * 3u),
+                                 vertices.at(st index * 3u + 1u),
+                                 vertices.at(st index * 3u + 2u)));
+
+    return triangles;
+}
+
+void Engine::_buildRayTracingBvh() {
+    std::cout << "Building shadow ray BVH ...\n";
+
+    _bvh = new Bvh;
+
+    // same corners as _createPlatform()
+    std::vector<vec3> platform{{-1.f, 0.f, -1.f}, {-1.f, 0.f, 1.f},
+                               {1.f, 0.f, -1.f},  {1.f, 0.f, -1.f},
+                               {-1.f, 0.f, 1.f},  {1.f, 0.f, 1.f}};
+
+    // each mesh's triangles stay together, after the previous mesh's ones
+    auto addMesh = [&](const VAO_ID& mesh, const std::vector<vec3>& vertices) {
+        _bvhFirstTriangles[mesh] = (GLuint)_bvh->getTriangles().size();
+        _bvhRoots[mesh] = _bvh->addMesh(vertices);
+        _bvhTriangleCounts[mesh] =
+            (GLuint)_bvh->getTriangles().size() - _bvhFirstTriangles[mesh];
+    };
+
+    addMesh(VAO_ID::PLATFORM, platform);
+
+    // the exact icosphere the spheres are drawn with
+    addMesh(VAO_ID::SPHERE, _icosphereTriangles());
+
+    // the teapot is only tessellated once, at a fixed level
+    addMesh(VAO_ID::TEAPOT, _tessellateTeapot(RAY_TRACED_TEAPOT_LEVEL));
+
+    const std::vector<Bvh::Node>& nodes{_bvh->getNodes()};
+    const std::vector<Bvh::Triangle>& triangles{_bvh->getTriangles()};
 
-    delete _shadowMapTesShader;
-    _shadowMapTesShader = nullptr;
+    // the trees never change, only where the meshes are placed
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bvhNodeSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, nodes.size() * sizeof(Bvh::Node),
+                 nodes.data(), GL_STATIC_DRAW);
 
-    delete _depthCubemapShader;
-    _depthCubemapShader = nullptr;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4u, _bvhNodeSSBO);
 
-    delete _depthCubemapTesShader;
-    _depthCubemapTesShader = nullptr;
-}
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bvhTriangleSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 triangles.size() * sizeof(Bvh::Triangle), triangles.data(),
+                 GL_STATIC_DRAW);
 
-void Engine::_cleanupBuffers() {
-    std::cout << "Deleting GPU buffers ...\n";
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5u, _bvhTriangleSSBO);
 
-    glDeleteVertexArrays(NUM_VAOS, _vaos);
+    // room for the most instances we'll ever have, updated every frame
+    const GLuint header[4]{0u, 0u, 0u, 0u};
 
-    glDeleteBuffers(NUM_VAOS, _vbos);
-    glDeleteBuffers(NUM_VAOS, _ibos);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _rayInstanceSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 RAY_INSTANCES_HEADER_SIZE +
+                     MAX_RAY_INSTANCES * sizeof(RayInstance),
+                 NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
 
-    glDeleteBuffers(NUM_UBOS, _ubos);
-}
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6u, _rayInstanceSSBO);
 
-void Engine::_cleanupScene() {
-    std::cout << "Deleting camera ...\n";
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
 
-    delete _arcballCam;
+    std::cout << "BVH built with " << nodes.size() << " nodes over "
+              << triangles.size() << " triangles\n";
 }
 
-// *****************************************************************************
-// Engine Rendering & Updating
+std::vector<Engine::RayInstance> Engine::_placeRayInstances() {
+    std::vector<RayInstance> instances;
 
-void Engine::_renderScene(const mat4& viewMatrix, const mat4& projectionMatrix,
-                          const mat4& viewportMatrix) {
-    // if shader program is null, do not continue to prevent run time errors
-    if (!_wireShader || !_wireTesShader || !_flatShader)
-        return;
+    // the mesh's tree (and its whole triangle range) wherever the model puts it
+    auto place = [&](const mat4& model, const VAO_ID& mesh) {
+        instances.push_back({glm::inverse(model), _bvhRoots[mesh],
+                             _bvhFirstTriangles[mesh],
+                             _bvhTriangleCounts[mesh], 0u});
+    };
 
-    // send light properties
-    vec3 lightAmb{1.f}, lightDiff{1.f}, lightSpec{1.f}; // white light
-    /* https://learnopengl.com/Lighting/Light-casters */
-    // attenuation values for distance of 160
-    GLfloat attenConst{1.f}, attenLin{0.027f}, attenQuad{0.0028f};
+    SceneInstances scene{_sceneInstances(_angle_offset)};
 
-    _sendLightBlock(light_position, lightAmb, lightDiff, lightSpec, attenConst,
-                    attenLin, attenQuad);
+    place(glm::scale(mat4(1.f), vec3(100.f)), VAO_ID::PLATFORM);
 
-    // matrices to use for setting object transformations
-    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
-    mat4 viewProjection{projectionMatrix * viewMatrix};
-    mat4 shadowViewProjections{1.f};
-    vec3 eyePos{_arcballCam->getPosition()};
+    for (std::size_t i{0}; i < scene.teapots.size(); ++i) {
+        place(scene.teapots.at(i), VAO_ID::TEAPOT);
+        place(sphereModel(scene.spheres.at(i)), VAO_ID::SPHERE);
+    }
 
-    // vectors to use for setting object materials
-    vec3 materialAmb{0.f}, materialDiff{0.f}, materialSpec{0.f};
-    GLfloat shininess{0.f};
+    if (_outerRing)
+        for (const vec4& sphere : scene.outerRing)
+            place(sphereModel(sphere), VAO_ID::SPHERE);
 
-    // positions of objects in the scene
-    std::vector<vec3> teapot_positions{
-        circlePos(9.f, _angle_offset + 0.f, 0.5f),
-        circlePos(9.f, _angle_offset + PI / 2.f, 1.5f),
-        circlePos(9.f, _angle_offset + PI, 0.5f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 2.f, 1.5f)};
-
-    std::vector<vec3> sphere_positions{
-        circlePos(9.f, _angle_offset + PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 5.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 7.f * PI / 4.f, 1.1f)};
-
-    std::vector<vec3> outer_sphere_positions{
-        circlePos(20.f, 0.f, 1.6f),
-        circlePos(20.f, PI / 4.f, 1.6f),
-        circlePos(20.f, PI / 2.f, 1.6f),
-        circlePos(20.f, 3.f * PI / 4.f, 1.6f),
-        circlePos(20.f, PI, 1.6f),
-        circlePos(20.f, 5.f * PI / 4.f, 1.6f),
-        circlePos(20.f, 3.f * PI / 2.f, 1.6f),
-        circlePos(20.f, 7.f * PI / 4.f, 1.6f)};
+    return instances;
+}
 
-    /* Drawing the Platform */
+void Engine::_renderRayTracedShadows() {
+    // only reallocate when the G-buffer actually changes size
+    if (_rayTracedWidth != _gBufferWidth ||
+        _rayTracedHeight != _gBufferHeight) {
+        glBindTexture(GL_TEXTURE_2D, _rayTracedShadow);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, _gBufferWidth, _gBufferHeight, 0,
+                     GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        _rayTracedWidth = _gBufferWidth;
+        _rayTracedHeight = _gBufferHeight;
+    }
 
-    if (_which_shadows == TEXTURES) {
-        _shadowTextureShader->useProgram();
+    std::vector<RayInstance> instances{_placeRayInstances()};
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
-    } else if (_which_shadows == MAPS) {
-        _shadowMapShader->useProgram();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _rayInstanceSSBO);
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
-    } else
-        _wireShader->useProgram();
+    // last timed frame's GPU time and ray count, if they're in yet
+    if (_rayTimerPending) {
+        GLint available{0};
+        glGetQueryObjectiv(_rayTimerQuery, GL_QUERY_RESULT_AVAILABLE,
+                           &available);
 
-    if (_which_shadows == PLANAR && _options(PLANAR_STENCIL_TEST)) {
-        glEnable(GL_STENCIL_TEST);
-        glStencilFunc(GL_ALWAYS, 0, 0xffff);
-        glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
-    }
+        if (available) {
+            GLuint64 elapsed{0u};
+            glGetQueryObjectui64v(_rayTimerQuery, GL_QUERY_RESULT, &elapsed);
 
-    // compute and send transformation matrices
-    model = glm::scale(mat4(1.f), vec3(100.f));
+            GLuint rays{0u};
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint),
+                               sizeof(GLuint), &rays);
 
-    modelView = viewMatrix * model;
-    modelViewProjection = projectionMatrix * modelView;
+            if (elapsed > 0u)
+                _raysPerSecond = (GLdouble)rays / ((GLdouble)elapsed / 1.0e9);
 
-    _sendSceneBlock(model, viewProjection, modelViewProjection, viewportMatrix,
-                    shadowViewProjections, eyePos);
+            _rayTimerPending = GL_FALSE;
+        }
+    }
 
-    // send material properties
-    materialAmb = materialDiff = vec3{0.2f, 0.1f, 0.7f}; // bluish
-    materialSpec = vec3{1.f};                            // white
-    shininess = 64.f;                                    // pwetty shiny uwu
+    // new instance count, and the ray counter starts over
+    const GLuint header[2]{(GLuint)instances.size(), 0u};
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, RAY_INSTANCES_HEADER_SIZE,
+                    instances.size() * sizeof(RayInstance), instances.data());
 
-    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
 
-    _drawPlatform(); // draw the platform
+    // the G-buffer is still bound from _renderDeferredLighting()
+    glBindImageTexture(0u, _rayTracedShadow, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R8);
 
-    /* Drawing planar projection of teapot onto the platform */
+    GLboolean timeRays{!_rayTimerPending};
 
-    if (_which_shadows == PLANAR) {
-        glDisable(GL_CULL_FACE);
+    if (timeRays)
+        glBeginQuery(GL_TIME_ELAPSED, _rayTimerQuery);
 
-        if (_options(PLANAR_DEPTH_TEST))
-            glDisable(GL_DEPTH_TEST);
+    // 8 x 8 pixels per work group (must match shadow_raytrace.comp)
+    _rayTraceShader->useProgram();
+    glDispatchCompute((GLuint)(_gBufferWidth + 7) / 8u,
+                      (GLuint)(_gBufferHeight + 7) / 8u, 1u);
 
-        if (_options(PLANAR_STENCIL_TEST)) {
-            // glDisable(GL_DEPTH_TEST);
-            glStencilFunc(GL_EQUAL, 1, 0xffff);
-            glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
-        }
+    if (timeRays) {
+        glEndQuery(GL_TIME_ELAPSED);
 
-        // send material properties
-        if (_options(PLANAR_BLEND))
-            shininess = 0.5f; // using this as alpha value
-        else
-            shininess = 1.f;
+        // set this frame's ray count aside until its time is read back
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
 
-        _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+        glBindBuffer(GL_COPY_READ_BUFFER, _rayInstanceSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _rayInstanceSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            sizeof(GLuint), 2 * sizeof(GLuint),
+                            sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, GL_NONE);
 
-        _teapotPlanarShadowShader->useProgram();
-        for (std::size_t i{0}; i < teapot_positions.size(); ++i) {
-            model = glm::translate(mat4(1.f), teapot_positions.at(i));
-            model = glm::rotate(model, PI / -2.f, {1.f, 0.f, 0.f});
-            model = glm::rotate(model, ((GLfloat)i + 1.f) * (PI / 2.f),
-                                {0.f, 0.f, 1.f});
+        _rayTimerPending = GL_TRUE;
+    }
 
-            modelView = viewMatrix * model;
-            modelViewProjection = projectionMatrix * modelView;
+    // the lighting pass samples what the rays wrote
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections, eyePos);
+void Engine::_renderIrregularShadows() {
+    // only reallocate when the G-buffer actually changes size
+    if (_irregularWidth != _gBufferWidth ||
+        _irregularHeight != _gBufferHeight) {
+        glBindTexture(GL_TEXTURE_2D, _irregularShadow);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, _gBufferWidth, _gBufferHeight, 0,
+                     GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // a ray origin and the next sample in its list per pixel (std430,
+        // vec3 + uint)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _irregularNodeSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     _gBufferWidth * _gBufferHeight * sizeof(vec4), NULL,
+                     GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+
+        _irregularWidth = _gBufferWidth;
+        _irregularHeight = _gBufferHeight;
+    }
 
-            _drawTeapot();
-        }
+    // the grid has a face wherever the light's shadow map would have had one
+    std::vector<mat4> faces;
+    vec3 lightPos{light_position};
+
+    if (_light_type == DIRECTIONAL) {
+        // looking down the sun's rays at the platform
+        mat4 sunView{glm::lookAt(-2.f * IRREGULAR_SUN_EXTENT * _sunDirection(),
+                                 vec3(0.f), vec3(0.f, 1.f, 0.f))};
+
+        faces.push_back(glm::ortho(-IRREGULAR_SUN_EXTENT, IRREGULAR_SUN_EXTENT,
+                                   -IRREGULAR_SUN_EXTENT, IRREGULAR_SUN_EXTENT,
+                                   0.f, 4.f * IRREGULAR_SUN_EXTENT) *
+                        sunView);
+    } else if (_light_type == SPOT) {
+        faces.push_back(_spotViewProjection());
+    } else {
+        // same faces as _renderShadowMaps(), in the order
+        // shadow_irregular_insert.comp picks them by major axis
+        mat4 faceProjection{
+            glm::perspective(glm::radians(90.f), 1.f, 0.001f, 1'000.f)};
+
+        faces = {faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(1.f, 0.f, 0.f),
+                                              vec3(0.f, -1.f, 0.f)),
+                 faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(-1.f, 0.f, 0.f),
+                                              vec3(0.f, -1.f, 0.f)),
+                 faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(0.f, 1.f, 0.f),
+                                              vec3(0.f, 0.f, 1.f)),
+                 faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(0.f, -1.f, 0.f),
+                                              vec3(0.f, 0.f, -1.f)),
+                 faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(0.f, 0.f, 1.f),
+                                              vec3(0.f, -1.f, 0.f)),
+                 faceProjection * glm::lookAt(lightPos,
+                                              lightPos + vec3(0.f, 0.f, -1.f),
+                                              vec3(0.f, -1.f, 0.f))};
+    }
 
-        _spherePlanarShadowShader->useProgram();
-        for (std::size_t i{0}; i < sphere_positions.size(); ++i) {
-            model = glm::translate(mat4(1.f), sphere_positions.at(i));
-            model = glm::scale(model, vec3(1.f));
+    const GLuint gridSize[4]{(GLuint)faces.size(), IRREGULAR_RESOLUTION, 0u,
+                             0u};
+    const GLuint emptyList{0xFFFFFFFFu};
 
-            modelView = viewMatrix * model;
-            modelViewProjection = projectionMatrix * modelView;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _irregularGridSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, faces.size() * sizeof(mat4),
+                    faces.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 6 * sizeof(mat4),
+                    sizeof(gridSize), gridSize);
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections, eyePos);
+    // every list starts out empty
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI,
+                         IRREGULAR_GRID_HEADER_SIZE,
+                         faces.size() * IRREGULAR_RESOLUTION *
+                             IRREGULAR_RESOLUTION * sizeof(GLuint),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, &emptyList);
 
-            _drawSphere();
-        }
+    // the triangles come from the ray tracing BVH, placed the same way
+    std::vector<RayInstance> instances{_placeRayInstances()};
 
-        if (_outerRing) {
-            for (const auto& pos : outer_sphere_positions) {
-                model = glm::translate(mat4(1.f), pos);
-                model = glm::scale(model, vec3(1.5f));
+    GLuint maxTriangles{0u};
+    for (const auto& instance : instances)
+        maxTriangles = glm::max(maxTriangles, instance.triangleCount);
 
-                modelView = viewMatrix * model;
-                modelViewProjection = projectionMatrix * modelView;
+    const GLuint header[2]{(GLuint)instances.size(), 0u};
 
-                _sendSceneBlock(model, viewProjection, modelViewProjection,
-                                viewportMatrix, shadowViewProjections, eyePos);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _rayInstanceSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, RAY_INSTANCES_HEADER_SIZE,
+                    instances.size() * sizeof(RayInstance), instances.data());
 
-                _drawSphere();
-            }
-        }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
 
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_STENCIL_TEST);
-    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11u, _irregularNodeSSBO);
 
-    /* Drawing the teapots */
+    // the G-buffer is still bound from _renderDeferredLighting()
+    glBindImageTexture(0u, _irregularShadow, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R8);
 
-    if (_which_shadows == MAPS) {
-        _shadowMapTesShader->useProgram();
+    // 8 x 8 pixels per work group (must match shadow_irregular_insert.comp)
+    _irregularInsertShader->useProgram();
+    glDispatchCompute((GLuint)(_gBufferWidth + 7) / 8u,
+                      (GLuint)(_gBufferHeight + 7) / 8u, 1u);
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
-    } else
-        _wireTesShader->useProgram();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+                    GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
-    // send material properties
-    materialAmb = materialDiff = {0.4f, 0.f, 0.6f}; // purplish
-    materialSpec = vec3{1.f};                       // white
-    shininess = 64.f;                               // weeeee big specular
+    // one work group per triangle, one row of them per instance (the
+    // dimension is only guaranteed to go up to 65535, the rest wrap around)
+    _irregularTestShader->useProgram();
+    glDispatchCompute(glm::min(maxTriangles, 65'535u),
+                      (GLuint)instances.size(), 1u);
 
-    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+    // the lighting pass samples what the triangles wrote
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
 
-    for (std::size_t i{0}; i < teapot_positions.size(); ++i) {
-        model = glm::translate(mat4(1.f), teapot_positions.at(i));
-        model = glm::rotate(model, PI / -2.f, {1.f, 0.f, 0.f});
-        model = glm::rotate(model, ((GLfloat)i + 1.f) * (PI / 2.f),
-                            {0.f, 0.f, 1.f});
+void Engine::_compareAgainstReference() {
+    GLint width{_gBufferWidth}, height{_gBufferHeight};
 
-        modelView = viewMatrix * model;
-        modelViewProjection = projectionMatrix * modelView;
+    /* GPU Shadow Term */
 
-        _sendSceneBlock(model, viewProjection, modelViewProjection,
-                        viewportMatrix, shadowViewProjections, eyePos);
+    glBindTexture(GL_TEXTURE_2D, _shadowCapture);
 
-        _drawTeapot();
+    // only reallocate when the G-buffer actually changes size
+    if (_shadowCaptureWidth != width || _shadowCaptureHeight != height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED,
+                     GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        _shadowCaptureWidth = width;
+        _shadowCaptureHeight = height;
     }
 
-    /* Drawing the spheres */
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    if (_which_shadows == MAPS) {
-        _shadowMapShader->useProgram();
+    // attach the texture to the framebuffer object
+    glBindFramebuffer(GL_FRAMEBUFFER, _shadowCaptureFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           _shadowCapture, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
-    } else
-        _wireShader->useProgram();
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nSHADOW CAPTURE FRAMEBUFFER IS BROKEN!!" << std::endl;
 
-    // send material properties
-    materialAmb = materialDiff = {1.f, 0.078f, 0.576f}; // pink!
-    materialSpec = vec3{1.f};                           // white
-    shininess = 64.f;                                   // :o shinnne
+    // single channel, nothing to blend with
+    glDisable(GL_BLEND);
 
-    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+    _shadowCaptureShader->useProgram();
 
-    for (std::size_t i{0}; i < sphere_positions.size(); ++i) {
-        model = glm::translate(mat4(1.f), sphere_positions.at(i));
-        model = glm::scale(model, vec3(1.f));
+    glBindVertexArray(_fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(GL_NONE);
 
-        modelView = viewMatrix * model;
-        modelViewProjection = projectionMatrix * modelView;
+    glEnable(GL_BLEND);
 
-        _sendSceneBlock(model, viewProjection, modelViewProjection,
-                        viewportMatrix, shadowViewProjections, eyePos);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        _drawSphere();
-    }
+    // blocks until the GPU is done, fine for a one-off comparison
+    std::vector<GLfloat> gpuShadow(st width * height);
+    std::vector<vec4> gpuPositions(st width * height);
 
-    // outer ring of unmoving circles
-    if (_outerRing) {
-        if (_which_shadows == TEXTURES) {
-            _shadowTextureShader->useProgram();
+    glBindTexture(GL_TEXTURE_2D, _shadowCapture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, gpuShadow.data());
+    glBindTexture(GL_TEXTURE_2D, _gBufferTextures[0]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, gpuPositions.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-            glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+    /* CPU Reference */
 
-        } else if (_which_shadows == MAPS) {
-            _shadowMapShader->useProgram();
+    if (!_referenceTracer) {
+        std::cout << "Building reference tracer BVH ...\n";
 
-            glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
-        } else
-            _wireShader->useProgram();
+        _referenceTracer = new ReferenceTracer;
+        _referenceTracer->setTeapot(_tessellateTeapot(REFERENCE_TEAPOT_LEVEL));
+    }
 
-        materialAmb = materialDiff = {0.f, 0.9804f, 0.6039f}; // pale green?
+    // the GPU's placement, spheres stay analytic
+    SceneInstances scene{_sceneInstances(_angle_offset)};
 
-        _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+    if (_outerRing)
+        scene.spheres.insert(scene.spheres.end(), scene.outerRing.begin(),
+                             scene.outerRing.end());
 
-        for (const auto& pos : outer_sphere_positions) {
-            model = glm::translate(mat4(1.f), pos);
-            model = glm::scale(model, vec3(1.5f));
+    _referenceTracer->setScene(scene.spheres, scene.teapots, 100.f);
 
-            modelView = viewMatrix * model;
-            modelViewProjection = projectionMatrix * modelView;
+    vec4 lightPos{_lightIs(DIRECTIONAL) ? vec4(-_sunDirection(), 0.f)
+                                        : light_position};
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections, eyePos);
+    std::vector<vec4> positions;
+    std::vector<GLfloat> visibility;
 
-            _drawSphere();
-        }
-    }
+    GLuint stealsBefore{_referenceTracer->getSteals()};
+    GLdouble startTime{glfwGetTime()};
 
-    if (_which_shadows == TEXTURES)
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    if (_which_shadows == MAPS)
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    _referenceTracer->render(glm::inverse(_cameraViewProjection),
+                             _arcballCam->getPosition(), lightPos, width,
+                             height, positions, visibility);
 
-    /* Drawing the light */
+    GLdouble cpuTime{glfwGetTime() - startTime};
 
-    _flatLightShader->useProgram();
-    // _wireShader->useProgram();
+    /* Error Metrics */
 
-    // send material properties
-    materialAmb = materialDiff = {1.f, 1.f, 1.f}; // white privilege
-    materialSpec = vec3{1.f};                     // white light buh duh buh duh
-    shininess = 128.f;                            // even shinier ooOOoo
+    // the spot light's cone is lighting, not shadowing, leave what's outside
+    // of it out
+    GLfloat cosCone{glm::cos(_spotConeAngle)};
+    vec3 spotDirection{_spotDirection()};
 
-    _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+    // does a pixel have a surface both sides agree on?
+    auto matched = [&](const GLint& i) {
+        if (visibility.at(st i) < 0.f || gpuPositions.at(st i).w == 0.f)
+            return false;
 
-    // compute and send transformation matrices
-    model = glm::translate(
-        mat4(1.f), vec3(light_position.x, light_position.y, light_position.z));
-    model = glm::scale(model, vec3(0.1f));
+        vec3 position{positions.at(st i)};
+        if (glm::distance(vec3(gpuPositions.at(st i)), position) >
+            REFERENCE_POSITION_TOLERANCE)
+            return false;
 
-    modelView = viewMatrix * model;
-    modelViewProjection = projectionMatrix * modelView;
-    // normalMtx = glm::transpose(glm::inverse(modelView));
+        return !_lightIs(SPOT) ||
+               glm::dot(glm::normalize(position - vec3(light_position)),
+                        spotDirection) >= cosCone;
+    };
 
-    _sendSceneBlock(model, viewProjection, modelViewProjection, viewportMatrix,
-                    shadowViewProjections, eyePos);
+    GLuint numMatched{0u}, falseShadow{0u}, falseLit{0u}, numEdges{0u};
+    GLdouble totalError{0.0}, edgeError{0.0};
 
-    _drawSphere();
+    for (GLint y{0}; y < height; ++y) {
+        for (GLint x{0}; x < width; ++x) {
+            GLint i{y * width + x};
+            if (!matched(i))
+                continue;
 
-    /* Drawing the teapot control points */
+            // both in [0;1], 1 = fully in shadow
+            GLfloat reference{1.f - visibility.at(st i)};
+            GLfloat error{glm::abs(gpuShadow.at(st i) - reference)};
 
-    // _flatShader->useProgram();
-    // // _wireShader->useProgram();
+            ++numMatched;
+            totalError += error;
 
-    // // send material properties
-    // materialAmb = materialDiff = {0.f, 1.f, 0.f}; // oooo so green
-    // materialSpec = vec3{1.f};                     // white
-    // shininess = 128.f;                            // even shinier ooOOoo
+            // acne/over-darkening vs. light leaking/peter-panning
+            if (reference == 0.f && gpuShadow.at(st i) > 0.5f)
+                ++falseShadow;
+            else if (reference == 1.f && gpuShadow.at(st i) < 0.5f)
+                ++falseLit;
 
-    // _sendMaterialBlock(materialAmb, materialDiff, materialSpec, shininess);
+            // aliasing and filtering only show up next to a shadow boundary
+            const GLint neighbours[4][2]{{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
 
-    // // TODO: use instanced rendering for this (maybe that would even be fast
-    // // enough to go back to actually shading the spheres instead of using
-    // flat
-    // // shader)
-    // for (size_t i{st 0u}; i < TEAPOT_NUM_VERTICES; ++i) {
-    //     // compute and send transformation matrices
-    //     model = glm::translate(mat4(1.f), {0.f, 1.f, 0.f});
-    //     model = glm::rotate(model, glm::pi<GLfloat>() / -2.f, {1.f, 0.f,
-    //     0.f}); model = glm::translate(model, teapot_cp_vertices[i]); model =
-    //     glm::scale(model, vec3(0.03f));
+            GLboolean edge{GL_FALSE};
+            for (const auto& offset : neighbours) {
+                GLint nx{x + offset[0]}, ny{y + offset[1]};
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                    continue;
 
-    //     modelView = viewMatrix * model;
-    //     modelViewProjection = projectionMatrix * modelView;
-    //     // normalMtx = glm::transpose(glm::inverse(modelView));
+                GLfloat neighbour{visibility.at(st(ny * width + nx))};
+                if (neighbour >= 0.f && neighbour != visibility.at(st i))
+                    edge = GL_TRUE;
+            }
 
-    //     _sendSceneBlock(model, viewProjection, modelViewProjection,
-    //                     viewportMatrix, eyePos);
+            if (edge) {
+                ++numEdges;
+                edgeError += error;
+            }
+        }
+    }
 
-    //     _drawSphere();
-    // }
+    // what the lighting pass is shading with this frame
+    std::string technique{"shadow maps"};
+    if (_rayTracedShadowsActive())
+        technique = "ray traced";
+    else if (_irregularShadowsActive())
+        technique = "irregular z-buffer";
+    else if (_penumbraTilesActive())
+        technique = "penumbra tiles";
+    else if (_areaLightActive())
+        technique = "area light";
+    else if (_temporalShadowsActive())
+        technique = "temporal";
+    else if (_activeShadowMaskDivisor() > 0)
+        technique =
+            "shadow mask 1/" + std::to_string(_activeShadowMaskDivisor());
+
+    GLdouble percent{numMatched > 0u ? 100.0 / numMatched : 0.0};
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "Reference shadow comparison (" << technique << ", "
+              << numMatched << " of " << width << "x" << height
+              << " pixels matched)\n"
+              << "  mean abs error " << totalError / glm::max(numMatched, 1u)
+              << " | false shadow " << falseShadow * percent << "%"
+              << " | light leaks " << falseLit * percent << "%\n"
+              << "  shadow edges   " << edgeError / glm::max(numEdges, 1u)
+              << " mean abs error over " << numEdges << " pixels\n"
+              << "  CPU reference  " << cpuTime * 1000.0 << " ms | "
+              << (GLdouble)_referenceTracer->getRaysTraced() / cpuTime / 1.0e6
+              << " Mrays/s | " << _referenceTracer->getNumThreads()
+              << " threads | "
+              << _referenceTracer->getSteals() - stealsBefore
+              << " tiles stolen\n"
+              << std::defaultfloat << std::setprecision(6);
 }
 
-void Engine::_renderShadowTextures() {
-    // assign a texture image to each face of the cubemap
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _shadowCubeMap);
+void Engine::_updateSphereOccluders() {
+    std::vector<vec4> spheres;
 
-    for (GLuint i = 0; i < 6u; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA,
-                     SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION, 0,
-                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    }
+    if (_analyticSpheresActive()) {
+        SceneInstances scene{_sceneInstances(_angle_offset)};
+        spheres = scene.spheres;
 
-    // texture settings
-    if (_options(LINEAR_TEXTURE_FILTER)) {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    } else {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        if (_outerRing)
+            spheres.insert(spheres.end(), scene.outerRing.begin(),
+                           scene.outerRing.end());
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    // each face uses the same projection matrix
-    mat4 shadowProjection =
-        glm::perspective(glm::radians(90.f), 1.f, 0.001f, 1'000.f);
+    // a directional light is infinitely far away, only its angular size
+    // matters
+    GLfloat lightRadius{_lightIs(DIRECTIONAL) ? SUN_ANGULAR_RADIUS
+                                              : AREA_LIGHT_RADIUS};
+    GLuint count{(GLuint)spheres.size()};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _sphereOccluderSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), sizeof(GLfloat),
+                    &lightRadius);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, SPHERE_OCCLUDERS_HEADER_SIZE,
+                    spheres.size() * sizeof(vec4), spheres.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
 
-    // faces use different view matrices (right, left, top, bottom, near, far)
-    vec3 lightPos = vec3(light_position);
+void Engine::_bakeDistanceFields() {
+    std::cout << "Baking distance fields ...\n";
+
+    std::string directory{SDF_CACHE_DIRECTORY};
+
+    DistanceField teapot{_tessellateTeapot(SDF_TEAPOT_LEVEL), SDF_RESOLUTION,
+                         directory + "teapot.sdf"};
+    DistanceField sphere{_icosphereTriangles(), SDF_RESOLUTION,
+                         directory + "sphere.sdf"};
+
+    // one texture, the sphere's samples right after the teapot's
+    std::vector<GLfloat> samples{teapot.getDistances()};
+    samples.insert(samples.end(), sphere.getDistances().begin(),
+                   sphere.getDistances().end());
+
+    glBindTexture(GL_TEXTURE_3D, _distanceFields);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, SDF_RESOLUTION, SDF_RESOLUTION,
+                 2 * SDF_RESOLUTION, 0, GL_RED, GL_FLOAT, samples.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    _fieldBounds[0] = vec4(teapot.getBoundsMin(), 0.f);
+    _fieldBounds[1] = vec4(sphere.getBoundsMin(), 0.f);
+    _fieldBounds[2] = vec4(teapot.getBoundsMax(), 0.f);
+    _fieldBounds[3] = vec4(sphere.getBoundsMax(), 0.f);
+
+    // the bounds never change, room for the most instances we'll ever have
+    const GLuint noInstances{0u};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _fieldInstanceSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 FIELD_INSTANCES_HEADER_SIZE +
+                     MAX_FIELD_INSTANCES * sizeof(FieldInstance),
+                 NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(_fieldBounds),
+                    _fieldBounds);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(_fieldBounds),
+                    sizeof(GLuint), &noInstances);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9u, _fieldInstanceSSBO);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+    std::cout << "Distance fields "
+              << (teapot.wasCached() && sphere.wasCached() ? "loaded from "
+                                                           : "cached in ")
+              << directory << "\n";
+}
 
-    std::vector<mat4> shadowViewProjections{
-        glm::lookAt(lightPos, lightPos + vec3(1.f, 0.f, 0.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(-1.f, 0.f, 0.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 1.f, 0.f),
-                    vec3(0.f, 0.f, 1.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, -1.f, 0.f),
-                    vec3(0.f, 0.f, -1.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, 1.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, -1.f),
-                    vec3(0.f, -1.f, 0.f))};
+void Engine::_updateFieldInstances() {
+    std::vector<FieldInstance> instances;
 
-    for (auto& m : shadowViewProjections)
-        m = shadowProjection * m;
+    // the bounds go along with the object, scaled
+    auto place = [&](const mat4& model, const GLuint& field,
+                     const GLfloat& scale) {
+        vec3 boxMin{_fieldBounds[field]}, boxMax{_fieldBounds[field + 2u]};
+        vec3 center{model * vec4((boxMin + boxMax) / 2.f, 1.f)};
+
+        instances.push_back(
+            {glm::inverse(model),
+             vec4(center, glm::length(boxMax - boxMin) / 2.f * scale), field,
+             scale, {0u}});
+    };
+
+    SceneInstances scene{_sceneInstances(_angle_offset)};
+
+    for (std::size_t i{0}; i < scene.teapots.size(); ++i) {
+        place(scene.teapots.at(i), 0u, 1.f);
+        place(sphereModel(scene.spheres.at(i)), 1u, scene.spheres.at(i).w);
+    }
 
-    // rendering code below
+    if (_outerRing)
+        for (const vec4& sphere : scene.outerRing)
+            place(sphereModel(sphere), 1u, sphere.w);
 
-    // matrices to use for setting object transformations
-    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
-    mat4 viewProjection{1.f}, viewportMatrix{1.f};
-    vec3 eyePos{lightPos};
+    GLuint count{(GLuint)instances.size()};
 
-    // positions of objects in the scene
-    std::vector<vec3> teapot_positions{
-        circlePos(9.f, _angle_offset + 0.f, 0.5f),
-        circlePos(9.f, _angle_offset + PI / 2.f, 1.5f),
-        circlePos(9.f, _angle_offset + PI, 0.5f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 2.f, 1.5f)};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _fieldInstanceSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(_fieldBounds),
+                    sizeof(GLuint), &count);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, FIELD_INSTANCES_HEADER_SIZE,
+                    instances.size() * sizeof(FieldInstance),
+                    instances.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
 
-    std::vector<vec3> sphere_positions{
-        circlePos(9.f, _angle_offset + PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 5.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 7.f * PI / 4.f, 1.1f)};
+// shortest distance from a point to the segment [start;end]
+static GLfloat segmentDistance(const vec3& point, const vec3& start,
+                               const vec3& end) {
+    vec3 segment{end - start};
+    GLfloat length2{glm::dot(segment, segment)};
 
-    for (std::size_t i{0}; i < 6u; ++i) {
-        // attach the texture to the framebuffer object
-        glBindFramebuffer(GL_FRAMEBUFFER, _shadowCubeMapFBO);
-        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    GLfloat t{length2 > 0.f ? glm::clamp(glm::dot(point - start, segment) /
+                                             length2,
+                                         0.f, 1.f)
+                            : 0.f};
 
-        glViewport(0, 0, SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION);
+    return glm::distance(point, start + t * segment);
+}
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                               _shadowCubeMap, 0);
+// fit a capsule to a cloud of points: try a segment through their centroid
+// along each coordinate axis and along the direction they spread out the
+// most, keep whichever one hugs the points the closest
+static void fitCapsule(const std::vector<vec3>& points, vec4& start,
+                       vec4& end) {
+    vec3 centroid{0.f};
+    for (const auto& point : points)
+        centroid += point;
+    centroid /= (GLfloat)points.size();
+
+    GLfloat covariance[3][3]{};
+    for (const auto& point : points) {
+        vec3 d{point - centroid};
+
+        for (GLint r{0}; r < 3; ++r)
+            for (GLint c{0}; c < 3; ++c)
+                covariance[r][c] += d[r] * d[c];
+    }
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cerr << "\nSHADOW CUBEMAP FRAMEBUFFER IS BROKEN!!"
-                      << std::endl;
+    // power iteration for the principal direction
+    vec3 principal{glm::normalize(vec3(1.f))};
+    for (GLuint i{0u}; i < 32u; ++i) {
+        vec3 next{0.f};
+        for (GLint r{0}; r < 3; ++r)
+            for (GLint c{0}; c < 3; ++c)
+                next[r] += covariance[r][c] * principal[c];
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-                GL_STENCIL_BUFFER_BIT);
+        if (glm::length(next) == 0.f)
+            break;
+        principal = glm::normalize(next);
+    }
 
-        /* Drawing the spheres */
-        _shadowTextureCubemapShader->useProgram();
+    const vec3 axes[4]{{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f},
+                       principal};
 
-        for (std::size_t j{0}; j < sphere_positions.size(); ++j) {
-            model = glm::translate(mat4(1.f), sphere_positions.at(j));
-            model = glm::scale(model, vec3(1.f));
+    GLfloat bestError{std::numeric_limits<GLfloat>::max()};
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections.at(i),
-                            eyePos);
+    for (const auto& axis : axes) {
+        // how far the points reach along the axis, and away from it
+        GLfloat tMin{std::numeric_limits<GLfloat>::max()};
+        GLfloat tMax{std::numeric_limits<GLfloat>::lowest()};
+        GLfloat radius{0.f};
 
-            _drawSphere();
+        for (const auto& point : points) {
+            GLfloat t{glm::dot(point - centroid, axis)};
+
+            tMin = glm::min(tMin, t);
+            tMax = glm::max(tMax, t);
+            radius += glm::distance(point, centroid + t * axis);
+        }
+        radius /= (GLfloat)points.size();
+
+        // the caps reach past the end points by the radius, a short enough
+        // part just becomes a sphere
+        GLfloat tStart{tMin + radius}, tEnd{tMax - radius};
+        if (tStart > tEnd)
+            tStart = tEnd = (tMin + tMax) / 2.f;
+
+        vec3 a{centroid + tStart * axis}, b{centroid + tEnd * axis};
+
+        // refit the radius to the actual segment, then see how well it fits
+        radius = 0.f;
+        for (const auto& point : points)
+            radius += segmentDistance(point, a, b);
+        radius /= (GLfloat)points.size();
+
+        GLfloat error{0.f};
+        for (const auto& point : points)
+            error += glm::pow(segmentDistance(point, a, b) - radius, 2.f);
+
+        if (error < bestError) {
+            bestError = error;
+            start = vec4(a, radius);
+            end = vec4(b, radius);
         }
+    }
+}
 
-        /* Drawing the teapots */
-        _shadowTextureCubemapTesShader->useProgram();
+void Engine::_fitTeapotProxies() {
+    // first patch and number of patches of each part, in the order
+    // TeapotData.hpp lists them (the rim goes with the body)
+    const GLuint parts[NUM_TEAPOT_PROXIES][2]{
+        {0u, 12u}, {12u, 4u}, {16u, 4u}, {20u, 8u}};
 
-        for (std::size_t j{0}; j < teapot_positions.size(); ++j) {
-            model = glm::translate(mat4(1.f), teapot_positions.at(j));
-            model = glm::rotate(model, PI / -2.f, {1.f, 0.f, 0.f});
-            model = glm::rotate(model, ((GLfloat)j + 1.f) * (PI / 2.f),
-                                {0.f, 0.f, 1.f});
+    std::vector<vec3> vertices{_tessellateTeapot(PROXY_FIT_LEVEL)};
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections.at(i),
-                            eyePos);
+    // every patch is tessellated into the same number of vertices
+    std::size_t perPatch{vertices.size() / TEAPOT_NUM_PATCHES};
 
-            _drawTeapot();
+    for (GLuint i{0u}; i < NUM_TEAPOT_PROXIES; ++i) {
+        std::vector<vec3> points(
+            vertices.begin() + (std::ptrdiff_t)(parts[i][0] * perPatch),
+            vertices.begin() +
+                (std::ptrdiff_t)((parts[i][0] + parts[i][1]) * perPatch));
+
+        fitCapsule(points, _teapotProxyStarts[i], _teapotProxyEnds[i]);
+    }
+}
+
+void Engine::_updateTeapotProxies() {
+    vec3 eyePos{_arcballCam->getPosition()};
+
+    std::vector<mat4> models{_sceneInstances(_angle_offset).teapots};
+    GLfloat distances[4];
+
+    // the translation is where the teapot sits
+    for (GLuint j{0u}; j < 4u; ++j)
+        distances[j] = glm::distance(eyePos, vec3(models[j][3]));
+
+    GLboolean changed{GL_FALSE};
+    std::vector<vec4> capsules;
+
+    for (GLuint j{0u}; j < 4u; ++j) {
+        // every teapot is the same size, so the closer ones are the bigger
+        // ones on screen (ties go to the first one)
+        GLuint rank{0u};
+        for (GLuint k{0u}; k < 4u; ++k)
+            if (distances[k] < distances[j] ||
+                (distances[k] == distances[j] && k < j))
+                ++rank;
+
+        GLboolean proxied{_teapotProxiesActive() &&
+                          (distances[j] > PROXY_DISTANCE ||
+                           rank >= PROXY_FULL_MESH_BUDGET)};
+
+        if (proxied != _teapotProxied[j])
+            changed = GL_TRUE;
+        _teapotProxied[j] = proxied;
+
+        if (!proxied)
+            continue;
+
+        // the model matrix doesn't scale, so the radius carries over
+        for (GLuint i{0u}; i < NUM_TEAPOT_PROXIES; ++i) {
+            capsules.push_back(vec4(
+                vec3(models[j] * vec4(vec3(_teapotProxyStarts[i]), 1.f)),
+                _teapotProxyStarts[i].w));
+            capsules.push_back(
+                models[j] * vec4(vec3(_teapotProxyEnds[i]), 1.f));
         }
     }
 
-    // unbind framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the cached cubemap faces have the wrong casters in them now
+    if (changed)
+        for (GLuint i{0u}; i < 6u; ++i)
+            _faceValid[i] = GL_FALSE;
+
+    GLuint count{(GLuint)capsules.size() / 2u};
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _capsuleOccluderSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, CAPSULE_OCCLUDERS_HEADER_SIZE,
+                    capsules.size() * sizeof(vec4), capsules.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
 }
 
-void Engine::_renderShadowMaps() {
-    /* https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows */
+void Engine::_renderShadowAtlas(const mat4& viewMatrix,
+                                const mat4& projectionMatrix,
+                                const GLfloat& viewportHeight) {
+    mat4 viewProjection{projectionMatrix * viewMatrix};
+
+    // how many pixels one world unit covers at a distance of one unit
+    GLfloat pixelsPerUnit{projectionMatrix[1][1] * 0.5f * viewportHeight};
+
+    // tiles rendered this frame, cleared before drawing into them
+    std::vector<ShadowAtlas::Tile> renderedTiles;
+
+    for (GLuint i{0u}; i < _numPointLights; ++i) {
+        vec3 center{_pointLights.at(i).position};
+        GLfloat radius{_pointLights.at(i).position.w};
+
+        // off screen lights don't get tiles, their old ones age out via LRU
+        if (!_sphereInFrustum(viewProjection,
+                              _pointLights.at(i).position)) {
+            for (GLuint face{0u}; face < 6u; ++face)
+                _faceTiles.at(6u * i + face) = vec4(0.f);
+            continue;
+        }
+
+        // each face gets about half the light's projected diameter (and the
+        // biggest tile if the camera is inside the light's radius)
+        GLfloat distance{glm::length(vec3(viewMatrix * vec4(center, 1.f)))};
+        GLfloat tileSize{(GLfloat)SHADOW_ATLAS_MAX_TILE};
+        if (distance > radius)
+            tileSize = glm::clamp(radius / distance * pixelsPerUnit,
+                                  (GLfloat)SHADOW_ATLAS_MIN_TILE,
+                                  (GLfloat)SHADOW_ATLAS_MAX_TILE);
+
+        for (GLuint face{0u}; face < 6u; ++face) {
+            ShadowAtlas::Tile tile;
+
+            // atlas is full of tiles needed this frame, go unshadowed
+            if (!_shadowAtlas->acquire(6u * i + face, (GLuint)tileSize,
+                                       _frameCount, tile)) {
+                _faceTiles.at(6u * i + face) = vec4(0.f);
+                continue;
+            }
+
+            _faceTiles.at(6u * i + face) =
+                vec4(tile.x, tile.y, tile.size, tile.size) /
+                (GLfloat)SHADOW_ATLAS_SIZE;
+            renderedTiles.push_back(tile);
+        }
+    }
+
+    // tell the geometry shader (and receivers) where every face went
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _shadowTileSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                    6u * _numPointLights * sizeof(vec4), _faceTiles.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     // cull front faces to fix peter-panning
     if (_options(MAPS_CULL_FRONT_FACE))
         glCullFace(GL_FRONT);
 
-    // assign a texture image to each face of the cubemap
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubeMap);
+    glBindTexture(GL_TEXTURE_2D, _shadowAtlasMap);
 
-    for (GLuint i = 0; i < 6u; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-                     SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION, 0,
-                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    // the atlas is allocated once, its size is the whole memory budget
+    if (_shadowAtlasResolution != SHADOW_ATLAS_SIZE) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_ATLAS_SIZE,
+                     SHADOW_ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+        _shadowAtlasResolution = SHADOW_ATLAS_SIZE;
     }
 
     // texture settings
     if (_options(LINEAR_TEXTURE_FILTER)) {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     } else {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // each face uses the same projection matrix
-    mat4 shadowProjection =
-        glm::perspective(glm::radians(90.f), 1.f, 0.001f, 1'000.f);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    // faces use different view matrices (right, left, top, bottom, near, far)
-    vec3 lightPos = vec3(light_position);
+    // attach the texture to the framebuffer object
+    glBindFramebuffer(GL_FRAMEBUFFER, _shadowAtlasFBO);
+    glDrawBuffer(GL_NONE);
 
-    std::vector<mat4> shadowViewProjections{
-        glm::lookAt(lightPos, lightPos + vec3(1.f, 0.f, 0.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(-1.f, 0.f, 0.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 1.f, 0.f),
-                    vec3(0.f, 0.f, 1.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, -1.f, 0.f),
-                    vec3(0.f, 0.f, -1.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, 1.f),
-                    vec3(0.f, -1.f, 0.f)),
-        glm::lookAt(lightPos, lightPos + vec3(0.f, 0.f, -1.f),
-                    vec3(0.f, -1.f, 0.f))};
+    glViewport(0, 0, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
 
-    for (auto& m : shadowViewProjections)
-        m = shadowProjection * m;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                           _shadowAtlasMap, 0);
 
-    // rendering code below
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "\nSHADOW ATLAS FRAMEBUFFER IS BROKEN!!" << std::endl;
 
-    // matrices to use for setting object transformations
-    mat4 model{1.f}, modelView{1.f}, modelViewProjection{1.f};
-    mat4 viewProjection{1.f}, viewportMatrix{1.f};
-    vec3 eyePos{lightPos};
+    // only clear the tiles being redrawn, the rest keep whatever they had
+    glEnable(GL_SCISSOR_TEST);
+    for (const auto& tile : renderedTiles) {
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
 
-    // positions of objects in the scene
-    std::vector<vec3> teapot_positions{
-        circlePos(9.f, _angle_offset + 0.f, 0.5f),
-        circlePos(9.f, _angle_offset + PI / 2.f, 1.5f),
-        circlePos(9.f, _angle_offset + PI, 0.5f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 2.f, 1.5f)};
-
-    std::vector<vec3> sphere_positions{
-        circlePos(9.f, _angle_offset + PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 3.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 5.f * PI / 4.f, 1.1f),
-        circlePos(9.f, _angle_offset + 7.f * PI / 4.f, 1.1f)};
-
-    std::vector<vec3> outer_sphere_positions{
-        circlePos(20.f, 0.f, 1.6f),
-        circlePos(20.f, PI / 4.f, 1.6f),
-        circlePos(20.f, PI / 2.f, 1.6f),
-        circlePos(20.f, 3.f * PI / 4.f, 1.6f),
-        circlePos(20.f, PI, 1.6f),
-        circlePos(20.f, 5.f * PI / 4.f, 1.6f),
-        circlePos(20.f, 3.f * PI / 2.f, 1.6f),
-        circlePos(20.f, 7.f * PI / 4.f, 1.6f)};
+    // geometry shader clips every face to its own tile
+    for (GLuint i{0u}; i < 4u; ++i)
+        glEnable(GL_CLIP_DISTANCE0 + i);
 
-    for (std::size_t i{0}; i < 6u; ++i) {
-        // attach the texture to the framebuffer object
-        glBindFramebuffer(GL_FRAMEBUFFER, _depthCubeMapFBO);
-        glDrawBuffer(GL_NONE);
+    // one instance per light, one geometry shader invocation per face
+    _renderShadowCasters(_depthAtlasShader, _depthAtlasTesShader, mat4(1.f),
+                         vec3(0.f), (GLsizei)_numPointLights);
 
-        glViewport(0, 0, SHADOW_TEXTURE_RESOLUTION, SHADOW_TEXTURE_RESOLUTION);
+    for (GLuint i{0u}; i < 4u; ++i)
+        glDisable(GL_CLIP_DISTANCE0 + i);
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                               _depthCubeMap, 0);
+    // unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cerr << "\nDEPTH CUBEMAP FRAMEBUFFER IS BROKEN!!" << std::endl;
+    // cull back faces again
+    glCullFace(GL_BACK);
+}
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-                GL_STENCIL_BUFFER_BIT);
+GLboolean Engine::_sphereInFrustum(const mat4& viewProjection,
+                                  const vec4& sphere) {
+    // frustum planes straight from the matrix rows (Gribb & Hartmann)
+    mat4 rows{glm::transpose(viewProjection)};
 
-        /* Drawing the spheres */
-        _depthCubemapShader->useProgram();
+    for (GLint i{0}; i < 3; ++i) {
+        for (const vec4& plane : {rows[3] + rows[i], rows[3] - rows[i]}) {
+            if (glm::dot(vec3(plane), vec3(sphere)) + plane.w <
+                -sphere.w * glm::length(vec3(plane)))
+                return GL_FALSE;
+        }
+    }
 
-        for (const auto& pos : sphere_positions) {
-            model = glm::translate(mat4(1.f), pos);
-            model = glm::scale(model, vec3(1.f));
+    return GL_TRUE;
+}
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections.at(i),
-                            eyePos);
+GLuint Engine::_sphereLod(const GLuint& view, const GLuint& sphere,
+                          const vec3& center, const GLfloat& radius,
+                          const mat4& viewProjection) {
+    if (!_options(SPHERE_LOD))
+        return SPHERE_SUBDIVISIONS;
+
+    // exact shadows trace against the default level, a coarser sphere in the
+    // G-buffer would sit further inside it than the rays are offset
+    if (view == 0u && _exactShadowsActive())
+        return SPHERE_SUBDIVISIONS;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // how fast clip x and y change per world unit (the projection's scale,
+    // whatever the view's rotation)
+    mat4 rows{glm::transpose(viewProjection)};
+    vec4 clip{viewProjection * vec4(center, 1.f)};
+
+    // the icosahedron's edges are about as long as its radius, and every
+    // level halves them
+    GLfloat wanted{(GLfloat)SPHERE_LOD_MAX};
+
+    // the finest level when the sphere reaches the eye
+    if (clip.w > radius) {
+        GLfloat pixelRadius{
+            0.5f * radius / clip.w *
+            glm::max(glm::length(vec3(rows[0])) * (GLfloat)viewport[2],
+                     glm::length(vec3(rows[1])) * (GLfloat)viewport[3])};
+
+        wanted = glm::clamp(
+            glm::log2(glm::max(1.05f * pixelRadius / SPHERE_LOD_EDGE_PIXELS,
+                               1.f)),
+            (GLfloat)SPHERE_LOD_MIN, (GLfloat)SPHERE_LOD_MAX);
+    }
 
-            _drawSphere();
-        }
+    // only switch once the wanted level is clearly closer to another one
+    auto [entry, added]{_sphereLods.try_emplace(
+        view << 16u | sphere, (GLuint)glm::round(wanted))};
 
-        if (_outerRing) {
-            for (const auto& pos : outer_sphere_positions) {
-                model = glm::translate(mat4(1.f), pos);
-                model = glm::scale(model, vec3(1.5f));
+    if (!added && glm::abs(wanted - (GLfloat)entry->second) >
+                      0.5f + SPHERE_LOD_HYSTERESIS)
+        entry->second = (GLuint)glm::round(wanted);
 
-                _sendSceneBlock(model, viewProjection, modelViewProjection,
-                                viewportMatrix, shadowViewProjections.at(i),
-                                eyePos);
+    return entry->second;
+}
 
-                _drawSphere();
-            }
+std::vector<vec4> Engine::_movingCasterBounds(const GLfloat& angleOffset) {
+    // the outer ring never moves
+    SceneInstances scene{_sceneInstances(angleOffset)};
+    std::vector<vec4> bounds{scene.spheres};
+
+    // the teapots are centered on their translation
+    for (const mat4& model : scene.teapots)
+        bounds.push_back(vec4(vec3(model[3]), TEAPOT_BOUNDING_RADIUS));
+
+    return bounds;
+}
+
+std::vector<vec4> Engine::_shadowCasterBounds() {
+    std::vector<vec4> bounds{_movingCasterBounds(_angle_offset)};
+
+    if (_outerRing) {
+        std::vector<vec4> outerRing{_sceneInstances(_angle_offset).outerRing};
+        bounds.insert(bounds.end(), outerRing.begin(), outerRing.end());
+    }
+
+    return bounds;
+}
+
+vec2 Engine::_fitShadowDepthRange(const vec3& eye, const vec3& axis,
+                                  const mat4& viewProjection) {
+    GLfloat nearZ{std::numeric_limits<GLfloat>::max()}, farZ{0.f};
+
+    // depth of each caster's bounding sphere along the axis
+    for (const vec4& sphere : _shadowCasterBounds()) {
+        if (!_sphereInFrustum(viewProjection, sphere))
+            continue;
+
+        GLfloat z{glm::dot(vec3(sphere) - eye, axis)};
+        nearZ = glm::min(nearZ, z - sphere.w);
+        farZ = glm::max(farZ, z + sphere.w);
+    }
+
+    // nothing to cast a shadow, any (sane) range does
+    if (farZ <= SHADOW_MIN_NEAR)
+        return vec2(SHADOW_MIN_NEAR, 1.f);
+
+    return vec2(glm::max(nearZ, SHADOW_MIN_NEAR), farZ);
+}
+
+GLenum Engine::_shadowDepthInternalFormat() {
+    switch (_shadowDepthFormat) {
+    case DEPTH_16:
+        return GL_DEPTH_COMPONENT16;
+    case DEPTH_32F:
+        return GL_DEPTH_COMPONENT32F;
+    default:
+        return GL_DEPTH_COMPONENT24;
+    }
+}
+
+GLfloat Engine::_shadowFacePriority(const GLuint& face,
+                                    const mat4& faceViewProjection) {
+    // never rendered (or reallocated), can't put it off
+    if (!_faceValid[face])
+        return std::numeric_limits<GLfloat>::max();
+
+    vec3 lightPos = vec3(light_position);
+
+    GLfloat lightMotion{glm::distance(lightPos, _faceLightPositions[face])};
+
+    // only casters that were or are inside this face's frustum matter
+    GLfloat casterMotion{0.f};
+    if (_faceAngleOffsets[face] != _angle_offset) {
+        std::vector<vec4> before{_movingCasterBounds(_faceAngleOffsets[face])};
+        std::vector<vec4> after{_movingCasterBounds(_angle_offset)};
+
+        for (std::size_t i{0}; i < after.size(); ++i) {
+            if (_sphereInFrustum(faceViewProjection, before.at(i)) ||
+                _sphereInFrustum(faceViewProjection, after.at(i)))
+                casterMotion +=
+                    glm::distance(vec3(before.at(i)), vec3(after.at(i)));
         }
+    }
 
-        /* Drawing the teapots */
-        _depthCubemapTesShader->useProgram();
+    if (lightMotion + casterMotion == 0.f)
+        return 0.f;
 
-        for (std::size_t j{0}; j < teapot_positions.size(); ++j) {
-            model = glm::translate(mat4(1.f), teapot_positions.at(j));
-            model = glm::rotate(model, PI / -2.f, {1.f, 0.f, 0.f});
-            model = glm::rotate(model, ((GLfloat)j + 1.f) * (PI / 2.f),
-                                {0.f, 0.f, 1.f});
+    // screen-space importance: shoot a few rays through the face and count
+    // how many points along them the camera can see
+    mat4 inverseFace{glm::inverse(faceViewProjection)};
+    GLfloat samplesOnScreen{0.f}, samples{0.f};
 
-            _sendSceneBlock(model, viewProjection, modelViewProjection,
-                            viewportMatrix, shadowViewProjections.at(i),
-                            eyePos);
+    for (GLfloat u : {-0.9f, 0.f, 0.9f}) {
+        for (GLfloat v : {-0.9f, 0.f, 0.9f}) {
+            vec4 farPoint{inverseFace * vec4(u, v, 1.f, 1.f)};
+            vec3 rayDir{glm::normalize(vec3(farPoint) / farPoint.w - lightPos)};
 
-            _drawTeapot();
+            for (GLfloat distance : {5.f, 15.f}) {
+                vec4 clip{_cameraViewProjection *
+                          vec4(lightPos + distance * rayDir, 1.f)};
+
+                if (glm::all(glm::lessThanEqual(glm::abs(vec3(clip)),
+                                                vec3(clip.w))))
+                    ++samplesOnScreen;
+                ++samples;
+            }
         }
     }
 
-    // unbind framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLfloat importance{0.1f + samplesOnScreen / samples};
 
-    // cull back faces again
-    glCullFace(GL_BACK);
+    // faces that keep getting skipped slowly bubble up
+    GLfloat staleness{1.f + 0.25f * (GLfloat)(_frameCount -
+                                              _faceLastRendered[face])};
+
+    return importance * (lightMotion + casterMotion) * staleness;
+}
+
+vec3 Engine::_sunDirection() {
+    // light height [1, 9] maps onto a sun elevation of [20, 80] degrees
+    GLfloat elevation{glm::radians(20.f + (light_position.y - 1.f) * 7.5f)};
+
+    return -vec3(glm::cos(elevation) * glm::cos(SUN_AZIMUTH),
+                 glm::sin(elevation),
+                 glm::cos(elevation) * glm::sin(SUN_AZIMUTH));
 }
 
 void Engine::_updateScene() {
@@ -1479,13 +5107,93 @@ void Engine::_updateScene() {
 
     // update window title
     std::stringstream ss;
-    ss << _windowTitle << glm::floor(_tessLevel) << " | " << std::fixed
-       << std::setprecision(3) << _fps << " FPS ]";
+    ss << _windowTitle << glm::floor(_tessLevel) << " | ";
+
+    // show how often the time-sliced shadow updates fit in their budget
+    if (_lightIs(POINT) && _options(MAPS_TIME_SLICED) &&
+        !_options(MAPS_DUAL_PARABOLOID))
+        ss << "Shadow Budget " << std::fixed << std::setprecision(2)
+           << _shadowScheduler->getBudget() << " ms ("
+           << 100.f * _shadowScheduler->getHitRate() << "% hit) | ";
+
+    if (_which_shadows == MAPS && _options(MAPS_DEFERRED))
+        ss << "Deferred | ";
+
+    if ((_which_shadows == TEXTURES || _which_shadows == MAPS) &&
+        _options(DEPTH_PREPASS))
+        ss << "Depth Pre-Pass | ";
+
+    if (_which_shadows == TEXTURES && _options(TEXTURES_PREFILTER))
+        ss << "Prefiltered | ";
+
+    if (_options(REVERSED_Z))
+        ss << "Reversed-Z | ";
+
+    if (_options(SPHERE_LOD))
+        ss << "Sphere LOD | ";
+
+    // show what the single light's depth maps are stored as
+    if (_which_shadows == MAPS && !_lightIs(MULTI_POINT))
+        ss << "Depth "
+           << (_shadowDepthFormat == DEPTH_16   ? "16"
+               : _shadowDepthFormat == DEPTH_24 ? "24"
+                                                : "32F")
+           << " | ";
+
+    if (_activeShadowMaskDivisor() > 0)
+        ss << "Shadow Mask 1/" << _activeShadowMaskDivisor() << " Res | ";
+
+    // show how many light samples the history is averaging
+    if (_areaLightActive())
+        ss << (_areaLightShape == SPHERE_EMITTER ? "Sphere" : "Quad")
+           << " Light " << _areaLightSamples
+           << (_options(MAPS_AREA_PROGRESSIVE) ? " Samples (Progressive) | "
+                                               : " Samples | ");
+    else if (_temporalShadowsActive())
+        ss << "Temporal Shadows (" << TEMPORAL_SHADOW_TAPS << " Taps) | ";
+
+    // show how fast the shadow rays are going (GPU time only)
+    if (_rayTracedShadowsActive())
+        ss << "Ray Traced " << std::fixed << std::setprecision(1)
+           << _raysPerSecond / 1.0e6 << " Mrays/s | ";
+
+    if (_irregularShadowsActive())
+        ss << "Irregular Z-Buffer | ";
+
+    if (_sdfShadowsActive())
+        ss << "SDF Shadows | ";
+
+    // show how many teapots are only shadowed by their capsules
+    if (_teapotProxiesActive()) {
+        GLuint proxied{0u};
+        for (GLuint j{0u}; j < 4u; ++j)
+            proxied += _teapotProxied[j] ? 1u : 0u;
+
+        ss << "Teapot Proxies " << proxied << "/4 | ";
+    }
+
+    // show how much of the screen still needed the full filter
+    if (_penumbraTilesActive())
+        ss << "Penumbra " << std::fixed << std::setprecision(1)
+           << 100.f * _penumbraFraction << "% Filtered | ";
+
+    // show how full the shadow atlas is
+    if (_lightIs(MULTI_POINT) && _options(MAPS_SHADOW_ATLAS))
+        ss << "Atlas Tiles " << _shadowAtlas->getNumTiles() << " ("
+           << _shadowAtlas->getEvictions() << " evicted) | ";
+
+    ss << std::fixed << std::setprecision(3) << _fps << " FPS ]";
     _windowTitle = ss.str();
 
     // display new window title
     glfwSetWindowTitle(_window, _windowTitle.c_str());
 
+    ++_frameCount;
+
+    // the shadow history goes stale as soon as a frame skips accumulating
+    if (!_temporalShadowsActive())
+        _shadowHistoryValid = GL_FALSE;
+
     // animating the objects
     if (_spinObjects) {
         _angle_offset += 0.01f;
@@ -1510,21 +5218,23 @@ void Engine::_drawPlatform() {
     glBindVertexArray(GL_NONE); // unbind platform VAO
 }
 
-void Engine::_drawTeapot() {
+void Engine::_drawTeapot(const GLsizei& instanceCount) {
     glBindVertexArray(_vaos[VAO_ID::TEAPOT]); // bind teapot VAO
 
-    glDrawElements(GL_PATCHES,
-                   TEAPOT_NUM_PATCHES * PATCH_DIMENSION * PATCH_DIMENSION,
-                   GL_UNSIGNED_SHORT, GL_NONE);
+    glDrawElementsInstanced(
+        GL_PATCHES, TEAPOT_NUM_PATCHES * PATCH_DIMENSION * PATCH_DIMENSION,
+        GL_UNSIGNED_SHORT, GL_NONE, instanceCount);
 
     glBindVertexArray(GL_NONE); // unbind teapot VAO
 }
 
-void Engine::_drawSphere() {
+void Engine::_drawSphere(const GLsizei& instanceCount, const GLuint& lod) {
+    const SphereLevel& level{_sphereLevels[lod - SPHERE_LOD_MIN]};
+
     glBindVertexArray(_vaos[VAO_ID::SPHERE]); // bind sphere VAO
 
-    glDrawElements(GL_TRIANGLES, _numVAOPoints[VAO_ID::SPHERE],
-                   GL_UNSIGNED_SHORT, GL_NONE);
+    glDrawElementsInstanced(GL_TRIANGLES, level.count, _sphereIndexType,
+                            (void*)level.offset, instanceCount);
 
     glBindVertexArray(GL_NONE); // unbind sphere VAO
 }
@@ -1534,18 +5244,19 @@ void Engine::_drawSphere() {
 
 void Engine::_createPlatform(const GLuint& vao, const GLuint& vbo,
                              const GLuint& ibo, GLsizei& numVAOPoints) {
-    // container for our vertex data
+    // container for our vertex data (see VERTEX_FORMATS)
     struct VertexAttributes {
-        GLfloat x, y, z;    // x. y, z position
-        GLfloat nx, ny, nz; // x, y, z normal vector
+        GLuint position, normal; // x, y, z in 10 bits each
     };
 
     // create our platform
+    const GLuint up{glm::packSnorm3x10_1x2(vec4(0.f, 1.f, 0.f, 0.f))};
+
     VertexAttributes platformVertices[4] = {
-        {-1.f, 0.f, -1.f, 0.f, 1.f, 0.f}, // 0 - BL
-        {1.f, 0.0f, -1.f, 0.f, 1.f, 0.f}, // 1 - BR
-        {-1.f, 0.f, 1.f, 0.f, 1.f, 0.f},  // 2 - TL
-        {1.f, 0.f, 1.f, 0.f, 1.f, 0.f}    // 3 - TR
+        {glm::packSnorm3x10_1x2(vec4(-1.f, 0.f, -1.f, 0.f)), up}, // 0 - BL
+        {glm::packSnorm3x10_1x2(vec4(1.f, 0.f, -1.f, 0.f)), up},  // 1 - BR
+        {glm::packSnorm3x10_1x2(vec4(-1.f, 0.f, 1.f, 0.f)), up},  // 2 - TL
+        {glm::packSnorm3x10_1x2(vec4(1.f, 0.f, 1.f, 0.f)), up}    // 3 - TR
     };
 
     // order to connect the vertices in
@@ -1560,19 +5271,8 @@ void Engine::_createPlatform(const GLuint& vao, const GLuint& vbo,
     glBufferData(GL_ARRAY_BUFFER, sizeof(platformVertices), platformVertices,
                  GL_STATIC_DRAW);
 
-    // doesn't matter which program we query (attribute layouts should match)
-    GLuint vPosAttribLocation{_wireShader->getAttributeLocation("vPos")};
-    GLuint vNormAttribLocation{_wireShader->getAttributeLocation("vNorm")};
-
     // enable generic attribute arrays and define access patterns
-    glEnableVertexAttribArray(vPosAttribLocation);
-    glVertexAttribPointer(vPosAttribLocation, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(VertexAttributes), GL_NONE);
-
-    glEnableVertexAttribArray(vNormAttribLocation);
-    glVertexAttribPointer(vNormAttribLocation, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(VertexAttributes),
-                          (void*)(sizeof(GLfloat) * 3));
+    _setVertexFormat(VAO_ID::PLATFORM);
 
     // bind and fill index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
@@ -1587,14 +5287,14 @@ void Engine::_createPlatform(const GLuint& vao, const GLuint& vbo,
 
 void Engine::_createTeapot(const GLuint& vao, const GLuint& vbo,
                            const GLuint& ibo, GLsizei& numVAOPoints) {
-    // retrieve control point vertices (normals will be calculated on GPU)
-    vec3 teapotVertices[TEAPOT_NUM_VERTICES];
+    // retrieve control point vertices (normals will be calculated on GPU), as
+    // half floats (see VERTEX_FORMATS)
+    GLuint64 teapotVertices[TEAPOT_NUM_VERTICES];
 
-    for (size_t i{(size_t)0u}; i < TEAPOT_NUM_VERTICES; ++i) {
-        teapotVertices[i].x = teapot_cp_vertices[i].x;
-        teapotVertices[i].y = teapot_cp_vertices[i].y;
-        teapotVertices[i].z = teapot_cp_vertices[i].z;
-    }
+    for (size_t i{(size_t)0u}; i < TEAPOT_NUM_VERTICES; ++i)
+        teapotVertices[i] = glm::packHalf4x16(
+            vec4(teapot_cp_vertices[i].x, teapot_cp_vertices[i].y,
+                 teapot_cp_vertices[i].z, 0.f));
 
     // order to connect the vertices in
     numVAOPoints = TEAPOT_NUM_PATCHES * PATCH_DIMENSION * PATCH_DIMENSION;
@@ -1611,13 +5311,8 @@ void Engine::_createTeapot(const GLuint& vao, const GLuint& vbo,
     glBufferData(GL_ARRAY_BUFFER, sizeof(teapotVertices), teapotVertices,
                  GL_STATIC_DRAW);
 
-    // doesn't matter which program we query (attribute layouts should match)
-    GLuint vPosAttribLocation{_wireTesShader->getAttributeLocation("vPos")};
-
     // enable generic attribute arrays and define access patterns
-    glEnableVertexAttribArray(vPosAttribLocation);
-    glVertexAttribPointer(vPosAttribLocation, 3, GL_FLOAT, GL_FALSE, GL_NONE,
-                          GL_NONE);
+    _setVertexFormat(VAO_ID::TEAPOT);
 
     // bind and fill index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
@@ -1633,123 +5328,145 @@ void Engine::_createTeapot(const GLuint& vao, const GLuint& vbo,
 void Engine::_createSphere(const GLuint& vao, const GLuint& vbo,
                            const GLuint& ibo, GLsizei& numVAOPoints) {
     std::vector<GLfloat> vertices;
-    std::vector<GLushort> indices;
+    std::vector<GLuint> indices, levelIndices;
 
-    _buildIcosphere(vertices, indices); // generate vertices
+    _buildIcosphere(vertices, indices, SPHERE_LOD_MIN); // generate vertices
 
-    // TODO: optimize the index buffer
+    // every level goes after the last one in the same index list, reordered
+    // to reuse as many transformed vertices as possible in every pass
+    GLfloat missesBefore{0.f}, missesAfter{0.f};
 
-    // container for our vertex data
-    struct VertexAttributes {
-        GLfloat x, y, z;    // x. y, z position
-        GLfloat nx, ny, nz; // x, y, z normal vector
-    };
+    for (GLuint lod{SPHERE_LOD_MIN}; lod <= SPHERE_LOD_MAX; ++lod) {
+        if (lod > SPHERE_LOD_MIN)
+            _subdivideIcosahedron(vertices, indices);
+
+        std::vector<GLuint> optimized{VertexCache::optimize(
+            indices, (GLuint)(vertices.size() / 3ul))};
 
-    // create our sphere, generate normals (sphere starts at origin)
-    VertexAttributes sphereVertices[indices.size()];
+        if (lod == SPHERE_SUBDIVISIONS) {
+            missesBefore = VertexCache::missRatio(indices);
+            missesAfter = VertexCache::missRatio(optimized);
+        }
 
-    for (size_t i{0ul}; i < indices.size(); ++i) {
-        sphereVertices[i] = {
-            vertices.at(i * 3),     vertices.at(i * 3 + 1),
-            vertices.at(i * 3 + 2), // position
-            vertices.at(i * 3),     vertices.at(i * 3 + 1),
-            vertices.at(i * 3 + 2) // normal
-        };
+        _sphereLevels[lod - SPHERE_LOD_MIN] = {(GLsizei)optimized.size(),
+                                               (GLintptr)levelIndices.size()};
+        levelIndices.insert(levelIndices.end(), optimized.begin(),
+                            optimized.end());
     }
 
-    // order to connect the vertices in
-    numVAOPoints = (GLsizei)indices.size();
+    const GLuint numVertices{(GLuint)(vertices.size() / 3ul)};
+
+    // container for our vertex data, just the position in 10 bits per
+    // component (see VERTEX_FORMATS), the normal reads the same word
+    std::vector<GLuint> sphereVertices(numVertices);
+
+    for (size_t i{0ul}; i < numVertices; ++i)
+        sphereVertices.at(i) = glm::packSnorm3x10_1x2(
+            vec4(vertices.at(i * 3), vertices.at(i * 3 + 1),
+                 vertices.at(i * 3 + 2), 0.f));
+
+    // order to connect the vertices in (at the default level)
+    numVAOPoints = _sphereLevels[SPHERE_SUBDIVISIONS - SPHERE_LOD_MIN].count;
 
     glBindVertexArray(vao); // vind sphere VAO
 
     // bind and fill vertex buffer
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(sphereVertices), sphereVertices,
-                 GL_STATIC_DRAW);
-
-    // doesn't matter which program we query (attribute layouts should
-    // match)
-    GLuint vPosAttribLocation{_wireShader->getAttributeLocation("vPos")};
-    GLuint vNormAttribLocation{_wireShader->getAttributeLocation("vNorm")};
+    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(GLuint),
+                 sphereVertices.data(), GL_STATIC_DRAW);
 
     // enable generic attribute arrays and define access patterns
-    glEnableVertexAttribArray(vPosAttribLocation);
-    glVertexAttribPointer(vPosAttribLocation, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(VertexAttributes), GL_NONE);
+    _setVertexFormat(VAO_ID::SPHERE);
 
-    glEnableVertexAttribArray(vNormAttribLocation);
-    glVertexAttribPointer(vNormAttribLocation, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(VertexAttributes),
-                          (void*)(sizeof(GLfloat) * 3));
+    // bind and fill index buffer, 16-bit indices as long as they fit
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-    // bind and fill index buffer
-    GLushort sphereIndices[indices.size()];
-    for (int i = 0; i < indices.size(); ++i)
-        sphereIndices[i] = indices.at(i);
+    if (numVertices <= (GLuint)std::numeric_limits<GLushort>::max() + 1u) {
+        _sphereIndexType = GL_UNSIGNED_SHORT;
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(sphereIndices), sphereIndices,
-                 GL_STATIC_DRAW);
+        std::vector<GLushort> shortIndices(levelIndices.begin(),
+                                           levelIndices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     shortIndices.size() * sizeof(GLushort),
+                     shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+        _sphereIndexType = GL_UNSIGNED_INT;
+
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     levelIndices.size() * sizeof(GLuint), levelIndices.data(),
+                     GL_STATIC_DRAW);
+    }
+
+    // the offsets were counted in indices, the draws need bytes
+    for (auto& level : _sphereLevels)
+        level.offset *= _sphereIndexType == GL_UNSIGNED_SHORT
+                            ? (GLintptr)sizeof(GLushort)
+                            : (GLintptr)sizeof(GLuint);
 
     glBindVertexArray(GL_NONE); // unbind sphere VAO
 
     std::cout << "Sphere read into GPU memory with VAO/VBO/IBO " << vao << '/'
-              << vbo << '/' << ibo << " & " << numVAOPoints << " points\n";
+              << vbo << '/' << ibo << " & " << numVAOPoints << " points ("
+              << numVertices << " vertices for levels " << SPHERE_LOD_MIN
+              << '-' << SPHERE_LOD_MAX << ", " << std::fixed
+              << std::setprecision(2) << missesBefore << " -> " << missesAfter
+              << " vertex shader runs per triangle)\n"
+              << std::defaultfloat;
+}
+
+void Engine::_setVertexFormat(const VAO_ID& mesh) {
+    const VertexFormat& format{VERTEX_FORMATS[mesh]};
+
+    for (const auto& [location, attribute] :
+         {std::pair{VPOS_LOCATION, format.position},
+          std::pair{VNORM_LOCATION, format.normal}}) {
+        if (attribute.size == 0)
+            continue;
+
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, attribute.size, attribute.type,
+                              attribute.normalized, format.stride,
+                              (void*)(size_t)attribute.offset);
+    }
 }
 
 void Engine::_buildIcosphere(std::vector<GLfloat>& vertices,
-                             std::vector<GLushort>& indices) {
+                             std::vector<GLuint>& indices,
+                             const GLuint& subdivisions) {
     /* https://www.songho.ca/opengl/gl_sphere.html */
 
-    // compute 12 shared vertices of icosahedron
-    std::vector<GLfloat> tmpVertices{_generateIcosahedron()};
-
-    // clear memory of prev arrays
-    std::vector<GLfloat>().swap(vertices);
-    std::vector<GLushort>().swap(indices);
+    // 12 shared vertices of icosahedron
+    vertices = _generateIcosahedron();
 
-    const GLfloat *v0, *v1, *v2, *v3, *v4, *v11; // vertex positions
-    GLushort index{0u};
+    // clear memory of prev array
+    std::vector<GLuint>().swap(indices);
 
-    // compute and add 20 triangles of icosahedron first
-    v0 = &tmpVertices.at(0);       // 1st vertex
-    v11 = &tmpVertices.at(11 * 3); // 12th vertex
+    // the top vertex, the 2 rows of 5, and the bottom vertex
+    constexpr GLuint v0{0u}, v11{11u};
+    GLuint v1, v2, v3, v4;
 
-    for (int i = 1; i <= 5; ++i) {
+    // add 20 triangles of icosahedron first
+    for (GLuint i{1u}; i <= 5u; ++i) {
         // 4 vertices in the 2nd row
-        v1 = &tmpVertices.at(i * 3);
-        if (i < 5)
-            v2 = &tmpVertices.at((i + 1) * 3);
-        else
-            v2 = &tmpVertices.at(3);
-
-        v3 = &tmpVertices.at((i + 5) * 3);
-        if ((i + 5) < 10)
-            v4 = &tmpVertices.at((i + 6) * 3);
-        else
-            v4 = &tmpVertices.at(6 * 3);
+        v1 = i;
+        v2 = i < 5u ? i + 1u : 1u;
+        v3 = i + 5u;
+        v4 = i + 5u < 10u ? i + 6u : 6u;
 
         // add a triangle in 1st row
-        _addVertices(v0, v1, v2, vertices);
-        _addIndices(index, index + 1, index + 2, indices);
+        _addIndices(v0, v1, v2, indices);
 
         // add 2 triangles in 2nd row
-        _addVertices(v1, v3, v2, vertices);
-        _addIndices(index + 3, index + 4, index + 5, indices);
-
-        _addVertices(v2, v3, v4, vertices);
-        _addIndices(index + 6, index + 7, index + 8, indices);
+        _addIndices(v1, v3, v2, indices);
+        _addIndices(v2, v3, v4, indices);
 
         // add a triangle in 3rd row
-        _addVertices(v3, v11, v4, vertices);
-        _addIndices(index + 9, index + 10, index + 11, indices);
-
-        // next index
-        index += 12;
+        _addIndices(v3, v11, v4, indices);
     }
 
     // subdivide the icosahedron to get a more sphere-like object
-    _subdivideIcosahedron(vertices, indices);
+    for (GLuint i{1u}; i <= subdivisions; ++i)
+        _subdivideIcosahedron(vertices, indices);
 }
 
 std::vector<GLfloat> Engine::_generateIcosahedron() {
@@ -1803,64 +5520,69 @@ std::vector<GLfloat> Engine::_generateIcosahedron() {
 }
 
 void Engine::_subdivideIcosahedron(std::vector<GLfloat>& vertices,
-                                   std::vector<GLushort>& indices) {
+                                   std::vector<GLuint>& indices) {
     /* https://www.songho.ca/opengl/gl_sphere.html */
 
-    std::vector<GLfloat> tmpVertices;
-    std::vector<GLushort> tmpIndices;
-    const GLfloat *v1, *v2, *v3; // ptr to original vertices of a triangle
-    GLfloat newV1[3ul], newV2[3ul], newV3[3ul]; // new vertex positions
-    GLushort index{(GLushort)0u};
-
-    // iterate all subdivision levels
-    for (GLuint i{1u}; i <= SPHERE_SUBDIVISIONS; ++i) {
-        // copy prev vertex/index arrays and clear
-        tmpVertices = vertices;
-        tmpIndices = indices;
-        vertices.clear();
-        indices.clear();
-        index = (GLushort)0u;
-
-        // perform subdivision for each triangle
-        for (size_t j{0ul}; j < tmpIndices.size(); j += 3ul) {
-            // get 3 vertices of a triangle
-            v1 = &tmpVertices.at(tmpIndices.at(j) * 3ul);
-            v2 = &tmpVertices.at(tmpIndices.at(j + 1ul) * 3ul);
-            v3 = &tmpVertices.at(tmpIndices.at(j + 2ul) * 3ul);
-
-            /* compute 3 new vertices by splitting half on each edge
-                    v1
-                   / \
-            newV1 *---* newV3
-                 / \ / \
-               v2---*---v3
-                  newV2
-            */
-            _computeHalfVertex(v1, v2, newV1);
-            _computeHalfVertex(v2, v3, newV2);
-            _computeHalfVertex(v1, v3, newV3);
-
-            // add 4 new triangles to vertex array
-            _addVertices(v1, newV1, newV3, vertices);
-            _addVertices(newV1, v2, newV2, vertices);
-            _addVertices(newV1, newV2, newV3, vertices);
-            _addVertices(newV3, newV2, v3, vertices);
-
-            // add indices of 4 new triangles
-            _addIndices(index, index + (GLushort)1u, index + (GLushort)2u,
-                        indices);
-            _addIndices(index + (GLushort)3u, index + (GLushort)4u,
-                        index + (GLushort)5u, indices);
-            _addIndices(index + (GLushort)6u, index + (GLushort)7u,
-                        index + (GLushort)8u, indices);
-            _addIndices(index + (GLushort)9u, index + (GLushort)10u,
-                        index + (GLushort)11u, indices);
-
-            index += (GLushort)12u; // next index
-        }
+    std::vector<GLuint> tmpIndices;
+    std::unordered_map<GLuint64, GLuint> midpoints;
+    GLuint v1, v2, v3;          // original vertices of a triangle
+    GLuint newV1, newV2, newV3; // new vertices
+
+    // adds one vertex per edge (E = 3F / 2) and quadruples the triangles
+    tmpIndices.swap(indices);
+    indices.reserve(tmpIndices.size() * 4ul);
+    vertices.reserve(vertices.size() + tmpIndices.size() / 2ul * 3ul);
+    midpoints.reserve(tmpIndices.size() / 2ul);
+
+    // perform subdivision for each triangle
+    for (size_t j{0ul}; j < tmpIndices.size(); j += 3ul) {
+        // get 3 vertices of a triangle
+        v1 = tmpIndices.at(j);
+        v2 = tmpIndices.at(j + 1ul);
+        v3 = tmpIndices.at(j + 2ul);
+
+        /* compute 3 new vertices by splitting half on each edge
+                v1
+               / \
+        newV1 *---* newV3
+             / \ / \
+           v2---*---v3
+              newV2
+        */
+        newV1 = _midpointVertex(v1, v2, vertices, midpoints);
+        newV2 = _midpointVertex(v2, v3, vertices, midpoints);
+        newV3 = _midpointVertex(v1, v3, vertices, midpoints);
+
+        // add indices of 4 new triangles
+        _addIndices(v1, newV1, newV3, indices);
+        _addIndices(newV1, v2, newV2, indices);
+        _addIndices(newV1, newV2, newV3, indices);
+        _addIndices(newV3, newV2, v3, indices);
     }
 }
 
+GLuint
+Engine::_midpointVertex(const GLuint& i1, const GLuint& i2,
+                        std::vector<GLfloat>& vertices,
+                        std::unordered_map<GLuint64, GLuint>& midpoints) {
+    // same key from either direction
+    const GLuint64 edge{(GLuint64)std::min(i1, i2) << 32u |
+                        (GLuint64)std::max(i1, i2)};
+
+    const auto found{midpoints.find(edge)};
+    if (found != midpoints.end())
+        return found->second;
+
+    GLfloat newV[3ul];
+    _computeHalfVertex(&vertices.at(i1 * 3ul), &vertices.at(i2 * 3ul), newV);
+
+    const GLuint index{(GLuint)(vertices.size() / 3ul)};
+    vertices.insert(vertices.end(), newV, newV + 3ul);
+    midpoints.emplace(edge, index);
+
+    return index;
+}
+
 void Engine::_computeHalfVertex(const GLfloat v1[3ul], const GLfloat v2[3ul],
                                 GLfloat newV[3ul]) {
     /* https://www.songho.ca/opengl/gl_sphere.html */
@@ -1881,23 +5603,8 @@ void Engine::_computeHalfVertex(const GLfloat v1[3ul], const GLfloat v2[3ul],
     newV[2ul] *= scale;
 }
 
-void Engine::_addVertices(const GLfloat v1[3], const GLfloat v2[3],
-                          const GLfloat v3[3], std::vector<GLfloat>& vertices) {
-    vertices.push_back(v1[0ul]);
-    vertices.push_back(v1[1ul]);
-    vertices.push_back(v1[2ul]);
-
-    vertices.push_back(v2[0ul]);
-    vertices.push_back(v2[1ul]);
-    vertices.push_back(v2[2ul]);
-
-    vertices.push_back(v3[0ul]);
-    vertices.push_back(v3[1ul]);
-    vertices.push_back(v3[2ul]);
-}
-
-void Engine::_addIndices(const GLushort& i1, const GLushort& i2,
-                         const GLushort& i3, std::vector<GLushort>& indices) {
+void Engine::_addIndices(const GLuint& i1, const GLuint& i2, const GLuint& i3,
+                         std::vector<GLuint>& indices) {
     indices.push_back(i1);
     indices.push_back(i2);
     indices.push_back(i3);
@@ -2009,6 +5716,134 @@ void Engine::_sendMaterialBlock(const vec3& materialAmb,
     glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE); // unbind
 }
 
+void Engine::_sendShadowBlock(const mat4& lightView, const mat4& cameraView,
+                              const GLint& shadowProjection) {
+    GLvoid* blockBuffer{malloc(_blockSizes[UBO_ID::SHADOW])};
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 0u),
+           glm::value_ptr(lightView), sizeof(lightView));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 1u),
+           &shadowProjection, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 2u),
+           glm::value_ptr(cameraView), sizeof(cameraView));
+
+    // std140 mat4 arrays are tightly packed, but each float of an array gets
+    // a full vec4 slot, so the splits/ranges are declared as vec4s instead
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 3u),
+           _cascadeViewProjections, sizeof(_cascadeViewProjections));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 4u),
+           _cascadeSplits, sizeof(_cascadeSplits));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 5u),
+           _cascadeDepthRanges, sizeof(_cascadeDepthRanges));
+
+    GLint shadowMaskDivisor{_activeShadowMaskDivisor()};
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 6u),
+           &shadowMaskDivisor, sizeof(GLint));
+
+    GLint penumbraTileSize{_penumbraTilesActive() ? PENUMBRA_TILE_SIZE : 0};
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 7u),
+           &penumbraTileSize, sizeof(GLint));
+
+    GLint temporalTaps{_temporalShadowsActive() ? TEMPORAL_SHADOW_TAPS : 0};
+    GLint frameIndex{(GLint)_frameCount};
+    GLfloat historyWeight{_temporalHistoryWeight()};
+    GLint rayTracedShadows{_exactShadowsActive() ? 1 : 0};
+    GLint sdfShadows{_sdfShadowsActive() ? 1 : 0};
+    vec4 areaLightSample{_areaLightSample, _areaLightActive() ? 1.f : 0.f};
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 8u),
+           glm::value_ptr(_previousViewProjection),
+           sizeof(_previousViewProjection));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 9u),
+           &temporalTaps, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 10u),
+           &frameIndex, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 11u),
+           &historyWeight, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 12u),
+           &rayTracedShadows, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 13u),
+           &sdfShadows, sizeof(GLint));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 14u),
+           glm::value_ptr(areaLightSample), sizeof(areaLightSample));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SHADOW].at(st 15u),
+           _shadowDepthRanges, sizeof(_shadowDepthRanges));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SHADOW]);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, _blockSizes[UBO_ID::SHADOW],
+                    blockBuffer);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE); // unbind
+}
+
+void Engine::_sendSpotBlock(const mat4& spotViewProjection,
+                            const vec3& spotDirection,
+                            const GLfloat& coneAngle, const GLfloat& falloff) {
+    GLvoid* blockBuffer{malloc(_blockSizes[UBO_ID::SPOT_CONE])};
+
+    // the shaders only need the cosines of the cone angles
+    vec4 direction{spotDirection, 0.f};
+    GLfloat cosOuter{glm::cos(coneAngle)};
+    GLfloat cosInner{glm::cos(coneAngle * (1.f - falloff))};
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 0u),
+           glm::value_ptr(spotViewProjection), sizeof(spotViewProjection));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 1u),
+           glm::value_ptr(direction), sizeof(direction));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 2u),
+           &cosOuter, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::SPOT_CONE].at(st 3u),
+           &cosInner, sizeof(GLfloat));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::SPOT_CONE]);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, _blockSizes[UBO_ID::SPOT_CONE],
+                    blockBuffer);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE); // unbind
+}
+
+void Engine::_sendClusterBlock(const mat4& clusterView,
+                               const mat4& inverseProjection,
+                               const vec2& screenSize,
+                               const GLint& clusteredLighting) {
+    GLvoid* blockBuffer{malloc(_blockSizes[UBO_ID::CLUSTER])};
+
+    glm::uvec4 clusterGrid{CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0u};
+    GLfloat clusterNear{CLUSTER_NEAR}, clusterFar{CLUSTER_FAR};
+
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 0u),
+           glm::value_ptr(clusterView), sizeof(clusterView));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 1u),
+           glm::value_ptr(inverseProjection), sizeof(inverseProjection));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 2u),
+           glm::value_ptr(clusterGrid), sizeof(clusterGrid));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 3u),
+           glm::value_ptr(screenSize), sizeof(screenSize));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 4u),
+           &clusterNear, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 5u),
+           &clusterFar, sizeof(GLfloat));
+    memcpy(blockBuffer + _uniformOffsets[UBO_ID::CLUSTER].at(st 6u),
+           &clusteredLighting, sizeof(GLint));
+
+    // send buffer to GPU
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubos[UBO_ID::CLUSTER]);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, _blockSizes[UBO_ID::CLUSTER],
+                    blockBuffer);
+
+    free(blockBuffer);
+    blockBuffer = nullptr;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, GL_NONE); // unbind
+}
+
 // *****************************************************************************
 // Debug stuff
 /* https://stackoverflow.com/a/18067245/10323091 */
@@ -0,0 +1,504 @@
+/**
+ * @file ReferenceTracer.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <xmmintrin.h> // SSE, always there on x86-64
+
+#include <glm/geometric.hpp> // for dot, cross, normalize
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp> // for inverse
+
+#include "ReferenceTracer.hpp"
+
+// *****************************************************************************
+// Ray Packets
+
+// ray parameters closer than this don't count as hits
+static constexpr GLfloat T_MIN{1e-4f};
+
+// one ray per SSE lane, every component stored across the 4 lanes
+struct RayPacket {
+    __m128 ox, oy, oz;    // origins
+    __m128 dx, dy, dz;    // directions (not normalized for shadow rays)
+    __m128 idx, idy, idz; // 1 / direction, for the box tests
+};
+
+static RayPacket makePacket(const vec3 origins[4], const vec3 directions[4]) {
+    GLfloat o[3][4], d[3][4], id[3][4];
+
+    for (GLint lane{0}; lane < 4; ++lane) {
+        for (GLint axis{0}; axis < 3; ++axis) {
+            GLfloat dir{directions[lane][axis]};
+
+            o[axis][lane] = origins[lane][axis];
+            d[axis][lane] = dir;
+
+            // no infinities, they'd turn into NaNs in the box tests
+            id[axis][lane] = 1.f / (dir == 0.f ? 1e-12f : dir);
+        }
+    }
+
+    return {_mm_loadu_ps(o[0]),  _mm_loadu_ps(o[1]),  _mm_loadu_ps(o[2]),
+            _mm_loadu_ps(d[0]),  _mm_loadu_ps(d[1]),  _mm_loadu_ps(d[2]),
+            _mm_loadu_ps(id[0]), _mm_loadu_ps(id[1]), _mm_loadu_ps(id[2])};
+}
+
+// carry a packet into an object's space (ray parameters stay the same)
+static RayPacket transformPacket(const RayPacket& r, const mat4& m) {
+    vec3 origins[4], directions[4];
+
+    GLfloat o[3][4], d[3][4];
+    _mm_storeu_ps(o[0], r.ox);
+    _mm_storeu_ps(o[1], r.oy);
+    _mm_storeu_ps(o[2], r.oz);
+    _mm_storeu_ps(d[0], r.dx);
+    _mm_storeu_ps(d[1], r.dy);
+    _mm_storeu_ps(d[2], r.dz);
+
+    for (GLint lane{0}; lane < 4; ++lane) {
+        origins[lane] =
+            vec3(m * vec4(o[0][lane], o[1][lane], o[2][lane], 1.f));
+        directions[lane] =
+            vec3(m * vec4(d[0][lane], d[1][lane], d[2][lane], 0.f));
+    }
+
+    return makePacket(origins, directions);
+}
+
+static inline __m128 select(const __m128& mask, const __m128& a,
+                            const __m128& b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 absolute(const __m128& a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.f), a);
+}
+
+// lanes whose ray passes through the box somewhere in [0;tMax]
+static __m128 hitBox(const RayPacket& r, const vec3& boundsMin,
+                     const vec3& boundsMax, const __m128& tMax) {
+    __m128 tx0{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), r.ox), r.idx)};
+    __m128 tx1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.x), r.ox), r.idx)};
+    __m128 ty0{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), r.oy), r.idy)};
+    __m128 ty1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.y), r.oy), r.idy)};
+    __m128 tz0{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), r.oz), r.idz)};
+    __m128 tz1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.z), r.oz), r.idz)};
+
+    __m128 enter{_mm_max_ps(
+        _mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+        _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_setzero_ps()))};
+    __m128 exit{
+        _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+                   _mm_min_ps(_mm_max_ps(tz0, tz1), tMax))};
+
+    return _mm_cmple_ps(enter, exit);
+}
+
+// Moller-Trumbore on 4 rays at once, t gets the hit distance of every lane
+static __m128 hitTriangle(const RayPacket& r, const Bvh::Triangle& triangle,
+                          const __m128& tMax, __m128& t) {
+    __m128 e1x{_mm_set1_ps(triangle.edge1.x)},
+        e1y{_mm_set1_ps(triangle.edge1.y)}, e1z{_mm_set1_ps(triangle.edge1.z)};
+    __m128 e2x{_mm_set1_ps(triangle.edge2.x)},
+        e2y{_mm_set1_ps(triangle.edge2.y)}, e2z{_mm_set1_ps(triangle.edge2.z)};
+
+    // p = d x e2
+    __m128 px{_mm_sub_ps(_mm_mul_ps(r.dy, e2z), _mm_mul_ps(r.dz, e2y))};
+    __m128 py{_mm_sub_ps(_mm_mul_ps(r.dz, e2x), _mm_mul_ps(r.dx, e2z))};
+    __m128 pz{_mm_sub_ps(_mm_mul_ps(r.dx, e2y), _mm_mul_ps(r.dy, e2x))};
+
+    __m128 det{_mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+                          _mm_mul_ps(e1z, pz))};
+    __m128 invDet{_mm_div_ps(_mm_set1_ps(1.f), det)};
+
+    // s = o - v0
+    __m128 sx{_mm_sub_ps(r.ox, _mm_set1_ps(triangle.v0.x))};
+    __m128 sy{_mm_sub_ps(r.oy, _mm_set1_ps(triangle.v0.y))};
+    __m128 sz{_mm_sub_ps(r.oz, _mm_set1_ps(triangle.v0.z))};
+
+    __m128 u{_mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)),
+                   _mm_mul_ps(sz, pz)),
+        invDet)};
+
+    // q = s x e1
+    __m128 qx{_mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y))};
+    __m128 qy{_mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z))};
+    __m128 qz{_mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x))};
+
+    __m128 v{_mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(r.dx, qx), _mm_mul_ps(r.dy, qy)),
+                   _mm_mul_ps(r.dz, qz)),
+        invDet)};
+
+    t = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                   _mm_mul_ps(e2z, qz)),
+        invDet);
+
+    __m128 zero{_mm_setzero_ps()};
+    __m128 mask{_mm_cmpgt_ps(absolute(det), _mm_set1_ps(1e-12f))};
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+    mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(T_MIN)));
+    return _mm_and_ps(mask, _mm_cmplt_ps(t, tMax));
+}
+
+// closest (or, for shadow rays, any) intersection with a sphere
+static __m128 hitSphere(const RayPacket& r, const vec4& sphere,
+                        const __m128& tMax, __m128& t) {
+    __m128 ocx{_mm_sub_ps(r.ox, _mm_set1_ps(sphere.x))};
+    __m128 ocy{_mm_sub_ps(r.oy, _mm_set1_ps(sphere.y))};
+    __m128 ocz{_mm_sub_ps(r.oz, _mm_set1_ps(sphere.z))};
+
+    __m128 a{_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(r.dx, r.dx), _mm_mul_ps(r.dy, r.dy)),
+        _mm_mul_ps(r.dz, r.dz))};
+    __m128 b{_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ocx, r.dx), _mm_mul_ps(ocy, r.dy)),
+        _mm_mul_ps(ocz, r.dz))};
+    __m128 c{_mm_sub_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)),
+                   _mm_mul_ps(ocz, ocz)),
+        _mm_set1_ps(sphere.w * sphere.w))};
+
+    __m128 discriminant{_mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c))};
+    __m128 root{_mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps()))};
+
+    // near root, unless we're inside the sphere
+    __m128 minusB{_mm_sub_ps(_mm_setzero_ps(), b)};
+    __m128 tNear{_mm_div_ps(_mm_sub_ps(minusB, root), a)};
+    __m128 tFar{_mm_div_ps(_mm_add_ps(minusB, root), a)};
+    t = select(_mm_cmpgt_ps(tNear, _mm_set1_ps(T_MIN)), tNear, tFar);
+
+    __m128 mask{_mm_cmpge_ps(discriminant, _mm_setzero_ps())};
+    mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(T_MIN)));
+    return _mm_and_ps(mask, _mm_cmplt_ps(t, tMax));
+}
+
+// the platform is the y = 0 plane, cut off at +/- size along x and z
+static __m128 hitPlatform(const RayPacket& r, const GLfloat& size,
+                          const __m128& tMax, __m128& t) {
+    t = _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), r.oy), r.dy);
+
+    __m128 x{_mm_add_ps(r.ox, _mm_mul_ps(t, r.dx))};
+    __m128 z{_mm_add_ps(r.oz, _mm_mul_ps(t, r.dz))};
+
+    __m128 mask{_mm_cmpgt_ps(t, _mm_set1_ps(T_MIN))};
+    mask = _mm_and_ps(mask, _mm_cmplt_ps(t, tMax));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(absolute(x), _mm_set1_ps(size)));
+    return _mm_and_ps(mask, _mm_cmple_ps(absolute(z), _mm_set1_ps(size)));
+}
+
+/**
+ * @brief walk a hierarchy with a whole packet, a node is visited if any of
+ * the active lanes needs it
+ *
+ * @param anyHit stop as soon as every active lane hit something (shadow
+ * rays), otherwise keep shrinking t to the closest hit
+ * @param [in,out] t closest hit so far per lane (or the end of the rays)
+ * @param [out] triangles index of the triangle each lane hit (closest only)
+ * @return lanes that hit anything
+ */
+static __m128 traverse(const std::vector<Bvh::Node>& nodes,
+                       const std::vector<Bvh::Triangle>& triangles,
+                       const GLuint& root, const RayPacket& r, __m128 active,
+                       const GLboolean& anyHit, __m128& t,
+                       GLuint triangleHits[4]) {
+    __m128 hits{_mm_setzero_ps()};
+
+    // Bvh::MAX_DEPTH, plus room for the sibling pushed at every level
+    GLuint stack[64];
+    GLint top{0};
+    stack[top++] = root;
+
+    while (top > 0) {
+        const Bvh::Node& node{nodes[stack[--top]]};
+
+        __m128 mask{
+            _mm_and_ps(active, hitBox(r, node.boundsMin, node.boundsMax, t))};
+        if (!_mm_movemask_ps(mask))
+            continue;
+
+        if (node.triangleCount == 0u) {
+            stack[top++] = node.leftFirst;
+            stack[top++] = node.leftFirst + 1u;
+            continue;
+        }
+
+        for (GLuint k{0u}; k < node.triangleCount; ++k) {
+            __m128 tHit;
+            __m128 hit{_mm_and_ps(
+                mask, hitTriangle(r, triangles[node.leftFirst + k], t, tHit))};
+
+            GLint bits{_mm_movemask_ps(hit)};
+            if (!bits)
+                continue;
+
+            hits = _mm_or_ps(hits, hit);
+
+            if (anyHit) {
+                // done with these lanes
+                active = _mm_andnot_ps(hit, active);
+                mask = _mm_andnot_ps(hit, mask);
+
+                if (!_mm_movemask_ps(active))
+                    return hits;
+            } else {
+                t = select(hit, tHit, t);
+
+                for (GLint lane{0}; lane < 4; ++lane)
+                    if (bits & (1 << lane))
+                        triangleHits[lane] = node.leftFirst + k;
+            }
+        }
+    }
+
+    return hits;
+}
+
+// *****************************************************************************
+// Public
+
+void ReferenceTracer::setTeapot(const std::vector<vec3>& vertices) {
+    _teapotRoot = _teapot.addMesh(vertices);
+    _hasTeapot = GL_TRUE;
+}
+
+void ReferenceTracer::setScene(const std::vector<vec4>& spheres,
+                               const std::vector<mat4>& teapotModels,
+                               const GLfloat& platformSize) {
+    _spheres = spheres;
+    _teapotModels = teapotModels;
+    _platformSize = platformSize;
+
+    _teapotInverses.clear();
+    for (const auto& model : _teapotModels)
+        _teapotInverses.push_back(glm::inverse(model));
+}
+
+void ReferenceTracer::render(const mat4& inverseViewProjection,
+                             const vec3& eyePos, const vec4& lightPos,
+                             const GLint& width, const GLint& height,
+                             std::vector<vec4>& positions,
+                             std::vector<GLfloat>& visibility) {
+    positions.assign((size_t)width * height, vec4(0.f));
+    visibility.assign((size_t)width * height, -1.f);
+
+    _inverseViewProjection = inverseViewProjection;
+    _eyePos = eyePos;
+    _lightPos = lightPos;
+    _width = width;
+    _height = height;
+    _positions = positions.data();
+    _visibility = visibility.data();
+    _raysTraced = 0u;
+
+    GLuint tilesX{(GLuint)((width + TILE_SIZE - 1) / TILE_SIZE)};
+    GLuint tilesY{(GLuint)((height + TILE_SIZE - 1) / TILE_SIZE)};
+
+    _pool.parallelFor(tilesX * tilesY,
+                      [this](GLuint tile) { _renderTile(tile); });
+
+    _positions = nullptr;
+    _visibility = nullptr;
+}
+
+GLuint ReferenceTracer::getNumThreads() { return _pool.getNumThreads(); }
+
+GLuint ReferenceTracer::getSteals() { return _pool.getSteals(); }
+
+GLuint64 ReferenceTracer::getRaysTraced() { return _raysTraced; }
+
+// *****************************************************************************
+// Private
+
+void ReferenceTracer::_renderTile(const GLuint& tile) {
+    enum HIT_TYPE { MISS, PLATFORM, SPHERE, TEAPOT };
+
+    GLint tilesX{(_width + TILE_SIZE - 1) / TILE_SIZE};
+    GLint x0{(GLint)tile % tilesX * TILE_SIZE};
+    GLint y0{(GLint)tile / tilesX * TILE_SIZE};
+
+    const std::vector<Bvh::Node>& nodes{_teapot.getNodes()};
+    const std::vector<Bvh::Triangle>& triangles{_teapot.getTriangles()};
+
+    GLuint64 rays{0u};
+
+    // 2 x 2 pixels per packet
+    for (GLint py{y0}; py < y0 + TILE_SIZE && py < _height; py += 2) {
+        for (GLint px{x0}; px < x0 + TILE_SIZE && px < _width; px += 2) {
+            GLint pixels[4];
+            vec3 origins[4], directions[4];
+            GLfloat active[4];
+
+            for (GLint lane{0}; lane < 4; ++lane) {
+                GLint x{px + lane % 2}, y{py + lane / 2};
+
+                // lanes off the edge of the screen just go along for the ride
+                GLboolean inside{x < _width && y < _height};
+                pixels[lane] = inside ? y * _width + x : -1;
+                active[lane] = inside ? 1.f : 0.f;
+                rays += inside ? 1u : 0u;
+
+                // through the middle of the pixel (depth 0.5 is in front of
+                // the eye with standard and reversed-Z projections alike)
+                vec4 ndc{2.f * ((GLfloat)x + 0.5f) / (GLfloat)_width - 1.f,
+                         2.f * ((GLfloat)y + 0.5f) / (GLfloat)_height - 1.f,
+                         0.5f, 1.f};
+                vec4 world{_inverseViewProjection * ndc};
+
+                origins[lane] = _eyePos;
+                directions[lane] =
+                    glm::normalize(vec3(world) / world.w - _eyePos);
+            }
+
+            __m128 activeMask{_mm_cmpneq_ps(_mm_loadu_ps(active),
+                                            _mm_setzero_ps())};
+
+            /* Primary Rays */
+
+            RayPacket primary{makePacket(origins, directions)};
+
+            __m128 t{_mm_set1_ps(1e4f)}, tHit;
+            HIT_TYPE types[4]{MISS, MISS, MISS, MISS};
+            GLuint objects[4]{0u}, triangleHits[4]{0u};
+
+            // remember what each lane hit whenever it gets closer
+            auto record = [&](const __m128& hit, HIT_TYPE type, GLuint object) {
+                GLint bits{_mm_movemask_ps(hit)};
+                for (GLint lane{0}; lane < 4; ++lane) {
+                    if (bits & (1 << lane)) {
+                        types[lane] = type;
+                        objects[lane] = object;
+                    }
+                }
+            };
+
+            __m128 hit{_mm_and_ps(
+                activeMask, hitPlatform(primary, _platformSize, t, tHit))};
+            t = select(hit, tHit, t);
+            record(hit, PLATFORM, 0u);
+
+            for (GLuint i{0u}; i < _spheres.size(); ++i) {
+                hit = _mm_and_ps(activeMask,
+                                 hitSphere(primary, _spheres.at(i), t, tHit));
+                t = select(hit, tHit, t);
+                record(hit, SPHERE, i);
+            }
+
+            for (GLuint i{0u}; i < _teapotModels.size() && _hasTeapot; ++i) {
+                GLuint teapotTriangles[4]{0u};
+                hit = traverse(nodes, triangles, _teapotRoot,
+                               transformPacket(primary, _teapotInverses.at(i)),
+                               activeMask, GL_FALSE, t, teapotTriangles);
+                record(hit, TEAPOT, i);
+
+                GLint bits{_mm_movemask_ps(hit)};
+                for (GLint lane{0}; lane < 4; ++lane)
+                    if (bits & (1 << lane))
+                        triangleHits[lane] = teapotTriangles[lane];
+            }
+
+            /* Shadow Rays */
+
+            GLfloat hitDistances[4];
+            _mm_storeu_ps(hitDistances, t);
+
+            vec3 shadowOrigins[4], shadowDirections[4];
+            GLfloat shadowActive[4]{0.f, 0.f, 0.f, 0.f};
+
+            for (GLint lane{0}; lane < 4; ++lane) {
+                shadowOrigins[lane] = shadowDirections[lane] = vec3(1.f);
+
+                if (pixels[lane] < 0 || types[lane] == MISS)
+                    continue;
+
+                vec3 position{origins[lane] +
+                              hitDistances[lane] * directions[lane]};
+
+                vec3 normal{0.f, 1.f, 0.f};
+                if (types[lane] == SPHERE)
+                    normal = glm::normalize(position -
+                                            vec3(_spheres.at(objects[lane])));
+                else if (types[lane] == TEAPOT) {
+                    const Bvh::Triangle& triangle{
+                        triangles.at(triangleHits[lane])};
+                    normal = glm::normalize(
+                        glm::mat3(_teapotModels.at(objects[lane])) *
+                        glm::cross(vec3(triangle.edge1),
+                                   vec3(triangle.edge2)));
+                }
+
+                // whichever side the camera sees
+                if (glm::dot(normal, directions[lane]) > 0.f)
+                    normal = -normal;
+
+                _positions[pixels[lane]] = vec4(position, 1.f);
+
+                vec3 origin{position + RAY_OFFSET * normal};
+                vec3 dir{_lightPos.w == 0.f
+                             ? 1000.f * glm::normalize(vec3(_lightPos))
+                             : vec3(_lightPos) - origin};
+
+                // facing away from the light, shadows don't matter
+                if (glm::dot(dir, normal) <= 0.f)
+                    continue;
+
+                shadowOrigins[lane] = origin;
+                shadowDirections[lane] = dir;
+                shadowActive[lane] = 1.f;
+                ++rays;
+            }
+
+            __m128 shadowMask{_mm_cmpneq_ps(_mm_loadu_ps(shadowActive),
+                                            _mm_setzero_ps())};
+            if (!_mm_movemask_ps(shadowMask))
+                continue;
+
+            // shadow rays end at the light (t = 1)
+            RayPacket shadow{makePacket(shadowOrigins, shadowDirections)};
+            __m128 end{_mm_set1_ps(1.f)};
+            __m128 occluded{
+                _mm_and_ps(shadowMask, hitPlatform(shadow, _platformSize, end,
+                                                   tHit))};
+
+            for (GLuint i{0u};
+                 i < _spheres.size() &&
+                 _mm_movemask_ps(_mm_andnot_ps(occluded, shadowMask));
+                 ++i)
+                occluded = _mm_or_ps(
+                    occluded,
+                    _mm_and_ps(shadowMask,
+                               hitSphere(shadow, _spheres.at(i), end, tHit)));
+
+            for (GLuint i{0u};
+                 i < _teapotModels.size() && _hasTeapot &&
+                 _mm_movemask_ps(_mm_andnot_ps(occluded, shadowMask));
+                 ++i) {
+                GLuint unused[4];
+                __m128 tEnd{end};
+
+                occluded = _mm_or_ps(
+                    occluded,
+                    traverse(nodes, triangles, _teapotRoot,
+                             transformPacket(shadow, _teapotInverses.at(i)),
+                             _mm_andnot_ps(occluded, shadowMask), GL_TRUE,
+                             tEnd, unused));
+            }
+
+            GLint bits{_mm_movemask_ps(occluded)};
+            for (GLint lane{0}; lane < 4; ++lane)
+                if (shadowActive[lane] != 0.f)
+                    _visibility[pixels[lane]] = bits & (1 << lane) ? 0.f : 1.f;
+        }
+    }
+
+    _raysTraced += rays;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file ShadowAtlas.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <algorithm> // for find_if
+
+#include "ShadowAtlas.hpp"
+
+// *****************************************************************************
+// Public
+
+ShadowAtlas::ShadowAtlas(const GLuint& size, const GLuint& minTileSize)
+    : _size{size}, _minTileSize{minTileSize} {
+    // one free list per level, down to the smallest tile
+    _freeTiles.resize(_levelOf(_minTileSize) + 1u);
+
+    // start out with the whole atlas free
+    _freeTiles.at(0u).push_back({0u, 0u, _size});
+}
+
+GLboolean ShadowAtlas::acquire(const GLuint& key, GLuint tileSize,
+                               const GLuint& frame, Tile& tile) {
+    // round up to a power of two the quadtree can hand out
+    GLuint roundedSize{_minTileSize};
+    while (roundedSize < tileSize && roundedSize < _size)
+        roundedSize *= 2u;
+    tileSize = roundedSize;
+
+    auto it = _entries.find(key);
+
+    // already have a tile of the right size, just mark it as used
+    if (it != _entries.end()) {
+        if (it->second.tile.size == tileSize) {
+            it->second.lastUsed = frame;
+            tile = it->second.tile;
+
+            return GL_TRUE;
+        }
+
+        // wrong size, give it back before asking for a new one
+        _free(it->second.tile);
+        _entries.erase(it);
+    }
+
+    GLuint level{_levelOf(tileSize)};
+
+    while (!_allocate(level, tile)) {
+        if (!_evictLeastRecentlyUsed(frame))
+            return GL_FALSE;
+    }
+
+    _entries[key] = {tile, frame};
+
+    return GL_TRUE;
+}
+
+void ShadowAtlas::release(const GLuint& key) {
+    auto it = _entries.find(key);
+    if (it == _entries.end())
+        return;
+
+    _free(it->second.tile);
+    _entries.erase(it);
+}
+
+GLuint ShadowAtlas::getSize() { return _size; }
+
+GLuint ShadowAtlas::getNumTiles() { return (GLuint)_entries.size(); }
+
+GLuint ShadowAtlas::getEvictions() { return _evictions; }
+
+// *****************************************************************************
+// Private
+
+GLuint ShadowAtlas::_levelOf(const GLuint& tileSize) {
+    GLuint level{0u};
+    for (GLuint size{_size}; size > tileSize; size /= 2u)
+        ++level;
+
+    return level;
+}
+
+GLboolean ShadowAtlas::_allocate(const GLuint& level, Tile& tile) {
+    auto& freeTiles = _freeTiles.at(level);
+
+    if (!freeTiles.empty()) {
+        tile = freeTiles.back();
+        freeTiles.pop_back();
+
+        return GL_TRUE;
+    }
+
+    // nothing bigger to split
+    if (level == 0u)
+        return GL_FALSE;
+
+    Tile parent;
+    if (!_allocate(level - 1u, parent))
+        return GL_FALSE;
+
+    // keep the first quadrant, the other three go on the free list
+    GLuint size{parent.size / 2u};
+
+    freeTiles.push_back({parent.x + size, parent.y, size});
+    freeTiles.push_back({parent.x, parent.y + size, size});
+    freeTiles.push_back({parent.x + size, parent.y + size, size});
+
+    tile = {parent.x, parent.y, size};
+
+    return GL_TRUE;
+}
+
+void ShadowAtlas::_free(const Tile& tile) {
+    GLuint level{_levelOf(tile.size)};
+    auto& freeTiles = _freeTiles.at(level);
+
+    if (level == 0u) {
+        freeTiles.push_back(tile);
+        return;
+    }
+
+    // the parent's corner, siblings are the other quadrants of it
+    GLuint parentSize{tile.size * 2u};
+    Tile parent{tile.x - tile.x % parentSize, tile.y - tile.y % parentSize,
+                parentSize};
+
+    std::vector<std::vector<Tile>::iterator> siblings;
+
+    for (GLuint i{0u}; i < 4u; ++i) {
+        GLuint x{parent.x + (i % 2u) * tile.size};
+        GLuint y{parent.y + (i / 2u) * tile.size};
+
+        if (x == tile.x && y == tile.y)
+            continue;
+
+        auto sibling =
+            std::find_if(freeTiles.begin(), freeTiles.end(),
+                         [&](const Tile& t) { return t.x == x && t.y == y; });
+
+        if (sibling == freeTiles.end()) {
+            // somebody is still using a sibling, can't merge
+            freeTiles.push_back(tile);
+            return;
+        }
+
+        siblings.push_back(sibling);
+    }
+
+    // erase from the back so the other iterators stay valid
+    std::sort(siblings.begin(), siblings.end(),
+              [](const auto& a, const auto& b) { return a > b; });
+    for (const auto& sibling : siblings)
+        freeTiles.erase(sibling);
+
+    _free(parent);
+}
+
+GLboolean ShadowAtlas::_evictLeastRecentlyUsed(const GLuint& frame) {
+    auto oldest = _entries.end();
+
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->second.lastUsed == frame)
+            continue;
+
+        if (oldest == _entries.end() ||
+            it->second.lastUsed < oldest->second.lastUsed)
+            oldest = it;
+    }
+
+    if (oldest == _entries.end())
+        return GL_FALSE;
+
+    _free(oldest->second.tile);
+    _entries.erase(oldest);
+    ++_evictions;
+
+    return GL_TRUE;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file ShadowScheduler.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <algorithm> // for sort
+
+#include "ShadowScheduler.hpp"
+
+// *****************************************************************************
+// Public
+
+void ShadowScheduler::submit(const GLuint& key, const GLfloat& priority) {
+    _queue.push_back({priority, key});
+}
+
+std::vector<GLuint> ShadowScheduler::schedule() {
+    std::vector<GLuint> scheduled;
+
+    // most important first
+    std::sort(_queue.begin(), _queue.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    GLfloat spentMs{0.f};
+    for (const auto& [priority, key] : _queue) {
+        if (!scheduled.empty() && spentMs + _costPerFaceMs > _budgetMs)
+            break;
+
+        scheduled.push_back(key);
+        spentMs += _costPerFaceMs;
+    }
+
+    ++_frames;
+    if (scheduled.size() == _queue.size())
+        ++_hits;
+
+    _queue.clear();
+
+    return scheduled;
+}
+
+void ShadowScheduler::reportCost(const GLfloat& milliseconds,
+                                 const GLuint& facesRendered) {
+    if (facesRendered == 0u)
+        return;
+
+    _costPerFaceMs += COST_SMOOTHING *
+                      (milliseconds / (GLfloat)facesRendered - _costPerFaceMs);
+}
+
+GLfloat ShadowScheduler::getBudget() { return _budgetMs; }
+
+void ShadowScheduler::setBudget(const GLfloat& budgetMs) {
+    _budgetMs = budgetMs;
+
+    // start counting over for the new budget
+    _hits = _frames = 0u;
+}
+
+GLfloat ShadowScheduler::getCostPerFace() { return _costPerFaceMs; }
+
+GLfloat ShadowScheduler::getHitRate() {
+    return _frames ? (GLfloat)_hits / (GLfloat)_frames : 1.f;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file VertexCache.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include <algorithm> // for find, iter_swap, max_element
+#include <cmath>     // for pow
+
+#include "VertexCache.hpp"
+
+// *****************************************************************************
+// Public
+
+std::vector<GLuint> VertexCache::optimize(const std::vector<GLuint>& indices,
+                                          const GLuint& numVertices) {
+    const size_t numTriangles{indices.size() / 3u};
+
+    // triangles not yet emitted around every vertex, packed back to back (the
+    // first remaining.at(v) entries of a vertex's range are the live ones)
+    std::vector<GLuint> remaining(numVertices, 0u);
+    for (const auto& index : indices)
+        ++remaining.at(index);
+
+    std::vector<GLuint> firstTriangle(numVertices + 1u, 0u);
+    for (GLuint v{0u}; v < numVertices; ++v)
+        firstTriangle.at(v + 1u) = firstTriangle.at(v) + remaining.at(v);
+
+    std::vector<GLuint> vertexTriangles(indices.size());
+    std::vector<GLuint> filled(numVertices, 0u);
+    for (size_t t{0u}; t < numTriangles; ++t) {
+        for (size_t k{0u}; k < 3u; ++k) {
+            const GLuint v{indices.at(t * 3u + k)};
+            vertexTriangles.at(firstTriangle.at(v) + filled.at(v)++) = t;
+        }
+    }
+
+    std::vector<GLint> cachePositions(numVertices, -1);
+    std::vector<GLfloat> vertexScores(numVertices);
+    for (GLuint v{0u}; v < numVertices; ++v)
+        vertexScores.at(v) = _vertexScore(-1, remaining.at(v));
+
+    std::vector<GLfloat> triangleScores(numTriangles, 0.f);
+    for (size_t t{0u}; t < numTriangles; ++t)
+        for (size_t k{0u}; k < 3u; ++k)
+            triangleScores.at(t) += vertexScores.at(indices.at(t * 3u + k));
+
+    std::vector<GLboolean> emitted(numTriangles, GL_FALSE);
+    std::vector<GLuint> cache, nextCache, optimized;
+    cache.reserve(CACHE_SIZE + 3u);
+    nextCache.reserve(CACHE_SIZE + 3u);
+    optimized.reserve(indices.size());
+
+    GLint best{-1};
+
+    while (optimized.size() < indices.size()) {
+        // nothing in the cache touches a triangle that is left (the very
+        // first one, or a disconnected piece), take the best one anywhere
+        if (best < 0) {
+            GLfloat bestScore{-1.f};
+            for (size_t t{0u}; t < numTriangles; ++t) {
+                if (!emitted.at(t) && triangleScores.at(t) > bestScore) {
+                    bestScore = triangleScores.at(t);
+                    best = (GLint)t;
+                }
+            }
+        }
+
+        const GLuint triangle{(GLuint)best};
+        emitted.at(triangle) = GL_TRUE;
+        nextCache.clear();
+
+        for (size_t k{0u}; k < 3u; ++k) {
+            const GLuint v{indices.at(triangle * 3u + k)};
+            optimized.push_back(v);
+            nextCache.push_back(v);
+
+            // take the triangle off the vertex's live list
+            auto begin{vertexTriangles.begin() + firstTriangle.at(v)};
+            auto end{begin + remaining.at(v)};
+            std::iter_swap(std::find(begin, end, triangle), end - 1);
+            --remaining.at(v);
+        }
+
+        // the triangle's corners go to the front, the rest shift back
+        for (const auto& v : cache)
+            if (std::find(nextCache.begin(), nextCache.begin() + 3, v) ==
+                nextCache.begin() + 3)
+                nextCache.push_back(v);
+
+        for (size_t i{0u}; i < nextCache.size(); ++i)
+            cachePositions.at(nextCache.at(i)) =
+                i < CACHE_SIZE ? (GLint)i : -1;
+
+        // rescore every vertex that moved (including the ones pushed out),
+        // then the triangles around them, keeping the best for next time
+        for (const auto& v : nextCache)
+            vertexScores.at(v) =
+                _vertexScore(cachePositions.at(v), remaining.at(v));
+
+        best = -1;
+        GLfloat bestScore{-1.f};
+
+        for (const auto& v : nextCache) {
+            for (GLuint i{0u}; i < remaining.at(v); ++i) {
+                const GLuint t{vertexTriangles.at(firstTriangle.at(v) + i)};
+
+                triangleScores.at(t) = 0.f;
+                for (size_t k{0u}; k < 3u; ++k)
+                    triangleScores.at(t) +=
+                        vertexScores.at(indices.at(t * 3u + k));
+
+                if (triangleScores.at(t) > bestScore) {
+                    bestScore = triangleScores.at(t);
+                    best = (GLint)t;
+                }
+            }
+        }
+
+        if (nextCache.size() > CACHE_SIZE)
+            nextCache.resize(CACHE_SIZE);
+        cache.swap(nextCache);
+    }
+
+    return optimized;
+}
+
+GLfloat VertexCache::missRatio(const std::vector<GLuint>& indices,
+                               const GLuint& cacheSize) {
+    if (indices.empty())
+        return 0.f;
+
+    // a vertex is still cached while fewer than cacheSize misses happened
+    // since it went in
+    const GLuint numVertices{*std::max_element(indices.begin(), indices.end()) +
+                             1u};
+    std::vector<GLint64> insertedAt(numVertices, -(GLint64)cacheSize);
+    GLint64 misses{0};
+
+    for (const auto& index : indices) {
+        if (misses - insertedAt.at(index) >= (GLint64)cacheSize) {
+            insertedAt.at(index) = misses;
+            ++misses;
+        }
+    }
+
+    return (GLfloat)misses / (GLfloat)(indices.size() / 3u);
+}
+
+// *****************************************************************************
+// Private
+
+GLfloat VertexCache::_vertexScore(const GLint& cachePosition,
+                                  const GLuint& remaining) {
+    // nothing left to draw with it
+    if (remaining == 0u)
+        return -1.f;
+
+    GLfloat score{0.f};
+
+    if (cachePosition >= 0) {
+        if (cachePosition < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+            score = std::pow(1.f - (GLfloat)(cachePosition - 3) /
+                                       (GLfloat)(CACHE_SIZE - 3u),
+                             CACHE_DECAY_POWER);
+    }
+
+    return score + VALENCE_BOOST_SCALE *
+                       std::pow((GLfloat)remaining, -VALENCE_BOOST_POWER);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file WorkStealingPool.cpp
+ * @author Vincent Marias [@qtf0x]
+ * @date 04/02/2023
+ *
+ * @brief CSCI 544 ~ Advanced Computer Graphics [Spring 2023]
+ *        A2 ~ Noisy Teapotahedron
+ */
+
+#include "WorkStealingPool.hpp"
+
+// *****************************************************************************
+// Public
+
+WorkStealingPool::WorkStealingPool(const GLuint& numThreads) {
+    GLuint count{numThreads};
+    if (count == 0u)
+        count = std::thread::hardware_concurrency();
+    if (count == 0u) // unknown
+        count = 4u;
+
+    for (GLuint i{0u}; i < count; ++i)
+        _queues.push_back(std::make_unique<Queue>());
+
+    for (GLuint i{0u}; i < count; ++i)
+        _threads.emplace_back(&WorkStealingPool::_workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stop = GL_TRUE;
+    }
+    _wake.notify_all();
+
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+void WorkStealingPool::parallelFor(const GLuint& count,
+                                   const std::function<void(GLuint)>& task) {
+    if (count == 0u)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // set before any item shows up in a queue, popping an item (under
+        // its queue's lock) makes it visible to the worker
+        _task = &task;
+        _remaining = count;
+
+        for (GLuint i{0u}; i < count; ++i) {
+            Queue& queue{*_queues.at(i % _queues.size())};
+
+            std::lock_guard<std::mutex> queueLock{queue.mutex};
+            queue.items.push_back(i);
+        }
+
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    std::unique_lock<std::mutex> lock{_mutex};
+    _done.wait(lock, [this] { return _remaining == 0u; });
+
+    _task = nullptr;
+}
+
+GLuint WorkStealingPool::getNumThreads() { return (GLuint)_threads.size(); }
+
+GLuint WorkStealingPool::getSteals() { return _steals; }
+
+// *****************************************************************************
+// Private
+
+void WorkStealingPool::_workerLoop(const GLuint& index) {
+    GLuint seenGeneration{0u};
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _wake.wait(lock, [&] {
+                return _stop || _generation != seenGeneration;
+            });
+
+            if (_stop)
+                return;
+
+            seenGeneration = _generation;
+        }
+
+        GLuint item;
+        while (_pop(index, item)) {
+            (*_task)(item);
+
+            // the last item wakes up parallelFor() (taking the lock so the
+            // wake up can't slip in between its check and its wait)
+            if (_remaining.fetch_sub(1u) == 1u) {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _done.notify_all();
+            }
+        }
+    }
+}
+
+GLboolean WorkStealingPool::_pop(const GLuint& index, GLuint& item) {
+    // newest first from our own queue
+    {
+        Queue& own{*_queues.at(index)};
+        std::lock_guard<std::mutex> lock{own.mutex};
+
+        if (!own.items.empty()) {
+            item = own.items.back();
+            own.items.pop_back();
+            return GL_TRUE;
+        }
+    }
+
+    // oldest first from everyone else's, starting with our neighbour
+    for (GLuint offset{1u}; offset < _queues.size(); ++offset) {
+        Queue& victim{*_queues.at((index + offset) % _queues.size())};
+        std::lock_guard<std::mutex> lock{victim.mutex};
+
+        if (!victim.items.empty()) {
+            item = victim.items.front();
+            victim.items.pop_front();
+            ++_steals;
+            return GL_TRUE;
+        }
+    }
+
+    return GL_FALSE;
+}